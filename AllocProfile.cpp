@@ -0,0 +1,172 @@
+//
+// Where the memory of a check goes, for checkers built with HW3_ALLOC_PROFILE
+//
+
+#include "AllocProfile.h"
+
+#ifdef HW3_ALLOC_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <malloc.h>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+// Nothing here may allocate while counting, operator new below comes through it, so the counters are fixed arrays
+// of atomics, zero before any constructor runs
+class AllocCounters {
+public:
+    atomic<uint64_t> count{0};
+    atomic<uint64_t> bytes{0};
+    atomic<int64_t> live{0};
+    atomic<int64_t> peak{0};
+
+    void allocate(size_t size) {
+        count.fetch_add(1, memory_order_relaxed);
+        bytes.fetch_add(size, memory_order_relaxed);
+        raisePeak(live.fetch_add(int64_t(size), memory_order_relaxed) + int64_t(size));
+    }
+
+    void release(size_t size) {
+        live.fetch_sub(int64_t(size), memory_order_relaxed);
+    }
+
+    void raisePeak(int64_t value) {
+        int64_t seen = peak.load(memory_order_relaxed);
+        while (value > seen && !peak.compare_exchange_weak(seen, value, memory_order_relaxed)) {
+        }
+    }
+};
+
+static const size_t MAX_CLASSES = 128;
+
+static const char *const PHASE_NAMES[PHASE_COUNT] = {"other", "read", "scan", "check", "backend"};
+
+static mutex classesMutex;
+static const type_info *classTypes[MAX_CLASSES];
+static atomic<size_t> classCount{0};
+static AllocCounters classes[MAX_CLASSES];
+
+// The heap of the whole process, and the allocations made in each phase
+// A block may be freed in another phase than the one it was allocated in, so a phase has no live bytes of its own,
+// its peak is the most the whole heap held while that phase was allocating
+static AllocCounters heap;
+static AllocCounters phases[PHASE_COUNT];
+static thread_local AllocPhase currentPhase = PHASE_OTHER;
+
+size_t profileClassId(const type_info &type) {
+    lock_guard<mutex> lock(classesMutex);
+    size_t count = classCount.load(memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        if (*classTypes[i] == type) {
+            return i;
+        }
+    }
+    if (count == MAX_CLASSES) {
+        fprintf(stderr, "allocation profile: more than %zu classes\n", MAX_CLASSES);
+        abort();
+    }
+    classTypes[count] = &type;
+    classCount.store(count + 1, memory_order_release);
+    return count;
+}
+
+void profileAllocate(size_t classId, size_t bytes) {
+    classes[classId].allocate(bytes);
+}
+
+void profileRelease(size_t classId, size_t bytes) {
+    classes[classId].release(bytes);
+}
+
+AllocPhaseScope::AllocPhaseScope(AllocPhase phase) : previous(currentPhase) {
+    currentPhase = phase;
+}
+
+AllocPhaseScope::~AllocPhaseScope() {
+    currentPhase = previous;
+}
+
+// The sizes are the ones malloc rounds the requests to, which is also what a free gives back
+void *operator new(size_t size) {
+    void *memory = malloc(size ? size : 1);
+    if (!memory) {
+        throw bad_alloc();
+    }
+    size_t usable = malloc_usable_size(memory);
+    heap.allocate(usable);
+    AllocCounters &phase = phases[currentPhase];
+    phase.count.fetch_add(1, memory_order_relaxed);
+    phase.bytes.fetch_add(usable, memory_order_relaxed);
+    phase.raisePeak(heap.live.load(memory_order_relaxed));
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    if (!memory) {
+        return;
+    }
+    heap.release(malloc_usable_size(memory));
+    free(memory);
+}
+
+static string className(const type_info &type) {
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    string name = status == 0 ? demangled : type.name();
+    free(demangled);
+    return name;
+}
+
+// The counters are copied before printing, which allocates
+static void printProfile() {
+    class Line {
+    public:
+        string name;
+        uint64_t count;
+        uint64_t bytes;
+        int64_t live;
+        int64_t peak;
+    };
+    auto snapshot = [](string name, const AllocCounters &counters) {
+        return Line{std::move(name), counters.count.load(), counters.bytes.load(), counters.live.load(),
+                    counters.peak.load()};
+    };
+    Line total = snapshot("heap", heap);
+    vector<Line> phaseLines;
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        phaseLines.push_back(snapshot(PHASE_NAMES[i], phases[i]));
+    }
+    vector<Line> classLines;
+    for (size_t i = 0; i < classCount.load(memory_order_acquire); ++i) {
+        classLines.push_back(snapshot(className(*classTypes[i]), classes[i]));
+    }
+    // The classes holding the most memory at their peak first
+    stable_sort(classLines.begin(), classLines.end(), [](const Line &a, const Line &b) {
+        return a.peak > b.peak;
+    });
+
+    fprintf(stderr, "class                      count          bytes      peak live   live at exit\n");
+    for (auto &line : classLines) {
+        fprintf(stderr, "%-20s %12llu %14llu %14lld %14lld\n", line.name.c_str(), (unsigned long long) line.count,
+                (unsigned long long) line.bytes, (long long) line.peak, (long long) line.live);
+    }
+    fprintf(stderr, "phase                allocations          bytes      peak heap\n");
+    for (auto &line : phaseLines) {
+        fprintf(stderr, "%-20s %12llu %14llu %14lld\n", line.name.c_str(), (unsigned long long) line.count,
+                (unsigned long long) line.bytes, (long long) line.peak);
+    }
+    fprintf(stderr, "%-20s %12llu %14llu %14lld\n", total.name.c_str(), (unsigned long long) total.count,
+            (unsigned long long) total.bytes, (long long) total.peak);
+}
+
+// Registered before main, so the summary is printed once main has returned or exit was called
+static const int registered = atexit(printProfile);
+
+#endif
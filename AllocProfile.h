@@ -0,0 +1,91 @@
+//
+// Where the memory of a check goes, for checkers built with HW3_ALLOC_PROFILE
+//
+
+#ifndef HW3_ALLOC_PROFILE_H
+#define HW3_ALLOC_PROFILE_H
+
+#include <cstddef>
+#include <typeinfo>
+
+using namespace std;
+
+// The part of a run a heap allocation is charged to, set by AllocPhaseScope on each thread
+enum AllocPhase {
+    // Anything outside the other phases: option parsing, the contexts, the pools, tearing down
+    PHASE_OTHER,
+    // Reading or mapping the program
+    PHASE_READ,
+    // The scanner, making the token nodes
+    PHASE_SCAN,
+    // The reductions and their semantic actions, the symbol tables and the scope dumps
+    PHASE_CHECK,
+    // Compiling, running or emitting the syntax tree
+    PHASE_BACKEND,
+    PHASE_COUNT
+};
+
+#ifdef HW3_ALLOC_PROFILE
+
+// With HW3_ALLOC_PROFILE every operator new and delete of the process is counted for the current phase, and the
+// classes below are counted one by one: the nodes made by NodeArena::make per TypeNode subclass, and the symbol
+// table structures deriving from ProfiledObject
+// The summary goes to stderr when the process exits
+
+// The id of a counted class, registered the first time it is asked for
+size_t profileClassId(const type_info &type);
+
+template<class T>
+size_t profileClass() {
+    static const size_t id = profileClassId(typeid(T));
+    return id;
+}
+
+// An object of the class was made or destroyed, bytes is its size
+void profileAllocate(size_t classId, size_t bytes);
+
+void profileRelease(size_t classId, size_t bytes);
+
+// Charges the heap allocations of this thread to phase until the end of the scope, phases nest
+class AllocPhaseScope {
+public:
+    explicit AllocPhaseScope(AllocPhase phase);
+
+    ~AllocPhaseScope();
+
+    AllocPhaseScope(const AllocPhaseScope &) = delete;
+
+    AllocPhaseScope &operator=(const AllocPhaseScope &) = delete;
+
+private:
+    AllocPhase previous;
+};
+
+#define PROFILE_PHASE(phase) AllocPhaseScope allocPhaseScope(phase)
+
+#else
+#define PROFILE_PHASE(phase) ((void) 0)
+#endif
+
+// Counts the live objects of T and their bytes when profiling, an empty base otherwise
+template<class T>
+class ProfiledObject {
+#ifdef HW3_ALLOC_PROFILE
+public:
+    ProfiledObject() {
+        profileAllocate(profileClass<T>(), sizeof(T));
+    }
+
+    ProfiledObject(const ProfiledObject &) : ProfiledObject() {
+
+    }
+
+    ProfiledObject &operator=(const ProfiledObject &) = default;
+
+    ~ProfiledObject() {
+        profileRelease(profileClass<T>(), sizeof(T));
+    }
+#endif
+};
+
+#endif //HW3_ALLOC_PROFILE_H
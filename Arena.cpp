@@ -0,0 +1,47 @@
+//
+// Bump allocator for the semantic values of the parser
+//
+
+#include "Arena.h"
+#include "Semantics.h"
+
+NodeArena::~NodeArena() {
+    reset();
+    for (char *block : blocks) {
+        ::operator delete(block);
+    }
+}
+
+void NodeArena::reset() {
+    // Destroying in reverse order of creation, like the stack would
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        (*it)->~TypeNode();
+    }
+    nodes.clear();
+#ifdef HW3_ALLOC_PROFILE
+    for (auto &node : nodeClasses) {
+        profileRelease(node.first, node.second);
+    }
+    nodeClasses.clear();
+#endif
+    currentBlock = 0;
+    used = 0;
+}
+
+void *NodeArena::allocate(size_t size) {
+    // Keeping every node aligned like operator new would
+    size = (size + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+    if (blocks.empty() || used + size > BLOCK_SIZE) {
+        // The current block is full, moving on to the next one, which may be left over from before the last reset
+        if (!blocks.empty()) {
+            ++currentBlock;
+        }
+        if (currentBlock == blocks.size()) {
+            blocks.push_back(static_cast<char *>(::operator new(BLOCK_SIZE)));
+        }
+        used = 0;
+    }
+    void *memory = blocks[currentBlock] + used;
+    used += size;
+    return memory;
+}
@@ -0,0 +1,64 @@
+//
+// Bump allocator for the semantic values of the parser
+//
+
+#ifndef HW3_ARENA_H
+#define HW3_ARENA_H
+
+#include "AllocProfile.h"
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class TypeNode;
+
+// All the TypeNode objects created while parsing a function live in one arena
+// Nothing is freed one by one, reset() destroys every node at once when the function is closed,
+// and keeps the blocks so the next function reuses the same memory
+class NodeArena {
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    NodeArena() = default;
+
+    ~NodeArena();
+
+    NodeArena(const NodeArena &) = delete;
+
+    NodeArena &operator=(const NodeArena &) = delete;
+
+    template<class T, class... Args>
+    T *make(Args &&... args) {
+        static_assert(sizeof(T) <= BLOCK_SIZE, "node does not fit in an arena block");
+        T *node = new(allocate(sizeof(T))) T(std::forward<Args>(args)...);
+        nodes.push_back(node);
+#ifdef HW3_ALLOC_PROFILE
+        nodeClasses.push_back({profileClass<T>(), sizeof(T)});
+        profileAllocate(profileClass<T>(), sizeof(T));
+#endif
+        return node;
+    }
+
+    // Destroys every node allocated since the last reset
+    void reset();
+
+private:
+    vector<char *> blocks;
+    // The block currently being filled, and the number of bytes already used in it
+    size_t currentBlock = 0;
+    size_t used = 0;
+    // Every live node, so their destructors can run on reset
+    vector<TypeNode *> nodes;
+#ifdef HW3_ALLOC_PROFILE
+    // The profiled class and size of each node, released on reset
+    vector<pair<size_t, size_t>> nodeClasses;
+#endif
+
+    void *allocate(size_t size);
+};
+
+#endif //HW3_ARENA_H
@@ -0,0 +1,115 @@
+//
+// The syntax tree of a checked program, kept after the parse for the passes that run after the check
+//
+
+#include "Ast.h"
+
+#include <algorithm>
+
+static const char *const KIND_NAMES[] = {"program", "function", "formal", "block", "decl", "assign", "return", "if",
+                                         "while", "break", "continue", "switch", "case", "default", "call", "id",
+                                         "literal", "not", "binary", "and", "or"};
+
+static const char *const OP_NAMES[] = {"", "+", "-", "*", "/", "==", "!=", "<", ">", "<=", ">="};
+
+AstOp astOp(string_view token) {
+    for (int i = OP_ADD; i <= OP_GE; ++i) {
+        if (token == OP_NAMES[i]) {
+            return AstOp(i);
+        }
+    }
+    return OP_NONE;
+}
+
+size_t Ast::size() const {
+    return kind.size();
+}
+
+AstId Ast::add(AstKind nodeKind, TypeId nodeType, int nodeLine) {
+    AstId id = AstId(kind.size());
+    kind.push_back(nodeKind);
+    op.push_back(OP_NONE);
+    type.push_back(nodeType);
+    constant.push_back(false);
+    line.push_back(nodeLine);
+    name.push_back(NO_NAME);
+    value.push_back(0);
+    ref.push_back(NO_NODE);
+    firstChild.push_back(NO_NODE);
+    lastChild.push_back(NO_NODE);
+    nextSibling.push_back(NO_NODE);
+    return id;
+}
+
+void Ast::append(AstId parent, AstId child) {
+    if (parent == NO_NODE || child == NO_NODE) {
+        return;
+    }
+    if (lastChild[parent] == NO_NODE) {
+        firstChild[parent] = child;
+    } else {
+        nextSibling[lastChild[parent]] = child;
+    }
+    lastChild[parent] = child;
+}
+
+size_t Ast::depth() const {
+    if (root == NO_NODE) {
+        return 0;
+    }
+    // With an explicit stack, it sizes the stack of the passes that recurse
+    size_t deepest = 0;
+    vector<pair<AstId, size_t>> pending = {{root, 1}};
+    while (!pending.empty()) {
+        AstId node = pending.back().first;
+        size_t level = pending.back().second;
+        pending.pop_back();
+        deepest = max(deepest, level);
+        for (AstId child = firstChild[node]; child != NO_NODE; child = nextSibling[child]) {
+            pending.emplace_back(child, level + 1);
+        }
+    }
+    return deepest;
+}
+
+void Ast::dump(ostream &out) const {
+    if (root == NO_NODE) {
+        return;
+    }
+    // Depth first with an explicit stack, a deeply nested program must not overflow the call stack here
+    vector<pair<AstId, int>> pending = {{root, 0}};
+    while (!pending.empty()) {
+        AstId node = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+
+        out << string(size_t(depth) * 2, ' ') << KIND_NAMES[kind[node]];
+        if (op[node] != OP_NONE) {
+            out << " " << OP_NAMES[op[node]];
+        }
+        if (name[node] != NO_NAME) {
+            out << " " << names.get(name[node]);
+        }
+        if (type[node] != TYPE_NONE) {
+            out << " : " << typeName(type[node]);
+        }
+        if (kind[node] == AST_LITERAL && type[node] == TYPE_STRING) {
+            out << " " << strings[value[node]];
+        } else if (kind[node] == AST_FORMAL || kind[node] == AST_DECL) {
+            out << " @" << value[node];
+        } else if (kind[node] == AST_CASE || constant[node]) {
+            out << " = " << value[node];
+        }
+        if (ref[node] != NO_NODE) {
+            out << " -> " << ref[node];
+        }
+        out << "  #" << node << " line " << line[node] << "\n";
+
+        // Pushed in reverse, so the first child is printed first
+        size_t firstPending = pending.size();
+        for (AstId child = firstChild[node]; child != NO_NODE; child = nextSibling[child]) {
+            pending.emplace_back(child, depth + 1);
+        }
+        reverse(pending.begin() + firstPending, pending.end());
+    }
+}
@@ -0,0 +1,109 @@
+//
+// The syntax tree of a checked program, kept after the parse for the passes that run after the check
+//
+
+#ifndef HW3_AST_H
+#define HW3_AST_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Semantics.h"
+
+using namespace std;
+
+// What a node is, the layout of its children and the meaning of its columns depend on it
+enum AstKind : unsigned char {
+    AST_PROGRAM,     // children: the functions
+    AST_FUNCTION,    // name, type is the return type, children: the parameters, then the statements of the body
+    AST_FORMAL,      // name, type, value is the offset
+    AST_BLOCK,       // children: the statements
+    AST_DECL,        // name, type, value is the offset, children: the initial value if any
+    AST_ASSIGN,      // name, ref is the declaration, children: the value
+    AST_RETURN,      // children: the value if any
+    AST_IF,          // children: the condition, the statement, the else statement if any
+    AST_WHILE,       // children: the condition, the statement
+    AST_BREAK,
+    AST_CONTINUE,
+    AST_SWITCH,      // children: the value, then the cases and the default
+    AST_CASE,        // value is the label, children: the statements
+    AST_DEFAULT,     // children: the statements
+    AST_CALL,        // name, type is the return type, ref is the function, children: the arguments
+    AST_ID,          // name, type, ref is the declaration
+    AST_LITERAL,     // type, value is the number, 0 or 1 for a bool, the index in Ast::strings for a string
+    AST_NOT,         // children: the operand
+    AST_BINARY,      // op, children: the two operands
+    AST_AND,         // children: the two operands
+    AST_OR           // children: the two operands
+};
+
+enum AstOp : unsigned char {
+    OP_NONE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_GT,
+    OP_LE,
+    OP_GE
+};
+
+// The operator of a binary operator token ("+", "<=", ...)
+AstOp astOp(string_view token);
+
+// Every node is an index, and every field of the nodes is a column, a vector with one entry per node
+// A pass reads only the columns it needs, in node order, and the tree is a few flat vectors instead of a heap
+// object per node
+// Children are linked by index: firstChild of the parent, then nextSibling of each child
+// Nodes are numbered in the order the parser reduces them, so every child is numbered before its parent,
+// except the children of a function and of the program, which are created before their children are parsed
+class Ast {
+public:
+    vector<AstKind> kind;
+    vector<AstOp> op;
+    // The checked type of an expression, the declared type of a variable, the return type of a function
+    vector<TypeId> type;
+    // Set when the value of an expression is known at check time, see Exp::isConstant
+    vector<bool> constant;
+    vector<int> line;
+    vector<NameId> name;
+    // A literal, an offset, a case label, or the folded value of a constant expression (see AstKind)
+    vector<int> value;
+    // The declaration a name refers to, NO_NODE for print, printi, and names that are not declared
+    vector<AstId> ref;
+    vector<AstId> firstChild;
+    vector<AstId> lastChild;
+    vector<AstId> nextSibling;
+
+    // The names of every name column, moved here from the context when the check is done
+    NameTable names;
+    // The text of the string literals, with the quotes
+    vector<string> strings;
+    // The AST_PROGRAM node, 0 once a program was parsed
+    AstId root = NO_NODE;
+
+    Ast() = default;
+
+    Ast(const Ast &) = delete;
+
+    Ast &operator=(const Ast &) = delete;
+
+    size_t size() const;
+
+    AstId add(AstKind nodeKind, TypeId nodeType, int nodeLine);
+
+    // Makes child the last child of parent, nothing happens if either of them is NO_NODE
+    void append(AstId parent, AstId child);
+
+    // Prints the tree as indented lines, one node per line, for debugging and for the tests
+    void dump(ostream &out) const;
+
+    // The most nodes on a path from the root down, how deep a pass recursing over the tree nests, 0 for no tree
+    size_t depth() const;
+};
+
+#endif //HW3_AST_H
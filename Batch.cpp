@@ -0,0 +1,180 @@
+//
+// Checking many programs at once, on every core
+//
+
+#include "Batch.h"
+#include "Checker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(unsigned workers) : workers(workers ? workers : 1) {
+
+}
+
+bool WorkStealingPool::popFront(Queue &queue, size_t &task) {
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool WorkStealingPool::popBack(Queue &queue, size_t &task) {
+    lock_guard<mutex> guard(queue.lock);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+void WorkStealingPool::run(size_t count, const function<void(size_t)> &task) {
+    unsigned threads = (unsigned) min<size_t>(workers, max<size_t>(count, 1));
+    vector<unique_ptr<Queue>> queues;
+    for (unsigned w = 0; w < threads; ++w) {
+        queues.push_back(make_unique<Queue>());
+    }
+    // Contiguous shares keep each worker close to input order, which keeps the ordered stream flowing
+    for (size_t i = 0; i < count; ++i) {
+        queues[i * threads / count]->tasks.push_back(i);
+    }
+
+    auto work = [&](unsigned self) {
+        size_t current;
+        for (;;) {
+            if (popFront(*queues[self], current)) {
+                task(current);
+                continue;
+            }
+            // No task is ever added after the start, so once every queue is empty the work is done
+            bool stolen = false;
+            for (unsigned k = 1; k < threads && !stolen; ++k) {
+                stolen = popBack(*queues[(self + k) % threads], current);
+            }
+            if (!stolen) {
+                return;
+            }
+            task(current);
+        }
+    };
+
+    vector<thread> pool;
+    for (unsigned w = 1; w < threads; ++w) {
+        pool.emplace_back(work, w);
+    }
+    work(0);
+    for (auto &t : pool) {
+        t.join();
+    }
+}
+
+vector<string> collectBatchFiles(const vector<string> &paths) {
+    vector<string> files;
+    for (auto &path : paths) {
+        error_code error;
+        if (!filesystem::is_directory(path, error)) {
+            files.push_back(path);
+            continue;
+        }
+        vector<string> inDirectory;
+        for (auto &entry : filesystem::directory_iterator(path, error)) {
+            if (entry.is_regular_file(error) && entry.path().extension() == ".in") {
+                inDirectory.push_back(entry.path().string());
+            }
+        }
+        sort(inDirectory.begin(), inDirectory.end());
+        files.insert(files.end(), inDirectory.begin(), inDirectory.end());
+    }
+    return files;
+}
+
+// t1.in -> t1.res, the name the test scripts compare against t1.out
+static string resultPath(const string &file) {
+    filesystem::path path(file);
+    if (path.extension() == ".in") {
+        path.replace_extension(".res");
+        return path.string();
+    }
+    return file + ".res";
+}
+
+static bool writeFile(const string &file, const string &text) {
+    ofstream out(file, ios::binary | ios::trunc);
+    out.write(text.data(), text.size());
+    return bool(out);
+}
+
+int runBatch(const BatchOptions &options) {
+    vector<string> files = collectBatchFiles(options.paths);
+    unsigned jobs = options.jobs ? options.jobs : thread::hardware_concurrency();
+    if (!jobs) {
+        jobs = 1;
+    }
+
+    // For the ordered stream, finished outputs wait here until every file before them was written
+    vector<string> outputs(options.stream ? files.size() : 0);
+    vector<char> finished(outputs.size(), 0);
+    size_t nextToWrite = 0;
+    mutex streamLock;
+
+    atomic<size_t> totalBytes(0);
+    atomic<int> failures(0);
+    mutex errorLock;
+    auto report = [&](const string &message) {
+        lock_guard<mutex> guard(errorLock);
+        cerr << message << endl;
+        failures++;
+    };
+
+    auto start = chrono::steady_clock::now();
+    WorkStealingPool pool(jobs);
+    pool.run(files.size(), [&](size_t i) {
+        MappedFile input;
+        output::StringSink sink;
+        if (input.open(files[i])) {
+            totalBytes += input.size();
+            check(input, sink);
+        } else {
+            // A file that cannot be read is checked as an empty program, so the stream keeps one entry per file
+            report("cannot read " + files[i]);
+            check("", 0, sink);
+        }
+        input.close();
+
+        if (!options.stream) {
+            if (!writeFile(resultPath(files[i]), sink.text)) {
+                report("cannot write " + resultPath(files[i]));
+            }
+            return;
+        }
+        lock_guard<mutex> guard(streamLock);
+        outputs[i] = std::move(sink.text);
+        finished[i] = 1;
+        while (nextToWrite < files.size() && finished[nextToWrite]) {
+            fwrite(outputs[nextToWrite].data(), 1, outputs[nextToWrite].size(), stdout);
+            string().swap(outputs[nextToWrite]);
+            nextToWrite++;
+        }
+    });
+    fflush(stdout);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double megabytes = totalBytes / (1024.0 * 1024.0);
+    char line[256];
+    snprintf(line, sizeof(line), "checked %zu files (%.2f MB) in %.3f s with %u jobs: %.1f files/s, %.2f MB/s",
+             files.size(), megabytes, seconds, jobs, seconds > 0 ? files.size() / seconds : 0.0,
+             seconds > 0 ? megabytes / seconds : 0.0);
+    cerr << line << endl;
+    return failures ? 1 : 0;
+}
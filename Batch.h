@@ -0,0 +1,57 @@
+//
+// Checking many programs at once, on every core
+//
+
+#ifndef HW3_BATCH_H
+#define HW3_BATCH_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Runs a fixed set of tasks on a few threads
+// Each worker starts with a contiguous share of the tasks and takes them from the front of its own deque,
+// a worker that runs out steals from the back of another one, so a few slow programs do not leave cores idle
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned workers);
+
+    // Calls task(i) once for every i in [0, count), returns when all the calls are done
+    void run(size_t count, const function<void(size_t)> &task);
+
+private:
+    class Queue {
+    public:
+        mutex lock;
+        deque<size_t> tasks;
+    };
+
+    unsigned workers;
+
+    static bool popFront(Queue &queue, size_t &task);
+
+    static bool popBack(Queue &queue, size_t &task);
+};
+
+class BatchOptions {
+public:
+    vector<string> paths;
+    // 0 is one worker per core
+    unsigned jobs = 0;
+    // Write all the outputs to stdout in input order, instead of a .res file next to each input
+    bool stream = false;
+};
+
+// The program files of a batch, a directory stands for all the .in files in it, in name order
+vector<string> collectBatchFiles(const vector<string> &paths);
+
+// Checks every file, the output of each file is byte-identical to "hw3 < file"
+// Prints the throughput to stderr, returns 1 if some file could not be read or written
+int runBatch(const BatchOptions &options);
+
+#endif //HW3_BATCH_H
@@ -0,0 +1,393 @@
+//
+// Register bytecode of a checked program, compiled from its syntax tree and run by Vm.h
+//
+
+#include "Bytecode.h"
+
+#include <algorithm>
+
+static const char *const OPCODE_NAMES[BC_OPCODE_COUNT] = {"const", "move", "add", "sub", "mul", "div", "trunc", "eq",
+                                                          "ne", "lt", "gt", "le", "ge", "not", "jump", "jump_false",
+                                                          "jump_true", "jump_case", "call", "return", "return_void",
+                                                          "print", "printi"};
+
+// Compiles one function at a time
+// Expressions are compiled to the register holding their value: a variable is read from its own register, and
+// every other value goes to a temporary, allocated like a stack above the locals and freed after each statement
+class BytecodeCompiler {
+public:
+    BytecodeCompiler(const Ast &ast, Module &module) : ast(ast), module(module), functionIndex(ast.size(), -1) {
+
+    }
+
+    void compile() {
+        if (ast.root == NO_NODE) {
+            return;
+        }
+        // Calls only refer to functions declared before them (or to themselves), but the indices are known up front
+        for (AstId func = ast.firstChild[ast.root]; func != NO_NODE; func = ast.nextSibling[func]) {
+            functionIndex[func] = int32_t(module.functions.size());
+            BytecodeFunction function;
+            function.name = string(ast.names.get(ast.name[func]));
+            if (function.name == "main") {
+                module.main = functionIndex[func];
+            }
+            module.functions.push_back(std::move(function));
+        }
+        for (AstId func = ast.firstChild[ast.root]; func != NO_NODE; func = ast.nextSibling[func]) {
+            compileFunction(func);
+        }
+    }
+
+private:
+    // What break and continue jump to
+    class JumpTarget {
+    public:
+        bool loop;
+        int32_t continueTarget;
+        // The jumps of the break statements, patched once the end is known
+        vector<size_t> breaks;
+    };
+
+    const Ast &ast;
+    Module &module;
+    vector<int32_t> functionIndex;
+    vector<JumpTarget> targets;
+    int32_t params = 0;
+    int32_t firstTemp = 0;
+    int32_t nextTemp = 0;
+    int32_t frameSize = 0;
+
+    size_t emit(Opcode op, int32_t a = 0, int32_t b = 0, int32_t c = 0) {
+        module.code.push_back(Instruction{op, a, b, c});
+        return module.code.size() - 1;
+    }
+
+    int32_t here() const {
+        return int32_t(module.code.size());
+    }
+
+    // Makes the jump at index go to the next instruction
+    void patch(size_t index) {
+        Instruction &jump = module.code[index];
+        if (jump.op == BC_JUMP) {
+            jump.a = here();
+        } else if (jump.op == BC_JUMP_CASE) {
+            jump.c = here();
+        } else {
+            jump.b = here();
+        }
+    }
+
+    int32_t temp() {
+        frameSize = max(frameSize, nextTemp + 1);
+        return nextTemp++;
+    }
+
+    // Where a value goes, the register asked for by the caller if any, a new temporary otherwise
+    int32_t result(int32_t preferred) {
+        return preferred >= 0 ? preferred : temp();
+    }
+
+    // The register of a parameter or a local, from its offset
+    int32_t variable(AstId declaration) const {
+        int32_t offset = ast.value[declaration];
+        return offset < 0 ? -offset - 1 : params + offset;
+    }
+
+    // The locals are found before the body is compiled, so that the temporaries can start right after them
+    int32_t countLocals(AstId func) const {
+        int32_t locals = 0;
+        vector<AstId> pending = {func};
+        while (!pending.empty()) {
+            AstId node = pending.back();
+            pending.pop_back();
+            if (ast.kind[node] == AST_DECL) {
+                locals = max(locals, ast.value[node] + 1);
+            }
+            for (AstId child = ast.firstChild[node]; child != NO_NODE; child = ast.nextSibling[child]) {
+                pending.push_back(child);
+            }
+        }
+        return locals;
+    }
+
+    void compileFunction(AstId func) {
+        BytecodeFunction &function = module.functions[functionIndex[func]];
+        function.entry = here();
+        params = 0;
+        for (AstId child = ast.firstChild[func]; child != NO_NODE && ast.kind[child] == AST_FORMAL;
+             child = ast.nextSibling[child]) {
+            params++;
+        }
+        function.params = params;
+        function.locals = countLocals(func);
+        firstTemp = nextTemp = frameSize = params + function.locals;
+
+        for (AstId child = ast.firstChild[func]; child != NO_NODE; child = ast.nextSibling[child]) {
+            if (ast.kind[child] != AST_FORMAL) {
+                statement(child);
+            }
+        }
+        // Falling off the end of a function that returns a value returns 0
+        if (ast.type[func] == TYPE_VOID) {
+            emit(BC_RETURN_VOID);
+        } else {
+            int32_t zero = temp();
+            emit(BC_CONST, zero, 0);
+            emit(BC_RETURN, zero);
+        }
+        nextTemp = firstTemp;
+        module.functions[functionIndex[func]].frameSize = frameSize;
+    }
+
+    void statements(AstId parent) {
+        for (AstId child = ast.firstChild[parent]; child != NO_NODE; child = ast.nextSibling[child]) {
+            statement(child);
+        }
+    }
+
+    // Stores value to a variable of the given type, an int assigned to a byte is truncated
+    void store(int32_t target, TypeId targetType, AstId value) {
+        int32_t source = expression(value, target);
+        if (source != target) {
+            emit(BC_MOVE, target, source);
+        }
+        if (targetType == TYPE_BYTE && ast.type[value] != TYPE_BYTE) {
+            emit(BC_TRUNC, target);
+        }
+    }
+
+    void statement(AstId node) {
+        AstId first = ast.firstChild[node];
+        switch (ast.kind[node]) {
+            case AST_BLOCK:
+                statements(node);
+                break;
+            case AST_DECL:
+                // A declaration in a loop runs again on each iteration, and starts again from 0
+                if (first == NO_NODE) {
+                    emit(BC_CONST, variable(node), 0);
+                } else {
+                    store(variable(node), ast.type[node], first);
+                }
+                break;
+            case AST_ASSIGN:
+                store(variable(ast.ref[node]), ast.type[node], first);
+                break;
+            case AST_RETURN:
+                if (first == NO_NODE) {
+                    emit(BC_RETURN_VOID);
+                } else {
+                    emit(BC_RETURN, expression(first));
+                }
+                break;
+            case AST_CALL:
+                expression(node);
+                break;
+            case AST_IF: {
+                size_t skipThen = emit(BC_JUMP_FALSE, expression(first));
+                nextTemp = firstTemp;
+                AstId thenStatement = ast.nextSibling[first];
+                statement(thenStatement);
+                AstId elseStatement = ast.nextSibling[thenStatement];
+                if (elseStatement == NO_NODE) {
+                    patch(skipThen);
+                } else {
+                    size_t skipElse = emit(BC_JUMP);
+                    patch(skipThen);
+                    statement(elseStatement);
+                    patch(skipElse);
+                }
+                break;
+            }
+            case AST_WHILE: {
+                int32_t top = here();
+                size_t exit = emit(BC_JUMP_FALSE, expression(first));
+                nextTemp = firstTemp;
+                targets.push_back(JumpTarget{true, top, {}});
+                statement(ast.nextSibling[first]);
+                emit(BC_JUMP, top);
+                patch(exit);
+                patchBreaks();
+                break;
+            }
+            case AST_SWITCH:
+                switchStatement(node);
+                break;
+            case AST_BREAK:
+                targets.back().breaks.push_back(emit(BC_JUMP));
+                break;
+            case AST_CONTINUE:
+                // The innermost loop, a switch has nothing to continue
+                for (auto target = targets.rbegin(); target != targets.rend(); ++target) {
+                    if (target->loop) {
+                        emit(BC_JUMP, target->continueTarget);
+                        break;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        nextTemp = firstTemp;
+    }
+
+    void patchBreaks() {
+        for (size_t jump : targets.back().breaks) {
+            patch(jump);
+        }
+        targets.pop_back();
+    }
+
+    // The value is compared to each label in turn, then the bodies follow each other in the order of the program,
+    // so a case without a break falls through to the next one
+    void switchStatement(AstId node) {
+        AstId valueNode = ast.firstChild[node];
+        int32_t value = expression(valueNode);
+        vector<size_t> caseJumps;
+        AstId defaultNode = NO_NODE;
+        for (AstId child = ast.nextSibling[valueNode]; child != NO_NODE; child = ast.nextSibling[child]) {
+            if (ast.kind[child] == AST_CASE) {
+                caseJumps.push_back(emit(BC_JUMP_CASE, value, ast.value[child]));
+            } else {
+                defaultNode = child;
+            }
+        }
+        size_t noCase = emit(BC_JUMP);
+        nextTemp = firstTemp;
+        targets.push_back(JumpTarget{false, 0, {}});
+        size_t caseIndex = 0;
+        for (AstId child = ast.nextSibling[valueNode]; child != NO_NODE; child = ast.nextSibling[child]) {
+            if (child == defaultNode) {
+                patch(noCase);
+            } else {
+                patch(caseJumps[caseIndex++]);
+            }
+            statements(child);
+        }
+        if (defaultNode == NO_NODE) {
+            patch(noCase);
+        }
+        patchBreaks();
+    }
+
+    // Returns the register holding the value, which is preferred if it is not -1 and the value is computed
+    // there, the caller moves it otherwise
+    int32_t expression(AstId node, int32_t preferred = -1) {
+        AstKind kind = ast.kind[node];
+        // A constant, already folded by the checker (see Exp::isConstant)
+        if (ast.constant[node] && kind != AST_CALL) {
+            int32_t target = result(preferred);
+            emit(BC_CONST, target, ast.value[node]);
+            return target;
+        }
+        switch (kind) {
+            case AST_ID:
+                return variable(ast.ref[node]);
+            case AST_LITERAL: {
+                int32_t target = result(preferred);
+                if (ast.type[node] == TYPE_STRING) {
+                    string_view text = ast.strings[ast.value[node]];
+                    emit(BC_CONST, target, int32_t(module.strings.size()));
+                    module.strings.emplace_back(text.substr(1, text.size() - 2));
+                } else {
+                    // Only an int literal above the int range is not constant, it is never a valid value anyway
+                    emit(BC_CONST, target, ast.value[node]);
+                }
+                return target;
+            }
+            case AST_NOT: {
+                int32_t mark = nextTemp;
+                int32_t operand = expression(ast.firstChild[node]);
+                nextTemp = mark;
+                int32_t target = result(preferred);
+                emit(BC_NOT, target, operand);
+                return target;
+            }
+            case AST_AND:
+            case AST_OR: {
+                // Short circuit, the right operand is only computed when the left one does not decide
+                // Never computed in the preferred register, the right operand may read the variable it is
+                int32_t target = temp();
+                AstId left = ast.firstChild[node];
+                int32_t leftValue = expression(left);
+                emit(BC_MOVE, target, leftValue);
+                size_t skip = emit(kind == AST_AND ? BC_JUMP_FALSE : BC_JUMP_TRUE, target);
+                nextTemp = target + 1;
+                int32_t rightValue = expression(ast.nextSibling[left]);
+                emit(BC_MOVE, target, rightValue);
+                patch(skip);
+                nextTemp = target + 1;
+                return target;
+            }
+            case AST_BINARY:
+                return binary(node, preferred);
+            case AST_CALL:
+                return call(node, preferred);
+            default:
+                return temp();
+        }
+    }
+
+    // Both operands are read before the result is written, so the result can go to a variable one of them is
+    int32_t binary(AstId node, int32_t preferred) {
+        static const Opcode OPCODES[] = {BC_ADD, BC_ADD, BC_SUB, BC_MUL, BC_DIV, BC_EQ, BC_NE, BC_LT, BC_GT, BC_LE,
+                                         BC_GE};
+        int32_t mark = nextTemp;
+        AstId left = ast.firstChild[node];
+        int32_t leftValue = expression(left);
+        int32_t rightValue = expression(ast.nextSibling[left]);
+        nextTemp = mark;
+        int32_t target = result(preferred);
+        emit(OPCODES[ast.op[node]], target, leftValue, rightValue);
+        if (ast.type[node] == TYPE_BYTE) {
+            emit(BC_TRUNC, target);
+        }
+        return target;
+    }
+
+    int32_t call(AstId node, int32_t preferred) {
+        if (ast.ref[node] == NO_NODE) {
+            // print and printi, their one argument is read from any register and they return nothing
+            int32_t value = expression(ast.firstChild[node]);
+            emit(ast.names.get(ast.name[node]) == "print" ? BC_PRINT : BC_PRINTI, value);
+            return value;
+        }
+        // The arguments go to consecutive temporaries, the callee frame starts with a copy of them
+        int32_t first = nextTemp;
+        int32_t count = 0;
+        for (AstId arg = ast.firstChild[node]; arg != NO_NODE; arg = ast.nextSibling[arg]) {
+            int32_t value = expression(arg);
+            nextTemp = first + count;
+            int32_t slot = temp();
+            if (value != slot) {
+                emit(BC_MOVE, slot, value);
+            }
+            count++;
+        }
+        nextTemp = first;
+        int32_t target = result(preferred);
+        emit(BC_CALL, target, functionIndex[ast.ref[node]], first);
+        return target;
+    }
+};
+
+Module compileProgram(const Ast &ast) {
+    Module module;
+    BytecodeCompiler(ast, module).compile();
+    return module;
+}
+
+void Module::dump(ostream &out) const {
+    for (const BytecodeFunction &function : functions) {
+        out << function.name << ": params " << function.params << ", locals " << function.locals << ", frame "
+            << function.frameSize << "\n";
+        size_t end = &function == &functions.back() ? code.size() : size_t((&function + 1)->entry);
+        for (size_t i = size_t(function.entry); i < end; ++i) {
+            const Instruction &instruction = code[i];
+            out << "  " << i << "  " << OPCODE_NAMES[instruction.op] << " " << instruction.a << " " << instruction.b
+                << " " << instruction.c << "\n";
+        }
+    }
+}
@@ -0,0 +1,84 @@
+//
+// Register bytecode of a checked program, compiled from its syntax tree and run by Vm.h
+//
+
+#ifndef HW3_BYTECODE_H
+#define HW3_BYTECODE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Ast.h"
+
+using namespace std;
+
+// Every operand is a register of the current frame, a constant, or the index of an instruction, see each opcode
+// The order is the order of the dispatch table of the VM
+enum Opcode : uint8_t {
+    BC_CONST,           // a = b
+    BC_MOVE,            // a = register b
+    BC_ADD,             // a = b + c, wrapping around at 32 bits like every int operation
+    BC_SUB,             // a = b - c
+    BC_MUL,             // a = b * c
+    BC_DIV,             // a = b / c, stops the program with an error if c is 0
+    BC_TRUNC,           // a = a modulo 256, after an operation on bytes
+    BC_EQ,              // a = b == c
+    BC_NE,              // a = b != c
+    BC_LT,              // a = b < c
+    BC_GT,              // a = b > c
+    BC_LE,              // a = b <= c
+    BC_GE,              // a = b >= c
+    BC_NOT,             // a = !b
+    BC_JUMP,            // goes to instruction a
+    BC_JUMP_FALSE,      // goes to instruction b if a is 0
+    BC_JUMP_TRUE,       // goes to instruction b if a is not 0
+    BC_JUMP_CASE,       // goes to instruction c if a == b, b is a constant
+    BC_CALL,            // a = function b called with the registers c, c + 1, ... as its parameters
+    BC_RETURN,          // returns a
+    BC_RETURN_VOID,
+    BC_PRINT,           // prints the string literal a is the index of
+    BC_PRINTI,          // prints a
+    BC_OPCODE_COUNT
+};
+
+class Instruction {
+public:
+    Opcode op;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+// The registers of a frame are the parameters, then the locals at their offset (see Statement), then the temporaries
+class BytecodeFunction {
+public:
+    string name;
+    int32_t params = 0;
+    // One more than the highest offset of a local, the parameters have negative offsets
+    int32_t locals = 0;
+    // Every register of a frame, the frame stack of the VM grows by this much for each call
+    int32_t frameSize = 0;
+    // The first instruction
+    int32_t entry = 0;
+};
+
+class Module {
+public:
+    // Every function, in the order of the program
+    vector<BytecodeFunction> functions;
+    // The instructions of every function, each function ends with a return
+    vector<Instruction> code;
+    // The string literals without the quotes
+    vector<string> strings;
+    // The index of main, -1 if the program has none
+    int32_t main = -1;
+
+    // Prints the instructions of each function, for debugging
+    void dump(ostream &out) const;
+};
+
+// Compiles every function of a program that passed the check
+Module compileProgram(const Ast &ast);
+
+#endif //HW3_BYTECODE_H
@@ -0,0 +1,92 @@
+//
+// Library entry point of the semantic checker
+//
+
+#include "Checker.h"
+#include "Semantics.h"
+
+// Forwards everything to another sink and remembers the diagnostic for the result
+class DiagnosticRecorder : public output::Sink {
+public:
+    output::Sink &target;
+    string diagnosticText;
+
+    explicit DiagnosticRecorder(output::Sink &target) : target(target) {
+
+    }
+
+    void write(const char *data, size_t size) override {
+        target.write(data, size);
+    }
+
+    void diagnostic(const char *data, size_t size) override {
+        if (diagnosticText.empty()) {
+            diagnosticText.assign(data, size);
+        }
+        target.diagnostic(data, size);
+    }
+
+    void flush() override {
+        target.flush();
+    }
+};
+
+// Runs parse over a fresh context, a CheckError becomes the diagnostic of the result
+// The syntax tree is built in ast when it is not null
+template<typename Parse>
+static CheckResult checkWith(output::Sink &sink, Parse parse, const CheckOptions &options, Ast *ast = nullptr) {
+    PROFILE_PHASE(PHASE_CHECK);
+    CheckResult result;
+    // The records go between the recorder and the sink, so the result still gets the diagnostic as text
+    unique_ptr<SymbolRecordWriter> symbolRecords;
+    if (options.symbols != SYMBOLS_TEXT) {
+        symbolRecords = make_unique<SymbolRecordWriter>(sink, options.symbols);
+    }
+    DiagnosticRecorder recorder(symbolRecords ? *symbolRecords : sink);
+    CheckerContext ctx(recorder);
+    ctx.ast = ast;
+    ctx.maxParserDepth = options.maxParserDepth;
+    ctx.symbolRecords = symbolRecords.get();
+    ctx.prelude = options.prelude;
+    try {
+        parse(&ctx);
+    } catch (const CheckError &) {
+        result.ok = false;
+        result.diagnostic = recorder.diagnosticText;
+        if (!result.diagnostic.empty() && result.diagnostic.back() == '\n') {
+            result.diagnostic.pop_back();
+        }
+    }
+    result.stats = ctx.stats;
+    result.parserDepth = ctx.parserValues.size();
+    if (ast) {
+        // The name columns of the tree are ids of the context names
+        ast->names = std::move(ctx.names);
+    }
+    return result;
+}
+
+CheckResult check(const char *data, size_t size, output::Sink &sink, const CheckOptions &options) {
+    return checkWith(sink, [&](CheckerContext *ctx) {
+        parseProgram(ctx, data, size);
+    }, options);
+}
+
+CheckResult check(MappedFile &input, output::Sink &sink, const CheckOptions &options) {
+    return checkWith(sink, [&](CheckerContext *ctx) {
+        parseProgramInPlace(ctx, input.data(), input.size());
+    }, options);
+}
+
+CheckResult check(const char *data, size_t size, output::Sink &sink, Ast &ast, const CheckOptions &options) {
+    return checkWith(sink, [&](CheckerContext *ctx) {
+        parseProgram(ctx, data, size);
+    }, options, &ast);
+}
+
+CheckResult check(const string &program) {
+    output::StringSink sink;
+    CheckResult result = check(program.data(), program.size(), sink);
+    result.output = std::move(sink.text);
+    return result;
+}
@@ -0,0 +1,60 @@
+//
+// Library entry point of the semantic checker
+//
+
+#ifndef HW3_CHECKER_H
+#define HW3_CHECKER_H
+
+#include <string>
+#include "hw3_output.hpp"
+#include "Ast.h"
+#include "MappedFile.h"
+#include "Stats.h"
+#include "SymbolRecords.h"
+
+using namespace std;
+
+// The outcome of checking one program
+class CheckResult {
+public:
+    // True if the program has no lexical, syntax or semantic error
+    bool ok = true;
+    // The error line exactly as the checker prints it (without the newline), empty if ok
+    string diagnostic;
+    // The scope dumps and the error line, only filled by check(const string &)
+    string output;
+    // The hot-path counters of the check, all 0 unless built with HW3_STATS
+    CheckStats stats;
+    // The entries the parser stacks grew to, 0 if the arrays bison starts with were deep enough
+    size_t parserDepth = 0;
+};
+
+class Prelude;
+
+// How a program is checked, the defaults are those of the graded runs
+class CheckOptions {
+public:
+    // A program nested deeper than this many parser stack entries fails with a "nested too deeply" diagnostic
+    size_t maxParserDepth = DEFAULT_MAX_PARSER_DEPTH;
+    // The closed scopes are written as scope dumps, or as the records of SymbolRecords.h
+    SymbolFormat symbols = SYMBOLS_TEXT;
+    // The functions of a precompiled prelude are declared before the program when set, not owned (see Prelude.h)
+    const Prelude *prelude = nullptr;
+};
+
+// Checks a whole program and keeps everything it prints in the result
+CheckResult check(const string &program);
+
+// Checks a whole program and streams what it prints to sink, the sink is not flushed
+// Nothing is shared between two calls, so programs can be checked from several threads at once
+CheckResult check(const char *data, size_t size, output::Sink &sink, const CheckOptions &options = CheckOptions());
+
+// Same, but scans the mapped file in place, the tokens view the mapping instead of a copy of the program
+CheckResult check(MappedFile &input, output::Sink &sink, const CheckOptions &options = CheckOptions());
+
+// Same as check(data, size, sink), and keeps the syntax tree of the program in ast, which must be empty
+// The tree is only complete if the result is ok, a failed check leaves the nodes built before the error
+CheckResult check(const char *data, size_t size, output::Sink &sink, Ast &ast,
+                  const CheckOptions &options = CheckOptions());
+
+#endif //HW3_CHECKER_H
@@ -0,0 +1,347 @@
+//
+// Incremental checking, unchanged functions are replayed from an on-disk cache instead of being checked again
+//
+
+#include "Incremental.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+// Scans a string token the way the scanner does, returns its size, or 0 if the quote does not start a string
+static size_t stringTokenSize(string_view text, size_t start) {
+    size_t pos = start + 1;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '"') {
+            // An empty string is not a token
+            return pos > start + 1 ? pos + 1 - start : 0;
+        }
+        if (c == '\n' || c == '\r') {
+            return 0;
+        }
+        if (c == '\\') {
+            if (pos + 1 < text.size() && text[pos + 1] != '\0' && strchr("rnt\"\\", text[pos + 1])) {
+                pos += 2;
+                continue;
+            }
+            return 0;
+        }
+        pos++;
+    }
+    return 0;
+}
+
+bool splitFunctions(string_view program, vector<FunctionChunk> &chunks) {
+    chunks.clear();
+    size_t chunkStart = 0;
+    int chunkLine = 1;
+    int line = 1;
+    int depth = 0;
+    // Something else than whitespace and comments since the end of the last function
+    bool pending = false;
+    size_t pos = 0;
+    while (pos < program.size()) {
+        char c = program[pos];
+        if (c == '\n') {
+            line++;
+            pos++;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            pos++;
+        } else if (c == '/' && pos + 1 < program.size() && program[pos + 1] == '/') {
+            while (pos < program.size() && program[pos] != '\n' && program[pos] != '\r') {
+                pos++;
+            }
+        } else if (c == '"') {
+            // A quote that does not start a string is a lexical error, the chunk holding it reports it
+            size_t size = stringTokenSize(program, pos);
+            pos += size ? size : 1;
+            pending = true;
+        } else if (c == '{') {
+            depth++;
+            pos++;
+            pending = true;
+        } else if (c == '}') {
+            depth--;
+            pos++;
+            if (depth < 0) {
+                return false;
+            }
+            if (depth == 0) {
+                chunks.push_back({chunkStart, pos - chunkStart, chunkLine});
+                chunkStart = pos;
+                chunkLine = line;
+                pending = false;
+            }
+        } else {
+            pos++;
+            pending = true;
+        }
+    }
+    return depth == 0 && !pending;
+}
+
+// FNV-1a, stable across builds and machines, unlike std::hash
+static uint64_t hashBytes(string_view bytes, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashDecl(uint64_t fingerprint, string_view name, const Signature &signature) {
+    fingerprint = hashBytes(name, fingerprint);
+    string types(signature.params.begin(), signature.params.end());
+    types.push_back(char(signature.ret));
+    // The size keeps "f" + (INT) apart from "fI" + ()
+    types.push_back(char(signature.params.size()));
+    return hashBytes(types, hashBytes(string_view("\0", 1), fingerprint));
+}
+
+FunctionCache::FunctionCache(string directory) : directory(std::move(directory)) {
+    error_code error;
+    filesystem::create_directories(this->directory, error);
+}
+
+string FunctionCache::entryPath(uint64_t fingerprint, string_view text) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.fn", (unsigned long long) hashBytes(text, fingerprint));
+    return directory + "/" + name;
+}
+
+// Entries are a header line, then numbers each on its own line, and blobs as their size line followed by the bytes
+static const char ENTRY_HEADER[] = "hw3-function-cache 1\n";
+
+static void writeNumber(string &entry, uint64_t number) {
+    entry.append(to_string(number)).push_back('\n');
+}
+
+static void writeBlob(string &entry, string_view blob) {
+    writeNumber(entry, blob.size());
+    entry.append(blob.data(), blob.size());
+}
+
+class EntryReader {
+public:
+    string_view entry;
+    size_t pos = 0;
+    bool ok = true;
+
+    uint64_t number() {
+        size_t end = entry.find('\n', pos);
+        if (!ok || end == string_view::npos || end == pos) {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = pos; i < end; ++i) {
+            if (entry[i] < '0' || entry[i] > '9') {
+                ok = false;
+                return 0;
+            }
+            value = value * 10 + (entry[i] - '0');
+        }
+        pos = end + 1;
+        return value;
+    }
+
+    string_view blob() {
+        uint64_t size = number();
+        if (!ok || size > entry.size() - pos) {
+            ok = false;
+            return string_view();
+        }
+        string_view bytes = entry.substr(pos, size);
+        pos += size;
+        return bytes;
+    }
+};
+
+bool FunctionCache::load(uint64_t fingerprint, string_view text, FunctionResult &result) {
+    ifstream in(entryPath(fingerprint, text), ios::binary);
+    if (!in) {
+        misses++;
+        return false;
+    }
+    string entry((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    EntryReader reader{entry};
+    bool valid = entry.compare(0, sizeof(ENTRY_HEADER) - 1, ENTRY_HEADER) == 0;
+    reader.pos = sizeof(ENTRY_HEADER) - 1;
+    valid = valid && reader.number() == fingerprint && reader.blob() == text;
+    FunctionResult loaded;
+    loaded.ok = reader.number() == 1;
+    uint64_t declared = reader.number();
+    for (uint64_t i = 0; valid && reader.ok && i < declared; ++i) {
+        GlobalDecl decl;
+        decl.name = string(reader.blob());
+        decl.ret = TypeId(reader.number());
+        uint64_t params = reader.number();
+        for (uint64_t p = 0; reader.ok && p < params; ++p) {
+            decl.params.push_back(TypeId(reader.number()));
+        }
+        loaded.declared.push_back(std::move(decl));
+    }
+    loaded.output = string(reader.blob());
+    loaded.diagnostic = string(reader.blob());
+    if (!valid || !reader.ok) {
+        misses++;
+        return false;
+    }
+    hits++;
+    result = std::move(loaded);
+    return true;
+}
+
+void FunctionCache::store(uint64_t fingerprint, string_view text, const FunctionResult &result) {
+    string entry = ENTRY_HEADER;
+    writeNumber(entry, fingerprint);
+    writeBlob(entry, text);
+    writeNumber(entry, result.ok ? 1 : 0);
+    writeNumber(entry, result.declared.size());
+    for (auto &decl : result.declared) {
+        writeBlob(entry, decl.name);
+        writeNumber(entry, decl.ret);
+        writeNumber(entry, decl.params.size());
+        for (TypeId param : decl.params) {
+            writeNumber(entry, param);
+        }
+    }
+    writeBlob(entry, result.output);
+    writeBlob(entry, result.diagnostic);
+
+    // Readers never see half an entry, the rename replaces it at once
+    string path = entryPath(fingerprint, text);
+    ostringstream temporary;
+    temporary << path << ".tmp." << getpid() << "." << this_thread::get_id();
+    {
+        ofstream out(temporary.str(), ios::binary | ios::trunc);
+        out.write(entry.data(), entry.size());
+        if (!out) {
+            remove(temporary.str().c_str());
+            return;
+        }
+    }
+    if (rename(temporary.str().c_str(), path.c_str()) != 0) {
+        remove(temporary.str().c_str());
+    }
+}
+
+// Keeps the scope dumps and the error line of one function apart
+class ChunkSink : public output::Sink {
+public:
+    string text;
+    string diagnosticText;
+
+    void write(const char *data, size_t size) override {
+        text.append(data, size);
+    }
+
+    void diagnostic(const char *data, size_t size) override {
+        diagnosticText.append(data, size);
+    }
+};
+
+// "line 3: ..." of a chunk starting on line 10 is "line 12: ..." of the program
+static string programDiagnostic(const string &diagnostic, int firstLine) {
+    const string prefix = "line ";
+    size_t digits = prefix.size();
+    while (digits < diagnostic.size() && isdigit((unsigned char) diagnostic[digits])) {
+        digits++;
+    }
+    if (diagnostic.compare(0, prefix.size(), prefix) != 0 || digits == prefix.size()) {
+        return diagnostic;
+    }
+    int line = atoi(diagnostic.c_str() + prefix.size()) + firstLine - 1;
+    return prefix + to_string(line) + diagnostic.substr(digits);
+}
+
+// Checks one function on top of the global scope of ctx, the functions it declares stay in that scope
+static FunctionResult checkFunction(CheckerContext &ctx, ChunkSink &sink, string_view text) {
+    FunctionResult result;
+    size_t globals = ctx.symTabStack.front()->rows.size();
+    try {
+        parseProgram(&ctx, text.data(), text.size());
+    } catch (const CheckError &) {
+        result.ok = false;
+    }
+    if (result.ok) {
+        auto &rows = ctx.symTabStack.front()->rows;
+        for (size_t i = globals; i < rows.size(); ++i) {
+            const Signature &signature = ctx.signatures.get(rows[i]->type);
+            result.declared.push_back({string(ctx.names.get(rows[i]->name)), signature.params, signature.ret});
+        }
+    }
+    result.output.swap(sink.text);
+    result.diagnostic.swap(sink.diagnosticText);
+    return result;
+}
+
+static void finishWithError(CheckResult &result, output::Sink &sink, const string &diagnostic) {
+    sink.diagnostic(diagnostic.data(), diagnostic.size());
+    result.ok = false;
+    result.diagnostic = diagnostic;
+    if (!result.diagnostic.empty() && result.diagnostic.back() == '\n') {
+        result.diagnostic.pop_back();
+    }
+}
+
+CheckResult checkIncremental(const char *data, size_t size, output::Sink &sink, FunctionCache &cache) {
+    string_view program(data, size);
+    vector<FunctionChunk> chunks;
+    if (!splitFunctions(program, chunks)) {
+        return check(data, size, sink);
+    }
+
+    CheckResult result;
+    ChunkSink chunkSink;
+    CheckerContext ctx(chunkSink);
+    ctx.singleFunction = true;
+    openGlobalScope(&ctx);
+    uint64_t fingerprint = hashBytes("");
+    for (auto &row : ctx.symTabStack.front()->rows) {
+        fingerprint = hashDecl(fingerprint, ctx.names.get(row->name), ctx.signatures.get(row->type));
+    }
+
+    for (auto &chunk : chunks) {
+        string_view text = program.substr(chunk.offset, chunk.size);
+        FunctionResult function;
+        if (cache.load(fingerprint, text, function)) {
+            for (auto &decl : function.declared) {
+                insertSymbol(&ctx, make_shared<SymbolTableRow>(ctx.names.intern(decl.name),
+                                                               ctx.signatures.intern(decl.params, decl.ret), 0, true));
+            }
+        } else {
+            function = checkFunction(ctx, chunkSink, text);
+            cache.store(fingerprint, text, function);
+        }
+
+        sink.write(function.output);
+        if (!function.ok) {
+            finishWithError(result, sink, programDiagnostic(function.diagnostic, chunk.firstLine));
+            return result;
+        }
+        for (auto &decl : function.declared) {
+            fingerprint = hashDecl(fingerprint, decl.name, Signature(decl.params, decl.ret));
+        }
+    }
+
+    // The end of the program, checking for main and printing the global scope, is never cached
+    ctx.singleFunction = false;
+    try {
+        exitProgramRuntime(&ctx);
+    } catch (const CheckError &) {
+        sink.write(chunkSink.text);
+        finishWithError(result, sink, chunkSink.diagnosticText);
+        return result;
+    }
+    sink.write(chunkSink.text);
+    return result;
+}
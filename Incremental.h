@@ -0,0 +1,82 @@
+//
+// Incremental checking, unchanged functions are replayed from an on-disk cache instead of being checked again
+//
+
+#ifndef HW3_INCREMENTAL_H
+#define HW3_INCREMENTAL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Checker.h"
+#include "Semantics.h"
+
+using namespace std;
+
+// A function can only see the functions declared before it, so everything it prints depends only on its own text
+// and on the global scope it starts with
+// The program is cut into functions, and each function is cached under hash(function text, fingerprint of the
+// global scope before it)
+
+// The text of one function, from the end of the previous function to the closing brace of this one
+class FunctionChunk {
+public:
+    size_t offset;
+    size_t size;
+    // The line the text starts on, the chunk is checked on its own, so its lines are counted from 1
+    int firstLine;
+};
+
+// Cuts a program at the closing brace of every function, the way the scanner would see it (comments and strings
+// are skipped)
+// Returns false if the braces do not balance or something else than comments follows the last function,
+// such a program is checked as a whole
+bool splitFunctions(string_view program, vector<FunctionChunk> &chunks);
+
+// A function added to the global scope
+class GlobalDecl {
+public:
+    string name;
+    vector<TypeId> params;
+    TypeId ret;
+};
+
+// Everything checking a function changes outside of it
+class FunctionResult {
+public:
+    bool ok = true;
+    // The functions it declared, one unless the check failed
+    vector<GlobalDecl> declared;
+    // The scope dumps of the function
+    string output;
+    // The error line, its line number counted from the first line of the chunk
+    string diagnostic;
+};
+
+// One file per function in a directory, written to a temporary name and renamed, so several checkers can share it
+class FunctionCache {
+public:
+    atomic<size_t> hits{0};
+    atomic<size_t> misses{0};
+
+    // The directory is created if needed, a cache that cannot be written only misses
+    explicit FunctionCache(string directory);
+
+    // The entry stores the text and the fingerprint, so a hash collision is a miss and never a wrong replay
+    bool load(uint64_t fingerprint, string_view text, FunctionResult &result);
+
+    void store(uint64_t fingerprint, string_view text, const FunctionResult &result);
+
+private:
+    string directory;
+
+    string entryPath(uint64_t fingerprint, string_view text) const;
+};
+
+// Same output and result as check(data, size, sink), the unchanged functions are replayed from the cache
+CheckResult checkIncremental(const char *data, size_t size, output::Sink &sink, FunctionCache &cache);
+
+#endif //HW3_INCREMENTAL_H
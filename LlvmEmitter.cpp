@@ -0,0 +1,535 @@
+//
+// Textual LLVM IR of a checked program, for hw3 --emit-llvm
+//
+
+#include "LlvmEmitter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+static const char *const PRELUDE = R"(declare i32 @printf(ptr, ...)
+declare void @exit(i32)
+
+@.int_format = private unnamed_addr constant [4 x i8] c"%d\0A\00"
+@.str_format = private unnamed_addr constant [4 x i8] c"%s\0A\00"
+@.division_by_zero = private unnamed_addr constant [23 x i8] c"Error division by zero\00"
+
+define void @fn.print(ptr %text) {
+  call i32 (ptr, ...) @printf(ptr @.str_format, ptr %text)
+  ret void
+}
+
+define void @fn.printi(i32 %value) {
+  call i32 (ptr, ...) @printf(ptr @.int_format, i32 %value)
+  ret void
+}
+
+define i32 @main() {
+  call void @fn.main()
+  ret i32 0
+}
+)";
+
+// The IR type of a value of the program
+static const char *llvmType(TypeId type) {
+    switch (type) {
+        case TYPE_VOID:
+            return "void";
+        case TYPE_INT:
+            return "i32";
+        case TYPE_BYTE:
+            return "i8";
+        case TYPE_STRING:
+            return "ptr";
+        default:
+            // Bool, and the NONE type the checker gives to "and" and "or" of two numbers, which are computed as bools
+            return "i1";
+    }
+}
+
+// An operand, a register or a constant, and the type of the program it has
+class Value {
+public:
+    string text;
+    TypeId type;
+};
+
+// Emits one function at a time into its own text, the string literals are collected for the globals of the module
+// There is always an open basic block: a terminator (br, ret, switch) closes the current one, and whatever comes
+// after it in the program goes to a new block no branch leads to
+class LlvmEmitter {
+public:
+    LlvmEmitter(const Ast &ast, ostream &out) : ast(ast), out(out) {
+
+    }
+
+    void emit() {
+        out << "; generated by hw3 --emit-llvm\n\n" << PRELUDE;
+        if (ast.root == NO_NODE) {
+            return;
+        }
+        for (AstId func = ast.firstChild[ast.root]; func != NO_NODE; func = ast.nextSibling[func]) {
+            function(func);
+            out << "\n" << body.str();
+            body.str("");
+        }
+        out << "\n" << strings.str();
+    }
+
+private:
+    // What break and continue branch to
+    class JumpTarget {
+    public:
+        bool loop;
+        string continueLabel;
+        string breakLabel;
+    };
+
+    const Ast &ast;
+    ostream &out;
+    ostringstream body;
+    ostringstream strings;
+    size_t stringCount = 0;
+    int registers = 0;
+    int labels = 0;
+    bool open = false;
+    string currentLabel;
+    bool divisionUsed = false;
+    TypeId returnType = TYPE_VOID;
+    vector<JumpTarget> targets;
+
+    string newRegister() {
+        return "%t" + to_string(registers++);
+    }
+
+    string newLabel(const char *name) {
+        return string(name) + "." + to_string(labels++);
+    }
+
+    // Code after a return, break or continue still needs a block, it gets one nothing branches to
+    void ensureBlock() {
+        if (!open) {
+            startBlock(newLabel("dead"));
+        }
+    }
+
+    void instruction(const string &text) {
+        ensureBlock();
+        body << "  " << text << "\n";
+    }
+
+    void terminate(const string &text) {
+        instruction(text);
+        open = false;
+    }
+
+    void branch(const string &label) {
+        terminate("br label %" + label);
+    }
+
+    // Starts the block label, the block before it falls through to it
+    void startBlock(const string &label) {
+        if (open) {
+            body << "  br label %" << label << "\n";
+        }
+        body << label << ":\n";
+        currentLabel = label;
+        open = true;
+    }
+
+    // The address of the i32 slot of a parameter or a local, from its offset (see Statement)
+    string slot(int32_t offset) {
+        string address = newRegister();
+        if (offset < 0) {
+            instruction(address + " = getelementptr i32, ptr %params, i32 " + to_string(-offset - 1));
+        } else {
+            instruction(address + " = getelementptr i32, ptr %frame, i32 " + to_string(offset));
+        }
+        return address;
+    }
+
+    // The conversions the checker allows: a byte widens to an int, and an int assigned to a byte (which the
+    // checker lets through) is truncated, a bool is 0 or 1 when it is stored
+    Value convert(const Value &value, TypeId type) {
+        const char *from = llvmType(value.type);
+        const char *to = llvmType(type);
+        if (string(from) == to) {
+            return Value{value.text, type};
+        }
+        string result = newRegister();
+        if (string(to) == "i1") {
+            instruction(result + " = icmp ne " + from + " " + value.text + ", 0");
+        } else if (string(from) == "i32") {
+            instruction(result + " = trunc i32 " + value.text + " to " + to);
+        } else {
+            instruction(result + " = zext " + string(from) + " " + value.text + " to " + to);
+        }
+        return Value{result, type};
+    }
+
+    Value load(AstId declaration) {
+        string address = slot(ast.value[declaration]);
+        string loaded = newRegister();
+        instruction(loaded + " = load i32, ptr " + address);
+        return convert(Value{loaded, TYPE_INT}, ast.type[declaration]);
+    }
+
+    void store(AstId declaration, TypeId type, const Value &value) {
+        Value stored = convert(convert(value, type), TYPE_INT);
+        string address = slot(ast.value[declaration]);
+        instruction("store i32 " + stored.text + ", ptr " + address);
+    }
+
+    void function(AstId func) {
+        registers = 0;
+        labels = 0;
+        divisionUsed = false;
+        returnType = ast.type[func];
+        vector<AstId> formals;
+        int32_t locals = 0;
+        for (AstId child = ast.firstChild[func]; child != NO_NODE && ast.kind[child] == AST_FORMAL;
+             child = ast.nextSibling[child]) {
+            formals.push_back(child);
+        }
+        vector<AstId> pending = {func};
+        while (!pending.empty()) {
+            AstId node = pending.back();
+            pending.pop_back();
+            if (ast.kind[node] == AST_DECL) {
+                locals = max(locals, ast.value[node] + 1);
+            }
+            for (AstId child = ast.firstChild[node]; child != NO_NODE; child = ast.nextSibling[child]) {
+                pending.push_back(child);
+            }
+        }
+
+        body << "define " << llvmType(returnType) << " @fn." << ast.names.get(ast.name[func]) << "(";
+        for (size_t i = 0; i < formals.size(); ++i) {
+            body << (i ? ", " : "") << llvmType(ast.type[formals[i]]) << " %p" << i;
+        }
+        body << ") {\n";
+        open = false;
+        startBlock("entry");
+        // The locals are one i32 slot per offset, the offsets the checker gave them, the parameters are copied to
+        // slots of their own so that they can be assigned
+        instruction("%frame = alloca i32, i32 " + to_string(max(locals, 1)));
+        instruction("%params = alloca i32, i32 " + to_string(max<size_t>(formals.size(), 1)));
+        for (size_t i = 0; i < formals.size(); ++i) {
+            store(formals[i], ast.type[formals[i]], Value{"%p" + to_string(i), ast.type[formals[i]]});
+        }
+
+        for (AstId child = ast.firstChild[func]; child != NO_NODE; child = ast.nextSibling[child]) {
+            if (ast.kind[child] != AST_FORMAL) {
+                statement(child);
+            }
+        }
+        // Falling off the end of a function that returns a value returns 0
+        if (open) {
+            terminate(returnType == TYPE_VOID ? string("ret void") : string("ret ") + llvmType(returnType) + " 0");
+        }
+        if (divisionUsed) {
+            startBlock("division_by_zero");
+            instruction("call void @fn.print(ptr @.division_by_zero)");
+            instruction("call void @exit(i32 0)");
+            terminate("unreachable");
+        }
+        body << "}\n";
+    }
+
+    void statement(AstId node) {
+        AstId first = ast.firstChild[node];
+        switch (ast.kind[node]) {
+            case AST_BLOCK:
+                for (AstId child = first; child != NO_NODE; child = ast.nextSibling[child]) {
+                    statement(child);
+                }
+                break;
+            case AST_DECL:
+                // A declaration in a loop runs again on each iteration, and starts again from 0
+                store(node, ast.type[node], first == NO_NODE ? Value{"0", TYPE_INT} : expression(first));
+                break;
+            case AST_ASSIGN:
+                store(ast.ref[node], ast.type[node], expression(first));
+                break;
+            case AST_RETURN: {
+                if (first == NO_NODE) {
+                    terminate("ret void");
+                    break;
+                }
+                // A byte returned from a function that returns an int is widened
+                Value value = convert(expression(first), returnType);
+                terminate(string("ret ") + llvmType(returnType) + " " + value.text);
+                break;
+            }
+            case AST_CALL:
+                expression(node);
+                break;
+            case AST_IF: {
+                Value condition = convert(expression(first), TYPE_BOOL);
+                AstId thenStatement = ast.nextSibling[first];
+                AstId elseStatement = ast.nextSibling[thenStatement];
+                string thenLabel = newLabel("then");
+                string elseLabel = elseStatement == NO_NODE ? "" : newLabel("else");
+                string endLabel = newLabel("endif");
+                terminate("br i1 " + condition.text + ", label %" + thenLabel + ", label %" +
+                          (elseStatement == NO_NODE ? endLabel : elseLabel));
+                startBlock(thenLabel);
+                statement(thenStatement);
+                if (elseStatement != NO_NODE) {
+                    if (open) {
+                        branch(endLabel);
+                    }
+                    startBlock(elseLabel);
+                    statement(elseStatement);
+                }
+                startBlock(endLabel);
+                break;
+            }
+            case AST_WHILE: {
+                string conditionLabel = newLabel("while");
+                string bodyLabel = newLabel("loop");
+                string endLabel = newLabel("endwhile");
+                startBlock(conditionLabel);
+                Value condition = convert(expression(first), TYPE_BOOL);
+                terminate("br i1 " + condition.text + ", label %" + bodyLabel + ", label %" + endLabel);
+                startBlock(bodyLabel);
+                targets.push_back(JumpTarget{true, conditionLabel, endLabel});
+                statement(ast.nextSibling[first]);
+                targets.pop_back();
+                if (open) {
+                    branch(conditionLabel);
+                }
+                startBlock(endLabel);
+                break;
+            }
+            case AST_SWITCH:
+                switchStatement(node);
+                break;
+            case AST_BREAK:
+                branch(targets.back().breakLabel);
+                break;
+            case AST_CONTINUE:
+                // The innermost loop, a switch has nothing to continue
+                for (auto target = targets.rbegin(); target != targets.rend(); ++target) {
+                    if (target->loop) {
+                        branch(target->continueLabel);
+                        break;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // One LLVM switch over every label, so the backend picks a jump table for dense labels, the blocks of the
+    // cases follow each other in the order of the program and a case without a break falls through to the next
+    void switchStatement(AstId node) {
+        AstId valueNode = ast.firstChild[node];
+        Value value = convert(expression(valueNode), TYPE_INT);
+        string endLabel = newLabel("endswitch");
+        string defaultLabel = endLabel;
+        vector<string> caseLabels;
+        unordered_set<int32_t> seen;
+        string table;
+        for (AstId child = ast.nextSibling[valueNode]; child != NO_NODE; child = ast.nextSibling[child]) {
+            caseLabels.push_back(newLabel(ast.kind[child] == AST_CASE ? "case" : "default"));
+            if (ast.kind[child] == AST_DEFAULT) {
+                defaultLabel = caseLabels.back();
+            } else if (seen.insert(ast.value[child]).second) {
+                // A repeated label can never be reached, the first case with that label is taken
+                table += "    i32 " + to_string(ast.value[child]) + ", label %" + caseLabels.back() + "\n";
+            }
+        }
+        terminate("switch i32 " + value.text + ", label %" + defaultLabel + " [\n" + table + "  ]");
+        targets.push_back(JumpTarget{false, "", endLabel});
+        size_t index = 0;
+        for (AstId child = ast.nextSibling[valueNode]; child != NO_NODE; child = ast.nextSibling[child]) {
+            startBlock(caseLabels[index++]);
+            for (AstId statementNode = ast.firstChild[child]; statementNode != NO_NODE;
+                 statementNode = ast.nextSibling[statementNode]) {
+                statement(statementNode);
+            }
+        }
+        targets.pop_back();
+        startBlock(endLabel);
+    }
+
+    Value constant(AstId node) {
+        TypeId type = ast.type[node];
+        int32_t value = ast.value[node];
+        if (type == TYPE_BOOL) {
+            return Value{value ? "true" : "false", type};
+        }
+        // An i8 constant is written signed, 255 is -1
+        return Value{to_string(type == TYPE_BYTE ? int32_t(int8_t(value)) : value), type};
+    }
+
+    Value stringLiteral(AstId node) {
+        const string &literal = ast.strings[ast.value[node]];
+        string name = "@.str." + to_string(stringCount++);
+        string bytes;
+        size_t length = 0;
+        for (size_t i = 1; i + 1 < literal.size(); ++i) {
+            unsigned char c = (unsigned char) literal[i];
+            if (c < 32 || c >= 127 || c == '"' || c == '\\') {
+                static const char HEX[] = "0123456789ABCDEF";
+                bytes += '\\';
+                bytes += HEX[c >> 4];
+                bytes += HEX[c & 15];
+            } else {
+                bytes += char(c);
+            }
+            length++;
+        }
+        strings << name << " = private unnamed_addr constant [" << length + 1 << " x i8] c\"" << bytes << "\\00\"\n";
+        return Value{name, TYPE_STRING};
+    }
+
+    Value expression(AstId node) {
+        AstKind kind = ast.kind[node];
+        // A constant, already folded by the checker (see Exp::isConstant)
+        if (ast.constant[node] && kind != AST_CALL && ast.type[node] != TYPE_NONE) {
+            return constant(node);
+        }
+        AstId first = ast.firstChild[node];
+        switch (kind) {
+            case AST_ID:
+                return load(ast.ref[node]);
+            case AST_LITERAL:
+                if (ast.type[node] == TYPE_STRING) {
+                    return stringLiteral(node);
+                }
+                // Only an int literal above the int range is not constant, it is never a valid value anyway
+                return constant(node);
+            case AST_NOT: {
+                Value operand = convert(expression(first), TYPE_BOOL);
+                string result = newRegister();
+                instruction(result + " = xor i1 " + operand.text + ", true");
+                return Value{result, TYPE_BOOL};
+            }
+            case AST_AND:
+            case AST_OR:
+                return shortCircuit(node);
+            case AST_BINARY:
+                return binary(node);
+            case AST_CALL:
+                return call(node);
+            default:
+                return Value{"0", TYPE_INT};
+        }
+    }
+
+    // The right operand is only computed when the left one does not decide, a phi merges the two paths
+    Value shortCircuit(AstId node) {
+        bool isAnd = ast.kind[node] == AST_AND;
+        AstId left = ast.firstChild[node];
+        Value leftValue = convert(expression(left), TYPE_BOOL);
+        // A constant left operand emits nothing, the branch below may be what opens the block it ends
+        ensureBlock();
+        string leftLabel = currentLabel;
+        string rightLabel = newLabel(isAnd ? "and" : "or");
+        string endLabel = newLabel("endlogic");
+        terminate("br i1 " + leftValue.text + ", label %" + (isAnd ? rightLabel : endLabel) + ", label %" +
+                  (isAnd ? endLabel : rightLabel));
+        startBlock(rightLabel);
+        Value rightValue = convert(expression(ast.nextSibling[left]), TYPE_BOOL);
+        string rightEnd = currentLabel;
+        startBlock(endLabel);
+        string result = newRegister();
+        instruction(result + " = phi i1 [ " + (isAnd ? "false" : "true") + ", %" + leftLabel + " ], [ " +
+                    rightValue.text + ", %" + rightEnd + " ]");
+        return Value{result, TYPE_BOOL};
+    }
+
+    Value binary(AstId node) {
+        static const char *const ARITHMETIC[] = {"", "add", "sub", "mul"};
+        static const char *const SIGNED[] = {"eq", "ne", "slt", "sgt", "sle", "sge"};
+        static const char *const UNSIGNED[] = {"eq", "ne", "ult", "ugt", "ule", "uge"};
+        AstId left = ast.firstChild[node];
+        Value leftValue = expression(left);
+        Value rightValue = expression(ast.nextSibling[left]);
+        AstOp op = ast.op[node];
+        string result = newRegister();
+        if (op >= OP_EQ) {
+            // Two bytes are compared as bytes, 0 to 255, otherwise a byte operand is widened to an int
+            TypeId operands = leftValue.type == TYPE_BYTE && rightValue.type == TYPE_BYTE ? TYPE_BYTE : TYPE_INT;
+            leftValue = convert(leftValue, operands);
+            rightValue = convert(rightValue, operands);
+            const char *predicate = (operands == TYPE_BYTE ? UNSIGNED : SIGNED)[op - OP_EQ];
+            instruction(result + " = icmp " + predicate + " " + llvmType(operands) + " " + leftValue.text + ", " +
+                        rightValue.text);
+            return Value{result, TYPE_BOOL};
+        }
+        // The result is an int as soon as one operand is, and a byte operand is widened to it, bytes wrap around
+        // at 8 bits on their own since they are i8
+        TypeId type = ast.type[node];
+        const char *ty = llvmType(type);
+        leftValue = convert(leftValue, type);
+        rightValue = convert(rightValue, type);
+        if (op != OP_DIV) {
+            instruction(result + " = " + ARITHMETIC[op] + " " + ty + " " + leftValue.text + ", " + rightValue.text);
+            return Value{result, type};
+        }
+        string isZero = newRegister();
+        string divide = newLabel("divide");
+        instruction(isZero + " = icmp eq " + string(ty) + " " + rightValue.text + ", 0");
+        terminate("br i1 " + isZero + ", label %division_by_zero, label %" + divide);
+        divisionUsed = true;
+        startBlock(divide);
+        if (type == TYPE_BYTE) {
+            instruction(result + " = udiv i8 " + leftValue.text + ", " + rightValue.text);
+            return Value{result, type};
+        }
+        // sdiv of the lowest int by -1 is undefined, it is the negation instead, which wraps around to itself
+        string isMinusOne = newRegister();
+        string divisor = newRegister();
+        string quotient = newRegister();
+        string negated = newRegister();
+        instruction(isMinusOne + " = icmp eq i32 " + rightValue.text + ", -1");
+        instruction(divisor + " = select i1 " + isMinusOne + ", i32 1, i32 " + rightValue.text);
+        instruction(quotient + " = sdiv i32 " + leftValue.text + ", " + divisor);
+        instruction(negated + " = sub i32 0, " + leftValue.text);
+        instruction(result + " = select i1 " + isMinusOne + ", i32 " + negated + ", i32 " + quotient);
+        return Value{result, type};
+    }
+
+    Value call(AstId node) {
+        AstId callee = ast.ref[node];
+        vector<Value> args;
+        AstId formal = callee == NO_NODE ? NO_NODE : ast.firstChild[callee];
+        for (AstId arg = ast.firstChild[node]; arg != NO_NODE; arg = ast.nextSibling[arg]) {
+            Value value = expression(arg);
+            if (formal != NO_NODE) {
+                // A byte argument of an int parameter is widened
+                value = convert(value, ast.type[formal]);
+                formal = ast.nextSibling[formal];
+            } else if (value.type != TYPE_STRING) {
+                // printi
+                value = convert(value, TYPE_INT);
+            }
+            args.push_back(value);
+        }
+        TypeId type = ast.type[node];
+        string text = "call " + string(llvmType(type)) + " @fn." + string(ast.names.get(ast.name[node])) + "(";
+        for (size_t i = 0; i < args.size(); ++i) {
+            text += (i ? ", " : "") + string(llvmType(args[i].type)) + " " + args[i].text;
+        }
+        text += ")";
+        if (type == TYPE_VOID) {
+            instruction(text);
+            return Value{"", type};
+        }
+        string result = newRegister();
+        instruction(result + " = " + text);
+        return Value{result, type};
+    }
+};
+
+void emitLlvm(const Ast &ast, ostream &out) {
+    LlvmEmitter(ast, out).emit();
+}
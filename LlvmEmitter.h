@@ -0,0 +1,19 @@
+//
+// Textual LLVM IR of a checked program, for hw3 --emit-llvm
+//
+
+#ifndef HW3_LLVM_EMITTER_H
+#define HW3_LLVM_EMITTER_H
+
+#include <ostream>
+#include "Ast.h"
+
+using namespace std;
+
+// Writes a whole module: the functions of the program, print and printi over printf, and a C main calling main
+// Nothing links with LLVM, the text is read by lli, llc or clang, and pointers are opaque (ptr), the default since
+// LLVM 15 (LLVM 14 needs -opaque-pointers)
+// The program must have passed the check
+void emitLlvm(const Ast &ast, ostream &out);
+
+#endif //HW3_LLVM_EMITTER_H
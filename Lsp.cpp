@@ -0,0 +1,835 @@
+//
+// Language server over stdio, see Lsp.h for what is checked again after an edit
+//
+
+#include "Lsp.h"
+#include "Checker.h"
+#include "Incremental.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A parsed JSON value, only what the requests use
+class Json {
+public:
+    enum Kind {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT
+    };
+
+    Kind kind = JSON_NULL;
+    bool boolean = false;
+    double number = 0;
+    string text;
+    vector<Json> items;
+    vector<pair<string, Json>> members;
+
+    // The member named key, a null value if there is none
+    const Json &operator[](string_view key) const {
+        static const Json missing;
+        for (auto &member : members) {
+            if (member.first == key) {
+                return member.second;
+            }
+        }
+        return missing;
+    }
+
+    int integer() const {
+        return kind == JSON_NUMBER ? int(number) : 0;
+    }
+};
+
+class JsonParser {
+public:
+    string_view input;
+    size_t pos = 0;
+    bool ok = true;
+
+    explicit JsonParser(string_view input) : input(input) {
+
+    }
+
+    Json parse() {
+        Json value = parseValue(0);
+        skipSpace();
+        ok = ok && pos == input.size();
+        return value;
+    }
+
+private:
+    // Deeper values are refused, the requests nest a few levels
+    static const int MAX_DEPTH = 64;
+
+    void skipSpace() {
+        while (pos < input.size() && strchr(" \t\r\n", input[pos]) && input[pos]) {
+            pos++;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos < input.size() && input[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool consumeWord(string_view word) {
+        if (input.compare(pos, word.size(), word) != 0) {
+            return false;
+        }
+        pos += word.size();
+        return true;
+    }
+
+    static void appendUtf8(string &out, unsigned code) {
+        if (code < 0x80) {
+            out.push_back(char(code));
+        } else if (code < 0x800) {
+            out.push_back(char(0xc0 | (code >> 6)));
+            out.push_back(char(0x80 | (code & 0x3f)));
+        } else {
+            out.push_back(char(0xe0 | (code >> 12)));
+            out.push_back(char(0x80 | ((code >> 6) & 0x3f)));
+            out.push_back(char(0x80 | (code & 0x3f)));
+        }
+    }
+
+    string parseString() {
+        string out;
+        // The opening quote was consumed
+        while (pos < input.size() && input[pos] != '"') {
+            char c = input[pos++];
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos >= input.size()) {
+                break;
+            }
+            char escaped = input[pos++];
+            switch (escaped) {
+                case 'n':
+                    out.push_back('\n');
+                    break;
+                case 'r':
+                    out.push_back('\r');
+                    break;
+                case 't':
+                    out.push_back('\t');
+                    break;
+                case 'b':
+                    out.push_back('\b');
+                    break;
+                case 'f':
+                    out.push_back('\f');
+                    break;
+                case 'u': {
+                    if (pos + 4 > input.size()) {
+                        ok = false;
+                        return out;
+                    }
+                    appendUtf8(out, unsigned(strtoul(string(input.substr(pos, 4)).c_str(), nullptr, 16)));
+                    pos += 4;
+                    break;
+                }
+                default:
+                    out.push_back(escaped);
+            }
+        }
+        if (pos >= input.size()) {
+            ok = false;
+            return out;
+        }
+        pos++;
+        return out;
+    }
+
+    Json parseValue(int depth) {
+        Json value;
+        skipSpace();
+        if (pos >= input.size() || depth > MAX_DEPTH) {
+            ok = false;
+            return value;
+        }
+        char c = input[pos];
+        if (c == '"') {
+            pos++;
+            value.kind = Json::JSON_STRING;
+            value.text = parseString();
+        } else if (c == '{') {
+            pos++;
+            value.kind = Json::JSON_OBJECT;
+            if (consume('}')) {
+                return value;
+            }
+            do {
+                if (!consume('"')) {
+                    ok = false;
+                    return value;
+                }
+                string key = parseString();
+                if (!consume(':')) {
+                    ok = false;
+                    return value;
+                }
+                value.members.emplace_back(std::move(key), parseValue(depth + 1));
+            } while (ok && consume(','));
+            ok = ok && consume('}');
+        } else if (c == '[') {
+            pos++;
+            value.kind = Json::JSON_ARRAY;
+            if (consume(']')) {
+                return value;
+            }
+            do {
+                value.items.push_back(parseValue(depth + 1));
+            } while (ok && consume(','));
+            ok = ok && consume(']');
+        } else if (consumeWord("true") || consumeWord("false")) {
+            value.kind = Json::JSON_BOOL;
+            value.boolean = input[pos - 1] == 'e' && input[pos - 2] == 'u';
+        } else if (consumeWord("null")) {
+            value.kind = Json::JSON_NULL;
+        } else {
+            const char *start = input.data() + pos;
+            char *end;
+            string number(input.substr(pos, min<size_t>(input.size() - pos, 32)));
+            value.kind = Json::JSON_NUMBER;
+            value.number = strtod(number.c_str(), &end);
+            size_t size = size_t(end - number.c_str());
+            if (size == 0 || start[0] == '+') {
+                ok = false;
+            }
+            pos += size;
+        }
+        return value;
+    }
+};
+
+// An id is echoed in its response the way it came, a number or a string
+static string jsonId(const Json &id) {
+    if (id.kind == Json::JSON_STRING) {
+        string out;
+        appendJsonString(out, id.text);
+        return out;
+    }
+    if (id.kind == Json::JSON_NUMBER) {
+        return to_string((long long) id.number);
+    }
+    return "null";
+}
+
+static string jsonPosition(int line, int character) {
+    return "{\"line\":" + to_string(line) + ",\"character\":" + to_string(character) + "}";
+}
+
+static string jsonRange(int line, int character, int endLine, int endCharacter) {
+    return "{\"start\":" + jsonPosition(line, character) + ",\"end\":" + jsonPosition(endLine, endCharacter) + "}";
+}
+
+// Keeps the error line of a check, the scope dumps are dropped
+class LspSink : public output::Sink {
+public:
+    string diagnosticText;
+
+    void write(const char *, size_t) override {
+
+    }
+
+    void diagnostic(const char *data, size_t size) override {
+        diagnosticText.append(data, size);
+    }
+};
+
+// A symbol of a function and the last line it is visible on, both counted from the first line of the function
+class SymbolSpan {
+public:
+    shared_ptr<SymbolTableRow> row;
+    int endLine;
+};
+
+// A piece of the document, a function from the end of the one before it to its closing brace (see FunctionChunk)
+// The last piece may also be the comments after the last function, or text that does not cut into functions
+// Its lines are counted from 1 on its own, so an edit above it does not change anything it keeps
+class DocumentFunction {
+public:
+    string text;
+    // The newlines in the text, and the size of the text after the last one
+    int lines = 0;
+    size_t lastLineSize = 0;
+    bool ok = true;
+    // The error line of the function, "line N: ..." counted from its first line
+    string diagnostic;
+    // The rows it added to the global scope, a failed function keeps the ones declared before the error
+    vector<shared_ptr<SymbolTableRow>> declared;
+    // Every parameter and variable of its scopes
+    vector<SymbolSpan> symbols;
+
+    explicit DocumentFunction(string text) : text(std::move(text)) {
+        for (size_t i = 0; i < this->text.size(); ++i) {
+            if (this->text[i] == '\n') {
+                lines++;
+                lastLineSize = 0;
+            } else {
+                lastLineSize++;
+            }
+        }
+    }
+};
+
+// Where a piece starts in the document, 0 based like the protocol positions
+class PieceStart {
+public:
+    int line;
+    size_t character;
+};
+
+// Cuts a text into the pieces of a document, returns false if it does not end on the end of a function
+static bool cutFunctions(string_view text, vector<string> &pieces) {
+    vector<FunctionChunk> chunks;
+    pieces.clear();
+    if (!splitFunctions(text, chunks)) {
+        return false;
+    }
+    size_t end = 0;
+    for (auto &chunk : chunks) {
+        pieces.emplace_back(text.substr(chunk.offset, chunk.size));
+        end = chunk.offset + chunk.size;
+    }
+    if (end < text.size() || pieces.empty()) {
+        pieces.emplace_back(text.substr(end));
+    }
+    return true;
+}
+
+class Document : public ScopeObserver {
+public:
+    string uri;
+    vector<DocumentFunction> functions;
+    // The position of every piece, updated after each change
+    vector<PieceStart> starts;
+
+    Document() : ctx(sink) {
+        // The global scope stays open for the life of the document, each piece is parsed on top of it
+        // Its rows are only print and printi between checks, the functions of the pieces are bound in the index
+        ctx.singleFunction = true;
+        ctx.scopeObserver = this;
+        openGlobalScope(&ctx);
+    }
+
+    void open(string_view text) {
+        vector<string> pieces;
+        if (!cutFunctions(text, pieces)) {
+            pieces.assign(1, string(text));
+        }
+        bindDeclared(0, functions.size(), false);
+        functions.clear();
+        for (auto &piece : pieces) {
+            functions.emplace_back(std::move(piece));
+        }
+        for (auto &function : functions) {
+            checkFunction(function);
+        }
+        updateStarts();
+    }
+
+    // Replaces the text between two positions, the pieces holding them are cut again and checked again
+    void edit(int line, size_t character, int endLine, size_t endCharacter, string_view text) {
+        size_t first;
+        size_t firstOffset;
+        size_t last;
+        size_t lastOffset;
+        locate(line, character, first, firstOffset);
+        locate(endLine, endCharacter, last, lastOffset);
+        if (last < first || (last == first && lastOffset < firstOffset)) {
+            swap(first, last);
+            swap(firstOffset, lastOffset);
+        }
+        string region;
+        for (size_t i = first; i <= last; ++i) {
+            region += functions[i].text;
+        }
+        size_t regionEnd = region.size() - functions[last].text.size() + lastOffset;
+        region.replace(firstOffset, regionEnd - firstOffset, text.data(), text.size());
+        // A region that no longer ends on the end of a function takes the next piece, up to the end of the document
+        vector<string> pieces;
+        while (!cutFunctions(region, pieces)) {
+            if (last + 1 == functions.size()) {
+                pieces.assign(1, region);
+                break;
+            }
+            region += functions[++last].text;
+        }
+
+        // The edited pieces only see the functions declared before them
+        vector<pair<NameId, SigId>> before = declaredBy(first, last + 1);
+        bindDeclared(first, functions.size(), false);
+        if (pieces.size() == last + 1 - first) {
+            // Most edits stay inside one function, nothing after it moves
+            for (size_t i = 0; i < pieces.size(); ++i) {
+                functions[first + i] = DocumentFunction(std::move(pieces[i]));
+            }
+        } else {
+            functions.erase(functions.begin() + first, functions.begin() + last + 1);
+            vector<DocumentFunction> replaced;
+            for (auto &piece : pieces) {
+                replaced.emplace_back(std::move(piece));
+            }
+            functions.insert(functions.begin() + first, make_move_iterator(replaced.begin()),
+                             make_move_iterator(replaced.end()));
+        }
+        size_t next = first + pieces.size();
+        for (size_t i = first; i < next; ++i) {
+            checkFunction(functions[i]);
+        }
+        // The functions after the edit see the same global scope as before, unless the edit changed what it declares
+        if (before == declaredBy(first, next)) {
+            bindDeclared(next, functions.size(), true);
+        } else {
+            for (size_t i = next; i < functions.size(); ++i) {
+                checkFunction(functions[i]);
+            }
+        }
+        updateStarts();
+    }
+
+    // The piece holding a position and the offset of the position in its text
+    void locate(int line, size_t character, size_t &index, size_t &offset) const {
+        // The last piece starting at or before the position
+        auto after = upper_bound(starts.begin(), starts.end(), make_pair(line, character),
+                                 [](const pair<int, size_t> &position, const PieceStart &start) {
+                                     return position.first < start.line ||
+                                            (position.first == start.line && position.second < start.character);
+                                 });
+        index = after == starts.begin() ? 0 : size_t(after - starts.begin()) - 1;
+        const DocumentFunction &function = functions[index];
+        size_t lineStart = 0;
+        size_t column = starts[index].character;
+        for (int skipped = starts[index].line; skipped < line; ++skipped) {
+            size_t newline = function.text.find('\n', lineStart);
+            if (newline == string::npos) {
+                offset = function.text.size();
+                return;
+            }
+            lineStart = newline + 1;
+            column = 0;
+        }
+        size_t lineEnd = min(function.text.find('\n', lineStart), function.text.size());
+        offset = min(lineStart + (character >= column ? character - column : 0), lineEnd);
+    }
+
+    // The symbol named by the identifier at a position, and the piece declaring it (functions.size() for print and
+    // printi), nullptr if there is none
+    shared_ptr<SymbolTableRow> symbolAt(int line, size_t character, size_t &owner, int &wordLine,
+                                        size_t &wordCharacter, size_t &wordSize) const {
+        size_t index;
+        size_t offset;
+        locate(line, character, index, offset);
+        const string &text = functions[index].text;
+        size_t start = offset;
+        size_t end = offset;
+        while (start > 0 && isalnum((unsigned char) text[start - 1])) {
+            start--;
+        }
+        while (end < text.size() && isalnum((unsigned char) text[end])) {
+            end++;
+        }
+        if (start == end || !isalpha((unsigned char) text[start])) {
+            return nullptr;
+        }
+        NameId name = ctx.names.find(string_view(text).substr(start, end - start));
+        if (name == NO_NAME) {
+            return nullptr;
+        }
+        wordLine = line;
+        wordSize = end - start;
+        wordCharacter = character - (offset - start);
+
+        // The innermost local whose scope holds the line, locals never shadow each other
+        int relativeLine = line - starts[index].line + 1;
+        const SymbolSpan *found = nullptr;
+        for (auto &span : functions[index].symbols) {
+            if (span.row->name == name && span.row->line <= relativeLine && relativeLine <= span.endLine &&
+                (!found || span.row->line > found->row->line)) {
+                found = &span;
+            }
+        }
+        if (found) {
+            owner = index;
+            return found->row;
+        }
+        shared_ptr<SymbolTableRow> row = ctx.symIndex.lookup(name);
+        if (!row) {
+            return nullptr;
+        }
+        owner = functions.size();
+        for (size_t i = 0; i < functions.size() && owner == functions.size(); ++i) {
+            for (auto &declared : functions[i].declared) {
+                if (declared == row) {
+                    owner = i;
+                }
+            }
+        }
+        return row;
+    }
+
+    // The line of the symbol table dump for a row, without the newline
+    string describe(const SymbolTableRow &row) const {
+        output::StringSink line;
+        if (row.isFunc) {
+            vector<string> paramTypes = ctx.signatures.paramNames(row.type);
+            output::printID(line, ctx.names.get(row.name), row.offset,
+                            output::makeFunctionType(typeName(row.valueType(ctx.signatures)), paramTypes));
+        } else {
+            output::printID(line, ctx.names.get(row.name), row.offset, typeName(row.valueType(ctx.signatures)));
+        }
+        if (!line.text.empty() && line.text.back() == '\n') {
+            line.text.pop_back();
+        }
+        return line.text;
+    }
+
+    // The position of the name of a row in the piece declaring it
+    void declarationOf(const SymbolTableRow &row, size_t owner, int &line, size_t &character) const {
+        const string &text = functions[owner].text;
+        line = starts[owner].line + row.line - 1;
+        size_t lineStart = 0;
+        size_t column = starts[owner].character;
+        for (int skipped = 1; skipped < row.line; ++skipped) {
+            lineStart = text.find('\n', lineStart) + 1;
+            column = 0;
+        }
+        size_t lineEnd = min(text.find('\n', lineStart), text.size());
+        string_view name = ctx.names.get(row.name);
+        // The first whole word equal to the name on the line
+        for (size_t at = text.find(name.data(), lineStart, name.size()); at < lineEnd;
+             at = text.find(name.data(), at + 1, name.size())) {
+            bool before = at > lineStart && isalnum((unsigned char) text[at - 1]);
+            bool after = at + name.size() < text.size() && isalnum((unsigned char) text[at + name.size()]);
+            if (!before && !after) {
+                character = column + (at - lineStart);
+                return;
+            }
+        }
+        character = column;
+    }
+
+    // The diagnostics of the document as a JSON array
+    string diagnostics() const {
+        string out = "[";
+        auto add = [&](int line, string_view message) {
+            if (out.size() > 1) {
+                out.push_back(',');
+            }
+            out += "{\"range\":" + jsonRange(line, 0, line + 1, 0) + ",\"severity\":1,\"source\":\"hw3\",\"message\":";
+            appendJsonString(out, message);
+            out.push_back('}');
+        };
+        for (size_t i = 0; i < functions.size(); ++i) {
+            const string &diagnostic = functions[i].diagnostic;
+            if (functions[i].ok) {
+                continue;
+            }
+            // "line N: ..." counted from the first line of the piece
+            int line = starts[i].line;
+            string_view message = diagnostic;
+            if (diagnostic.compare(0, 5, "line ") == 0) {
+                line += atoi(diagnostic.c_str() + 5) - 1;
+                message.remove_prefix(min(message.find(": "), message.size()));
+                message.remove_prefix(min<size_t>(2, message.size()));
+            }
+            add(line, message);
+        }
+        // The end of the program is checked once every function is, like exitProgramRuntime
+        shared_ptr<SymbolTableRow> main = ctx.symIndex.lookup(ctx.names.find("main"));
+        if (!main || !main->isFunc || main->type != ctx.signatures.find({}, TYPE_VOID)) {
+            LspSink sink;
+            output::errorMainMissing(sink);
+            string message = sink.diagnosticText;
+            if (!message.empty() && message.back() == '\n') {
+                message.pop_back();
+            }
+            const PieceStart &end = starts.back();
+            add(end.line + functions.back().lines, message);
+        }
+        return out + "]";
+    }
+
+    void scopeClosed(const CheckerContext &, const SymbolTable &scope, size_t) override {
+        for (auto &row : scope.rows) {
+            checking->symbols.push_back({row, ctx.lineno()});
+        }
+    }
+
+private:
+    LspSink sink;
+    CheckerContext ctx;
+    // The piece being checked, which the closed scopes belong to
+    DocumentFunction *checking = nullptr;
+
+    // The functions declared by the pieces [from, to)
+    vector<pair<NameId, SigId>> declaredBy(size_t from, size_t to) const {
+        vector<pair<NameId, SigId>> declared;
+        for (size_t i = from; i < to; ++i) {
+            for (auto &row : functions[i].declared) {
+                declared.emplace_back(row->name, row->type);
+            }
+        }
+        return declared;
+    }
+
+    // Binds the functions declared by the pieces [from, to) in the index, or hides them from the lookups
+    // A global name has a single binding, a piece that declares a name again fails before binding it
+    void bindDeclared(size_t from, size_t to, bool bind) {
+        for (size_t i = from; i < to; ++i) {
+            for (auto &row : functions[i].declared) {
+                if (bind) {
+                    ctx.symIndex.bind(row);
+                } else if (!ctx.symIndex.bindings[row->name].empty()) {
+                    ctx.symIndex.bindings[row->name].pop_back();
+                }
+            }
+        }
+    }
+
+    void checkFunction(DocumentFunction &function) {
+        checking = &function;
+        function.symbols.clear();
+        function.ok = true;
+        function.diagnostic.clear();
+        sink.diagnosticText.clear();
+        size_t globals = ctx.symTabStack.front()->rows.size();
+        try {
+            parseProgram(&ctx, function.text.data(), function.text.size());
+        } catch (const CheckError &) {
+            function.ok = false;
+            function.diagnostic.swap(sink.diagnosticText);
+            if (!function.diagnostic.empty() && function.diagnostic.back() == '\n') {
+                function.diagnostic.pop_back();
+            }
+            // The scopes the error left open end with the piece, the next piece starts on the global scope
+            while (ctx.symTabStack.size() > 1) {
+                for (auto &row : ctx.symTabStack.back()->rows) {
+                    function.symbols.push_back({row, function.lines + 1});
+                }
+                ctx.symIndex.unbind(*ctx.symTabStack.back());
+                ctx.symTabStack.pop_back();
+                ctx.offsetStack.pop_back();
+            }
+            ctx.loopCounter = 0;
+            ctx.switchCounter = 0;
+            ctx.currentRunningFunctionScopeId = NO_NAME;
+            ctx.nodes.reset();
+        }
+        // The rows stay bound, the piece keeps them
+        auto &rows = ctx.symTabStack.front()->rows;
+        function.declared.assign(rows.begin() + globals, rows.end());
+        rows.resize(globals);
+        checking = nullptr;
+    }
+
+    void updateStarts() {
+        starts.resize(functions.size());
+        int line = 0;
+        size_t character = 0;
+        for (size_t i = 0; i < functions.size(); ++i) {
+            starts[i] = {line, character};
+            if (functions[i].lines) {
+                line += functions[i].lines;
+                character = functions[i].lastLineSize;
+            } else {
+                character += functions[i].text.size();
+            }
+        }
+    }
+};
+
+// Reads one message, false at the end of stdin
+static bool readMessage(string &body) {
+    size_t length = 0;
+    bool sized = false;
+    char header[256];
+    for (;;) {
+        if (!fgets(header, sizeof(header), stdin)) {
+            return false;
+        }
+        if (strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0) {
+            if (sized) {
+                break;
+            }
+            continue;
+        }
+        if (strncasecmp(header, "Content-Length:", 15) == 0) {
+            length = size_t(strtoul(header + 15, nullptr, 10));
+            sized = true;
+        }
+    }
+    body.resize(length);
+    return fread(&body[0], 1, length, stdin) == length;
+}
+
+static void writeMessage(const string &body) {
+    fprintf(stdout, "Content-Length: %zu\r\n\r\n", body.size());
+    fwrite(body.data(), 1, body.size(), stdout);
+    fflush(stdout);
+}
+
+static void respond(const Json &id, const string &result) {
+    writeMessage("{\"jsonrpc\":\"2.0\",\"id\":" + jsonId(id) + ",\"result\":" + result + "}");
+}
+
+static void respondError(const Json &id, int code, string_view message) {
+    string body = "{\"jsonrpc\":\"2.0\",\"id\":" + jsonId(id) + ",\"error\":{\"code\":" + to_string(code) +
+                  ",\"message\":";
+    appendJsonString(body, message);
+    writeMessage(body + "}}");
+}
+
+static void publishDiagnostics(const Document &document) {
+    string body = "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":";
+    appendJsonString(body, document.uri);
+    writeMessage(body + ",\"diagnostics\":" + document.diagnostics() + "}}");
+}
+
+// The time spent on each kind of message, for the summary on stderr
+class LatencyCounter {
+public:
+    size_t count = 0;
+    double totalSeconds = 0;
+    double maxSeconds = 0;
+
+    void add(double seconds) {
+        count++;
+        totalSeconds += seconds;
+        maxSeconds = max(maxSeconds, seconds);
+    }
+
+    void print(const char *name) const {
+        fprintf(stderr, "%-12s %8zu   mean %9.1f us   max %9.1f us\n", name, count,
+                count ? totalSeconds / count * 1e6 : 0.0, maxSeconds * 1e6);
+    }
+};
+
+int runLanguageServer() {
+    unordered_map<string, unique_ptr<Document>> documents;
+    bool shutdown = false;
+    LatencyCounter opens;
+    LatencyCounter changes;
+    LatencyCounter queries;
+    string body;
+    while (readMessage(body)) {
+        auto start = chrono::steady_clock::now();
+        auto elapsed = [&] {
+            return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        };
+        JsonParser parser(body);
+        Json message = parser.parse();
+        if (!parser.ok || message.kind != Json::JSON_OBJECT) {
+            respondError(Json(), -32700, "parse error");
+            continue;
+        }
+        const string &method = message["method"].text;
+        const Json &id = message["id"];
+        const Json &params = message["params"];
+        bool request = id.kind != Json::JSON_NULL;
+        if (method == "exit") {
+            break;
+        }
+        if (method == "initialize") {
+            respond(id, "{\"capabilities\":{\"textDocumentSync\":2,\"hoverProvider\":true,\"definitionProvider\":true},"
+                        "\"serverInfo\":{\"name\":\"hw3\"}}");
+            continue;
+        }
+        if (method == "shutdown") {
+            shutdown = true;
+            respond(id, "null");
+            continue;
+        }
+        const string &uri = params["textDocument"]["uri"].text;
+        if (method == "textDocument/didOpen") {
+            unique_ptr<Document> &document = documents[uri];
+            document = make_unique<Document>();
+            document->uri = uri;
+            document->open(params["textDocument"]["text"].text);
+            opens.add(elapsed());
+            publishDiagnostics(*document);
+            continue;
+        }
+        auto found = documents.find(uri);
+        if (method == "textDocument/didClose") {
+            if (found != documents.end()) {
+                documents.erase(found);
+            }
+            continue;
+        }
+        if (found == documents.end()) {
+            if (request) {
+                respondError(id, -32601, "unknown method or document");
+            }
+            continue;
+        }
+        Document &document = *found->second;
+        if (method == "textDocument/didChange") {
+            for (auto &change : params["contentChanges"].items) {
+                const Json &range = change["range"];
+                if (range.kind != Json::JSON_OBJECT) {
+                    document.open(change["text"].text);
+                    continue;
+                }
+                document.edit(range["start"]["line"].integer(), size_t(range["start"]["character"].integer()),
+                              range["end"]["line"].integer(), size_t(range["end"]["character"].integer()),
+                              change["text"].text);
+            }
+            changes.add(elapsed());
+            publishDiagnostics(document);
+        } else if (method == "textDocument/hover" || method == "textDocument/definition") {
+            int line = params["position"]["line"].integer();
+            size_t character = size_t(params["position"]["character"].integer());
+            size_t owner;
+            int wordLine;
+            size_t wordCharacter;
+            size_t wordSize;
+            shared_ptr<SymbolTableRow> row = document.symbolAt(line, character, owner, wordLine, wordCharacter,
+                                                               wordSize);
+            string result = "null";
+            if (row && method == "textDocument/hover") {
+                result = "{\"contents\":{\"kind\":\"plaintext\",\"value\":";
+                appendJsonString(result, document.describe(*row));
+                result += "},\"range\":" + jsonRange(wordLine, int(wordCharacter), wordLine,
+                                                     int(wordCharacter + wordSize)) + "}";
+            } else if (row && owner < document.functions.size()) {
+                int declarationLine;
+                size_t declarationCharacter;
+                document.declarationOf(*row, owner, declarationLine, declarationCharacter);
+                result = "{\"uri\":";
+                appendJsonString(result, uri);
+                result += ",\"range\":" + jsonRange(declarationLine, int(declarationCharacter), declarationLine,
+                                                    int(declarationCharacter + wordSize)) + "}";
+            }
+            queries.add(elapsed());
+            respond(id, result);
+        } else if (request) {
+            respondError(id, -32601, "unknown method or document");
+        }
+    }
+    opens.print("opens");
+    changes.print("changes");
+    queries.print("queries");
+    return shutdown ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+//
+// Language server over stdio, for editors
+//
+
+#ifndef HW3_LSP_H
+#define HW3_LSP_H
+
+// Speaks the Language Server Protocol on stdin and stdout: JSON-RPC messages, each after a Content-Length header
+//
+// Each open document is kept cut into functions (see splitFunctions in Incremental.h), and its global scope stays
+// open in one CheckerContext
+// An edit cuts again only the functions it touches and checks them again, the functions after them are only checked
+// again if the edited ones declare other functions than before, so editing a body costs the size of the function
+// and not the size of the document
+//
+// Answers initialize, shutdown, textDocument/hover (the scope dump line of the symbol under the cursor) and
+// textDocument/definition (the line declaring it), and publishes the first error of every function, and a missing
+// main, after each open and change
+// Documents are synced incrementally, a change with no range replaces the whole text
+
+// Serves until the exit notification or the end of stdin, then prints the change count and latency to stderr
+// Returns 0 if shutdown came before exit
+int runLanguageServer();
+
+#endif //HW3_LSP_H
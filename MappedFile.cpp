@@ -0,0 +1,81 @@
+//
+// Program files mapped into memory, for scanning large inputs without reading them into a buffer
+//
+
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return false;
+    }
+    if (!S_ISREG(info.st_mode)) {
+        ::close(fd);
+        errno = EINVAL;
+        return false;
+    }
+    size_t size = info.st_size;
+
+    // Reserve zeroed pages for the file and the two NUL bytes, then map the file over the start of them
+    // The bytes after the end of the file are always 0, even when the file ends exactly on a page boundary
+    size_t reserved = size + 2;
+    void *base = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        int error = errno;
+        ::close(fd);
+        errno = error;
+        return false;
+    }
+    if (size > 0 && mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int error = errno;
+        munmap(base, reserved);
+        ::close(fd);
+        errno = error;
+        return false;
+    }
+    // The mapping keeps the file alive
+    ::close(fd);
+    if (size > 0) {
+        madvise(base, size, MADV_SEQUENTIAL);
+    }
+
+    mapping = static_cast<char *>(base);
+    mappingSize = reserved;
+    fileSize = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+    mapping = nullptr;
+    mappingSize = 0;
+    fileSize = 0;
+}
+
+char *MappedFile::data() const {
+    return mapping;
+}
+
+size_t MappedFile::size() const {
+    return fileSize;
+}
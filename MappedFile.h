@@ -0,0 +1,42 @@
+//
+// Program files mapped into memory, for scanning large inputs without reading them into a buffer
+//
+
+#ifndef HW3_MAPPEDFILE_H
+#define HW3_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// A private, writable mapping of a whole file followed by two NUL bytes, the end of buffer marker flex needs
+// to scan the mapping in place (see parseProgramInPlace)
+// Pages are read from the file on first touch, and only the pages flex writes to are copied
+class MappedFile {
+public:
+    MappedFile() = default;
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns false if the file cannot be opened or mapped, errno tells why
+    bool open(const string &path);
+
+    void close();
+
+    char *data() const;
+
+    // The size of the file, without the two NUL bytes
+    size_t size() const;
+
+private:
+    char *mapping = nullptr;
+    size_t mappingSize = 0;
+    size_t fileSize = 0;
+};
+
+#endif //HW3_MAPPEDFILE_H
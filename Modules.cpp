@@ -0,0 +1,331 @@
+//
+// Programs split across several files, see Modules.h for what a module sees and when it is checked again
+//
+
+#include "Modules.h"
+#include "Batch.h"
+#include "Checker.h"
+#include "Prelude.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+
+class ModuleImport {
+public:
+    // The index of the imported module on the command line
+    size_t module;
+    // The line of the import comment
+    int line;
+};
+
+enum ModuleState {
+    MODULE_PENDING,
+    MODULE_CHECKED,
+    MODULE_UP_TO_DATE,
+    MODULE_FAILED,
+    // An import failed, so the module was not checked
+    MODULE_SKIPPED
+};
+
+class ModuleFile {
+public:
+    string path;
+    string name;
+    MappedFile text;
+    vector<ModuleImport> imports;
+    // 0 for a module without imports, one more than its deepest import otherwise, the modules of a level are checked
+    // together
+    size_t level = 0;
+    ModuleState state = MODULE_PENDING;
+    // Mapped from the interface directory once the module is checked or found up to date
+    Prelude interface;
+    // The scope dumps of a failed module, the ones of a valid module are in its interface
+    string output;
+    string diagnostic;
+};
+
+// Keeps the scope dumps and the error line of a module apart
+class ModuleSink : public output::Sink {
+public:
+    string text;
+    string diagnosticText;
+
+    void write(const char *data, size_t size) override {
+        text.append(data, size);
+    }
+
+    void diagnostic(const char *data, size_t size) override {
+        diagnosticText.append(data, size);
+    }
+};
+
+// Reads the "// import name" lines among the comments and blank lines the module starts with
+static bool parseImports(ModuleFile &module, const unordered_map<string, size_t> &indices, size_t self,
+                         string &error) {
+    string_view text(module.text.data(), module.text.size());
+    int line = 1;
+    for (size_t pos = 0; pos < text.size(); ++line) {
+        size_t end = min(text.find('\n', pos), text.size());
+        string_view content = text.substr(pos, end - pos);
+        pos = end + 1;
+        size_t start = content.find_first_not_of(" \t\r");
+        if (start == string_view::npos) {
+            continue;
+        }
+        content.remove_prefix(start);
+        if (content.compare(0, 2, "//") != 0) {
+            return true;
+        }
+        content.remove_prefix(2);
+        content.remove_prefix(min(content.find_first_not_of(" \t"), content.size()));
+        if (content.compare(0, 7, "import ") != 0) {
+            continue;
+        }
+        content.remove_prefix(7);
+        content.remove_prefix(min(content.find_first_not_of(" \t"), content.size()));
+        content = content.substr(0, content.find_last_not_of(" \t\r") + 1);
+        auto found = indices.find(string(content));
+        if (found == indices.end() || found->second >= self) {
+            error = module.path + ": line " + to_string(line) + ": module " + string(content) +
+                    " is not on the command line before this one";
+            return false;
+        }
+        module.imports.push_back({found->second, line});
+    }
+    return true;
+}
+
+// The imported interfaces, in import order, the stamp a dependent keeps to see that none of them changed
+static uint64_t importsHash(const ModuleFile &module, const vector<unique_ptr<ModuleFile>> &modules) {
+    uint64_t hash = hashSnapshotBytes("");
+    for (auto &import : module.imports) {
+        uint64_t interfaceHash = modules[import.module]->interface.interfaceHash();
+        hash = hashSnapshotBytes(string_view(reinterpret_cast<const char *>(&interfaceHash), sizeof(interfaceHash)),
+                                 hash);
+    }
+    return hash;
+}
+
+// Declares the functions of an imported module in the global scope of ctx, on the line of the import
+static void declareImport(CheckerContext &ctx, const Prelude &interface, int line) {
+    PreludeDecl decl;
+    for (size_t i = 0; i < interface.size(); ++i) {
+        if (!interface.get(i, decl)) {
+            continue;
+        }
+        NameId name = ctx.names.intern(decl.name);
+        if (findSymbol(&ctx, name)) {
+            output::errorDef(ctx.sink, line, decl.name);
+            throw CheckError();
+        }
+        shared_ptr<SymbolTableRow> row = make_shared<SymbolTableRow>(name, ctx.signatures.intern(decl.params,
+                                                                                                 decl.ret), 0, true);
+        row->line = decl.line;
+        insertSymbol(&ctx, row);
+    }
+}
+
+static bool writeInterface(const string &path, const string &snapshot) {
+    // A dependent checked by another run never maps half an interface, the rename replaces it at once
+    ostringstream temporary;
+    temporary << path << ".tmp." << getpid() << "." << this_thread::get_id();
+    {
+        ofstream out(temporary.str(), ios::binary | ios::trunc);
+        out.write(snapshot.data(), snapshot.size());
+        if (!out) {
+            remove(temporary.str().c_str());
+            return false;
+        }
+    }
+    if (rename(temporary.str().c_str(), path.c_str()) != 0) {
+        remove(temporary.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+// Checks a module whose imports all have an interface, and writes its own interface
+static void checkModule(ModuleFile &module, const vector<unique_ptr<ModuleFile>> &modules, const SnapshotStamp &stamp,
+                        const string &interfacePath) {
+    ModuleSink sink;
+    CheckerContext ctx(sink);
+    // The global scope stays open after the parse, a module needs no main, the link looks for it
+    ctx.singleFunction = true;
+    openGlobalScope(&ctx);
+    vector<shared_ptr<SymbolTableRow>> exports;
+    try {
+        for (auto &import : module.imports) {
+            declareImport(ctx, modules[import.module]->interface, import.line);
+        }
+        auto &rows = ctx.symTabStack.front()->rows;
+        size_t declared = rows.size();
+        parseProgram(&ctx, module.text.data(), module.text.size());
+        exports.assign(rows.begin() + declared, rows.end());
+        closeCurrentScope(&ctx);
+    } catch (const CheckError &) {
+        module.state = MODULE_FAILED;
+        module.output.swap(sink.text);
+        module.diagnostic.swap(sink.diagnosticText);
+        return;
+    }
+
+    SnapshotStamp stamped = stamp;
+    stamped.output = sink.text;
+    string snapshot;
+    writeSnapshot(ctx, exports, stamped, snapshot);
+    string error;
+    if (!writeInterface(interfacePath, snapshot) || !module.interface.open(interfacePath, error)) {
+        module.state = MODULE_FAILED;
+        module.output.swap(sink.text);
+        module.diagnostic = "cannot write " + interfacePath + "\n";
+        return;
+    }
+    module.state = MODULE_CHECKED;
+}
+
+// The diagnostic of a module, "line 3: ..." becomes "lib.in: line 3: ..."
+static string moduleDiagnostic(const ModuleFile &module) {
+    return module.path + ": " + module.diagnostic;
+}
+
+// Every function name is defined once in the whole program, and one of them is void main()
+static bool linkModules(const vector<unique_ptr<ModuleFile>> &modules, string &diagnostic) {
+    unordered_set<string_view> defined;
+    bool mainFunc = false;
+    PreludeDecl decl;
+    for (auto &module : modules) {
+        for (size_t i = 0; i < module->interface.size(); ++i) {
+            if (!module->interface.get(i, decl)) {
+                continue;
+            }
+            if (!defined.insert(decl.name).second) {
+                ModuleSink sink;
+                output::errorDef(sink, decl.line, decl.name);
+                diagnostic = module->path + ": " + sink.diagnosticText;
+                return false;
+            }
+            mainFunc = mainFunc || (decl.name == "main" && decl.params.empty() && decl.ret == TYPE_VOID);
+        }
+    }
+    if (!mainFunc) {
+        ModuleSink sink;
+        output::errorMainMissing(sink);
+        diagnostic = sink.diagnosticText;
+        return false;
+    }
+    return true;
+}
+
+int runModules(const ModuleOptions &options) {
+    unsigned jobs = options.jobs ? options.jobs : thread::hardware_concurrency();
+    if (!jobs) {
+        jobs = 1;
+    }
+    auto start = chrono::steady_clock::now();
+
+    vector<unique_ptr<ModuleFile>> modules;
+    unordered_map<string, size_t> indices;
+    for (auto &path : options.paths) {
+        auto module = make_unique<ModuleFile>();
+        module->path = path;
+        module->name = filesystem::path(path).stem().string();
+        if (!module->text.open(path)) {
+            cerr << "cannot read " << path << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        if (!indices.emplace(module->name, modules.size()).second) {
+            cerr << path << ": module " << module->name << " is already on the command line" << endl;
+            return 1;
+        }
+        modules.push_back(std::move(module));
+    }
+    size_t levels = 0;
+    for (size_t i = 0; i < modules.size(); ++i) {
+        string error;
+        if (!parseImports(*modules[i], indices, i, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        for (auto &import : modules[i]->imports) {
+            modules[i]->level = max(modules[i]->level, modules[import.module]->level + 1);
+        }
+        levels = max(levels, modules[i]->level + 1);
+    }
+    error_code error;
+    filesystem::create_directories(options.interfaceDirectory, error);
+
+    WorkStealingPool pool(jobs);
+    vector<size_t> level;
+    for (size_t current = 0; current < levels; ++current) {
+        level.clear();
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (modules[i]->level == current) {
+                level.push_back(i);
+            }
+        }
+        pool.run(level.size(), [&](size_t task) {
+            ModuleFile &module = *modules[level[task]];
+            for (auto &import : module.imports) {
+                if (modules[import.module]->state == MODULE_FAILED || modules[import.module]->state == MODULE_SKIPPED) {
+                    module.state = MODULE_SKIPPED;
+                    return;
+                }
+            }
+            SnapshotStamp stamp;
+            stamp.sourceHash = hashSnapshotBytes(string_view(module.text.data(), module.text.size()));
+            stamp.importsHash = importsHash(module, modules);
+            string interfacePath = options.interfaceDirectory + "/" + module.name + ".hwi";
+            string ignored;
+            if (module.interface.open(interfacePath, ignored) && module.interface.sourceHash() == stamp.sourceHash &&
+                module.interface.importsHash() == stamp.importsHash) {
+                module.state = MODULE_UP_TO_DATE;
+                return;
+            }
+            checkModule(module, modules, stamp, interfacePath);
+        });
+    }
+
+    int status = 0;
+    size_t checked = 0;
+    size_t upToDate = 0;
+    for (auto &module : modules) {
+        checked += module->state == MODULE_CHECKED || module->state == MODULE_FAILED;
+        upToDate += module->state == MODULE_UP_TO_DATE;
+    }
+    for (auto &module : modules) {
+        if (module->state == MODULE_FAILED) {
+            string diagnostic = moduleDiagnostic(*module);
+            fwrite(module->output.data(), 1, module->output.size(), stdout);
+            fwrite(diagnostic.data(), 1, diagnostic.size(), stdout);
+            status = 1;
+            break;
+        }
+        string_view output = module->interface.output();
+        fwrite(output.data(), 1, output.size(), stdout);
+    }
+    string diagnostic;
+    if (!status && !linkModules(modules, diagnostic)) {
+        fwrite(diagnostic.data(), 1, diagnostic.size(), stdout);
+        status = 1;
+    }
+    fflush(stdout);
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    char line[256];
+    snprintf(line, sizeof(line), "%zu modules: %zu checked, %zu up to date, in %.3f s with %u jobs", modules.size(),
+             checked, upToDate, seconds, jobs);
+    cerr << line << endl;
+    return status;
+}
@@ -0,0 +1,45 @@
+//
+// Programs split across several files, each module checked against the interface files of the modules it imports
+//
+
+#ifndef HW3_MODULES_H
+#define HW3_MODULES_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A module is a program file, named by its file name without the extension, whose leading comment lines import
+// other modules:
+//     // import lists
+//     // import strings
+// It sees the functions of the modules it imports the way a program sees print and printi: they are declared before
+// its first line and listed in its global scope after printi, in import order, and imports are not transitive
+// A module only imports modules that come before it on the command line
+//
+// Checking a module prints the scopes of its functions, then its global scope, and writes its interface file: the
+// prelude snapshot of its functions (see Prelude.h), stamped with the hash of its text and with the interface hashes
+// of its imports
+// The next run replays a module whose text and imported interfaces did not change from its interface file, so editing
+// a function body only checks its module again, and editing a signature also checks the modules that import it
+// The modules whose imports are done are checked in parallel
+//
+// Once every module is valid the program is linked: no two modules have a function of the same name, and one of the
+// functions is void main()
+
+class ModuleOptions {
+public:
+    vector<string> paths;
+    // Where the interface files are, created if needed
+    string interfaceDirectory;
+    // 0 is one worker per core
+    unsigned jobs = 0;
+};
+
+// Writes the output of every module to stdout in command line order, up to the first error, which is prefixed with
+// the path of its module
+// Prints how many modules were checked and how many were up to date to stderr, returns 1 if a module or the link failed
+int runModules(const ModuleOptions &options);
+
+#endif //HW3_MODULES_H
@@ -0,0 +1,292 @@
+//
+// Precompiled preludes, see Prelude.h for the snapshot layout
+//
+
+#include "Prelude.h"
+#include "Checker.h"
+
+#include <cerrno>
+#include <cstring>
+
+uint64_t hashSnapshotBytes(string_view bytes, uint64_t hash) {
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static void appendU32(string &out, uint32_t value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void alignTo4(string &out) {
+    out.resize((out.size() + 3) & ~size_t(3));
+}
+
+static bool isParamType(uint32_t type) {
+    return type == TYPE_INT || type == TYPE_BYTE || type == TYPE_BOOL;
+}
+
+bool Prelude::open(const string &path, string &error) {
+    header = nullptr;
+    if (!file.open(path)) {
+        error = strerror(errno);
+        return false;
+    }
+    if (file.size() < sizeof(PreludeHeader)) {
+        error = "not a prelude snapshot";
+        return false;
+    }
+    const PreludeHeader *candidate = reinterpret_cast<const PreludeHeader *>(file.data());
+    if (candidate->magic != PRELUDE_MAGIC) {
+        error = "not a prelude snapshot";
+        return false;
+    }
+    if (candidate->version != PRELUDE_VERSION) {
+        error = "prelude snapshot version " + to_string(candidate->version) + ", this checker reads version " +
+                to_string(PRELUDE_VERSION);
+        return false;
+    }
+    // The sections are checked once here, the functions when they are looked up
+    auto inFile = [&](uint64_t offset, uint64_t size) {
+        return offset % 4 == 0 && offset <= file.size() && size <= file.size() - offset;
+    };
+    bool valid = inFile(candidate->functionsOffset, uint64_t(candidate->functionCount) * sizeof(PreludeFunction)) &&
+                 inFile(candidate->bucketsOffset, uint64_t(candidate->bucketCount) * sizeof(uint32_t)) &&
+                 inFile(candidate->bytesOffset, candidate->bytesSize) &&
+                 inFile(candidate->dumpOffset, candidate->dumpSize) &&
+                 inFile(candidate->outputOffset, candidate->outputSize) &&
+                 candidate->bucketCount > candidate->functionCount &&
+                 (candidate->bucketCount & (candidate->bucketCount - 1)) == 0;
+    if (!valid) {
+        error = "damaged prelude snapshot";
+        return false;
+    }
+    header = candidate;
+    return true;
+}
+
+size_t Prelude::size() const {
+    return header ? header->functionCount : 0;
+}
+
+bool Prelude::get(size_t index, PreludeDecl &decl) const {
+    if (index >= size()) {
+        return false;
+    }
+    const char *base = file.data();
+    const PreludeFunction &function = reinterpret_cast<const PreludeFunction *>(base + header->functionsOffset)[index];
+    const char *bytes = base + header->bytesOffset;
+    if (function.nameSize == 0 || function.nameOffset > header->bytesSize ||
+        function.nameSize > header->bytesSize - function.nameOffset || function.paramsOffset > header->bytesSize ||
+        function.paramCount > header->bytesSize - function.paramsOffset || function.ret > TYPE_BOOL) {
+        return false;
+    }
+    decl.name = string_view(bytes + function.nameOffset, function.nameSize);
+    decl.params.clear();
+    for (uint32_t i = 0; i < function.paramCount; ++i) {
+        unsigned char type = bytes[function.paramsOffset + i];
+        if (!isParamType(type)) {
+            return false;
+        }
+        decl.params.push_back(TypeId(type));
+    }
+    decl.ret = TypeId(function.ret);
+    decl.line = int(function.line);
+    return true;
+}
+
+ptrdiff_t Prelude::find(string_view name) const {
+    if (!header) {
+        return -1;
+    }
+    const char *base = file.data();
+    const uint32_t *buckets = reinterpret_cast<const uint32_t *>(base + header->bucketsOffset);
+    const PreludeFunction *functions = reinterpret_cast<const PreludeFunction *>(base + header->functionsOffset);
+    const char *bytes = base + header->bytesOffset;
+    uint32_t mask = header->bucketCount - 1;
+    // A valid snapshot always has an empty bucket, bucketCount > functionCount, a damaged one may have none, so the
+    // probe stops once it went around every bucket
+    uint32_t bucket = uint32_t(hashSnapshotBytes(name)) & mask;
+    for (uint32_t probes = 0; probes < header->bucketCount; ++probes, bucket = (bucket + 1) & mask) {
+        uint32_t entry = buckets[bucket];
+        if (entry == 0 || entry > header->functionCount) {
+            return -1;
+        }
+        const PreludeFunction &function = functions[entry - 1];
+        if (function.nameSize == name.size() && name.size() <= header->bytesSize &&
+            function.nameOffset <= header->bytesSize - name.size() &&
+            memcmp(bytes + function.nameOffset, name.data(), name.size()) == 0) {
+            return ptrdiff_t(entry - 1);
+        }
+    }
+    return -1;
+}
+
+string_view Prelude::dump() const {
+    if (!header) {
+        return string_view();
+    }
+    return string_view(file.data() + header->dumpOffset, header->dumpSize);
+}
+
+uint64_t Prelude::sourceHash() const {
+    return header ? header->sourceHash : 0;
+}
+
+uint64_t Prelude::importsHash() const {
+    return header ? header->importsHash : 0;
+}
+
+uint64_t Prelude::interfaceHash() const {
+    return header ? header->interfaceHash : 0;
+}
+
+string_view Prelude::output() const {
+    if (!header) {
+        return string_view();
+    }
+    return string_view(file.data() + header->outputOffset, header->outputSize);
+}
+
+// Keeps the diagnostic of the prelude, its scope dumps are never printed
+class PreludeSink : public output::Sink {
+public:
+    string diagnosticText;
+
+    void write(const char *, size_t) override {
+
+    }
+
+    void diagnostic(const char *data, size_t size) override {
+        diagnosticText.append(data, size);
+    }
+};
+
+CheckResult compilePrelude(const char *data, size_t size, string &snapshot) {
+    CheckResult result;
+    PreludeSink sink;
+    CheckerContext ctx(sink);
+    // The global scope stays open after the parse, and a prelude needs no main
+    ctx.singleFunction = true;
+    openGlobalScope(&ctx);
+    size_t builtins = ctx.symTabStack.front()->rows.size();
+    try {
+        parseProgram(&ctx, data, size);
+    } catch (const CheckError &) {
+        result.ok = false;
+        result.diagnostic = sink.diagnosticText;
+        if (!result.diagnostic.empty() && result.diagnostic.back() == '\n') {
+            result.diagnostic.pop_back();
+        }
+        return result;
+    }
+
+    vector<shared_ptr<SymbolTableRow>> rows(ctx.symTabStack.front()->rows.begin() + builtins,
+                                            ctx.symTabStack.front()->rows.end());
+    writeSnapshot(ctx, rows, SnapshotStamp(), snapshot);
+    return result;
+}
+
+void writeSnapshot(const CheckerContext &ctx, const vector<shared_ptr<SymbolTableRow>> &rows,
+                   const SnapshotStamp &stamp, string &snapshot) {
+    vector<PreludeFunction> functions;
+    string bytes;
+    output::StringSink dumpLines;
+    uint64_t interfaceHash = hashSnapshotBytes("");
+    for (auto &row : rows) {
+        string_view name = ctx.names.get(row->name);
+        const Signature &signature = ctx.signatures.get(row->type);
+        PreludeFunction function{};
+        function.nameOffset = uint32_t(bytes.size());
+        function.nameSize = uint32_t(name.size());
+        bytes.append(name);
+        function.paramsOffset = uint32_t(bytes.size());
+        function.paramCount = uint32_t(signature.params.size());
+        bytes.append(signature.params.begin(), signature.params.end());
+        function.ret = signature.ret;
+        function.line = uint32_t(row->line);
+        functions.push_back(function);
+        // The lines are left out, moving a function does not change what its callers see, and the size keeps
+        // "f" + (INT) apart from "fI" + ()
+        string types(signature.params.begin(), signature.params.end());
+        types.push_back(char(signature.ret));
+        types.push_back(char(signature.params.size()));
+        interfaceHash = hashSnapshotBytes(name, interfaceHash);
+        interfaceHash = hashSnapshotBytes(types, hashSnapshotBytes(string_view("\0", 1), interfaceHash));
+
+        vector<string> paramTypes = ctx.signatures.paramNames(row->type);
+        output::printID(dumpLines, name, row->offset, output::makeFunctionType(typeName(signature.ret), paramTypes));
+    }
+    uint32_t bucketCount = 1;
+    while (bucketCount < 2 * functions.size() + 1) {
+        bucketCount *= 2;
+    }
+    vector<uint32_t> buckets(bucketCount, 0);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        uint32_t bucket = uint32_t(hashSnapshotBytes(ctx.names.get(rows[i]->name))) & (bucketCount - 1);
+        while (buckets[bucket]) {
+            bucket = (bucket + 1) & (bucketCount - 1);
+        }
+        buckets[bucket] = uint32_t(i + 1);
+    }
+
+    PreludeHeader header{};
+    header.magic = PRELUDE_MAGIC;
+    header.version = PRELUDE_VERSION;
+    header.functionCount = uint32_t(functions.size());
+    header.bucketCount = bucketCount;
+    snapshot.assign(sizeof(header), '\0');
+    header.functionsOffset = uint32_t(snapshot.size());
+    snapshot.append(reinterpret_cast<const char *>(functions.data()), functions.size() * sizeof(PreludeFunction));
+    header.bucketsOffset = uint32_t(snapshot.size());
+    for (uint32_t bucket : buckets) {
+        appendU32(snapshot, bucket);
+    }
+    header.bytesOffset = uint32_t(snapshot.size());
+    header.bytesSize = uint32_t(bytes.size());
+    snapshot.append(bytes);
+    alignTo4(snapshot);
+    header.dumpOffset = uint32_t(snapshot.size());
+    header.dumpSize = uint32_t(dumpLines.text.size());
+    snapshot.append(dumpLines.text);
+    alignTo4(snapshot);
+    header.sourceHash = stamp.sourceHash;
+    header.importsHash = stamp.importsHash;
+    header.interfaceHash = interfaceHash;
+    header.outputOffset = uint32_t(snapshot.size());
+    header.outputSize = uint32_t(stamp.output.size());
+    snapshot.append(stamp.output);
+    memcpy(&snapshot[0], &header, sizeof(header));
+}
+
+
+shared_ptr<SymbolTableRow> findPreludeSymbol(CheckerContext *ctx, NameId name) {
+    PreludeDecl decl;
+    if (!ctx->prelude || name == NO_NAME || !ctx->prelude->get(size_t(ctx->prelude->find(ctx->names.get(name))), decl)) {
+        return nullptr;
+    }
+    // Bound under every other binding of the name, there is none since the lookup that led here found nothing
+    shared_ptr<SymbolTableRow> row = make_shared<SymbolTableRow>(name, ctx->signatures.intern(decl.params, decl.ret),
+                                                                 0, true);
+    row->line = decl.line;
+    ctx->symIndex.bind(row);
+    return row;
+}
+
+vector<shared_ptr<SymbolTableRow>> preludeSymbols(CheckerContext *ctx) {
+    vector<shared_ptr<SymbolTableRow>> rows;
+    PreludeDecl decl;
+    for (size_t i = 0; ctx->prelude && i < ctx->prelude->size(); ++i) {
+        if (!ctx->prelude->get(i, decl)) {
+            continue;
+        }
+        NameId name = ctx->names.intern(decl.name);
+        shared_ptr<SymbolTableRow> row = findSymbol(ctx, name);
+        if (row) {
+            rows.push_back(row);
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,140 @@
+//
+// Precompiled preludes, the functions of a shared prelude saved once and mapped by every check that uses them
+//
+
+#ifndef HW3_PRELUDE_H
+#define HW3_PRELUDE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.h"
+#include "Semantics.h"
+
+using namespace std;
+
+class CheckResult;
+
+// A program checked with a prelude sees its functions the way it sees print and printi: they are declared before
+// the first line, listed in the global scope after printi, and their own scopes are not printed
+// Only their signatures are kept, so such a program can be checked but not compiled
+//
+// The snapshot is read where it is mapped, opening one costs the same whatever the size of the prelude, and a check
+// only looks up the names its program uses, in a hash table of the snapshot
+// Every number is a u32 in the byte order of the machine that wrote it, except the hashes, a snapshot from a machine
+// with the other byte order is rejected by its magic number
+//
+// A snapshot is also the interface file of a module (see Modules.h), stamped with the hashes that tell whether it is
+// up to date and with the scope dumps of the module, a prelude leaves them 0 and empty
+class PreludeHeader {
+public:
+    uint32_t magic;
+    uint32_t version;
+    uint32_t functionCount;
+    // A power of 2, each bucket is a function index + 1, or 0 for an empty bucket, collisions probe the next bucket
+    uint32_t bucketCount;
+    uint32_t functionsOffset;
+    uint32_t bucketsOffset;
+    // The names and the parameter types of the functions, a byte per type
+    uint32_t bytesOffset;
+    uint32_t bytesSize;
+    // The scope dump lines of the functions, written as is when the global scope is dumped
+    uint32_t dumpOffset;
+    uint32_t dumpSize;
+    // The text the functions were checked from, and the interfaces of the modules it imports
+    uint64_t sourceHash;
+    uint64_t importsHash;
+    // The names and signatures of the functions, what a dependent sees of the snapshot
+    uint64_t interfaceHash;
+    // What checking the module printed
+    uint32_t outputOffset;
+    uint32_t outputSize;
+};
+
+class PreludeFunction {
+public:
+    // name and params are in the bytes of the snapshot
+    uint32_t nameOffset;
+    uint32_t nameSize;
+    uint32_t paramsOffset;
+    uint32_t paramCount;
+    uint32_t ret;
+    // The line of the declaration in the prelude
+    uint32_t line;
+};
+
+const uint32_t PRELUDE_MAGIC = 0x50335748; // "HW3P" in a little endian file
+const uint32_t PRELUDE_VERSION = 2;
+
+// FNV-1a, the snapshot is read by other builds, so its hashes cannot be std::hash
+uint64_t hashSnapshotBytes(string_view bytes, uint64_t hash = 14695981039346656037ull);
+
+// A function of the prelude, viewing the snapshot
+class PreludeDecl {
+public:
+    string_view name;
+    vector<TypeId> params;
+    TypeId ret;
+    int line;
+};
+
+class Prelude {
+public:
+    Prelude() = default;
+
+    Prelude(const Prelude &) = delete;
+
+    Prelude &operator=(const Prelude &) = delete;
+
+    // Maps a snapshot and checks its header, returns false with the reason in error
+    bool open(const string &path, string &error);
+
+    size_t size() const;
+
+    // Returns false if the function at index is damaged, its offsets or types are out of range
+    bool get(size_t index, PreludeDecl &decl) const;
+
+    // The index of the function named name, or -1
+    ptrdiff_t find(string_view name) const;
+
+    // The global scope lines of every function, in prelude order
+    string_view dump() const;
+
+    uint64_t sourceHash() const;
+
+    uint64_t importsHash() const;
+
+    uint64_t interfaceHash() const;
+
+    // The scope dumps of the module the snapshot is the interface of
+    string_view output() const;
+
+private:
+    MappedFile file;
+    const PreludeHeader *header = nullptr;
+};
+
+// What a module interface is stamped with, see PreludeHeader
+class SnapshotStamp {
+public:
+    uint64_t sourceHash = 0;
+    uint64_t importsHash = 0;
+    string_view output;
+};
+
+// Checks the text of a prelude, a program without main, and writes its snapshot to snapshot if it has no error
+CheckResult compilePrelude(const char *data, size_t size, string &snapshot);
+
+// Writes the snapshot of the function rows of ctx, in the order of rows
+void writeSnapshot(const CheckerContext &ctx, const vector<shared_ptr<SymbolTableRow>> &rows,
+                   const SnapshotStamp &stamp, string &snapshot);
+
+// The row of a function of ctx->prelude, made the first time the check looks it up, nullptr if there is none
+shared_ptr<SymbolTableRow> findPreludeSymbol(CheckerContext *ctx, NameId name);
+
+// The rows of every function of ctx->prelude, in prelude order, for the symbol records of the global scope
+vector<shared_ptr<SymbolTableRow>> preludeSymbols(CheckerContext *ctx);
+
+#endif //HW3_PRELUDE_H
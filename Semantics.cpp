@@ -3,18 +3,18 @@
 //
 
 #include "Semantics.h"
+#include "Ast.h"
+#include "SymbolRecords.h"
+#include "Prelude.h"
 
 #include "iostream"
+#include <cstdint>
 #include <memory>
 #include <cstring>
+#include <algorithm>
 
-extern char *yytext;
-int DEBUG = 0;
-vector<shared_ptr<SymbolTable>> symTabStack;
-vector<int> offsetStack;
-vector<string> varTypes = {"VOID", "INT", "BYTE", "BOOL", "STRING"};
-
-string currentRunningFunctionScopeId;
+const int DEBUG = 0;
+const vector<string> varTypes = {"VOID", "INT", "BYTE", "BOOL", "STRING", ""};
 
 void printVector(vector<string> vec) {
     for (auto &i : vec) {
@@ -22,142 +22,344 @@ void printVector(vector<string> vec) {
     }
 }
 
-void printMessage(string message) {
+void printMessage(string_view message) {
     std::cout << message << std::endl;
 }
 
-void printSymTabRow(shared_ptr<SymbolTableRow> row) {
-    std::cout << row->name << " | ";
-    printVector(row->type);
-    std::cout << " | " << row->offset << " | " << row->isFunc << std::endl;
+void printSymTabRow(CheckerContext *ctx, shared_ptr<SymbolTableRow> row) {
+    std::cout << ctx->names.get(row->name) << " | ";
+    if (row->isFunc) {
+        printVector(ctx->signatures.paramNames(row->type));
+    }
+    std::cout << typeName(row->valueType(ctx->signatures)) << " | " << row->offset << " | " << row->isFunc << std::endl;
 }
 
-void printSymTableStack() {
-    std::cout << "Size of global symbol table stack is: " << symTabStack.size() << std::endl;
+void printSymTableStack(CheckerContext *ctx) {
+    std::cout << "Size of global symbol table stack is: " << ctx->symTabStack.size() << std::endl;
     std::cout << "id | parameter types | offset | is func" << std::endl;
-    for (int i = symTabStack.size() - 1; i >= 0; --i) {
-        for (auto &row : symTabStack[i]->rows) {
-            printSymTabRow(row);
+    for (int i = ctx->symTabStack.size() - 1; i >= 0; --i) {
+        for (auto &row : ctx->symTabStack[i]->rows) {
+            printSymTabRow(ctx, row);
         }
     }
 }
 
-int loopCounter = 0;
-int switchCounter = 0;
-
-void enterSwitch() {
+void enterSwitch(CheckerContext *ctx) {
     if (DEBUG) printMessage("Entering Switch block");
-    switchCounter++;
+    ctx->switchCounter++;
 }
 
-void exitSwitch() {
+void exitSwitch(CheckerContext *ctx) {
     if (DEBUG) printMessage("Exiting Switch block");
-    switchCounter--;
+    ctx->switchCounter--;
+}
+
+void enterLoop(CheckerContext *ctx) {
+    ctx->loopCounter++;
+}
+
+void exitLoop(CheckerContext *ctx) {
+    ctx->loopCounter--;
 }
 
-void enterLoop() {
-    loopCounter++;
+// A new node of the syntax tree, NO_NODE if no tree is built
+static AstId addNode(CheckerContext *ctx, AstKind kind, TypeId type) {
+    if (!ctx->ast) {
+        return NO_NODE;
+    }
+    return ctx->ast->add(kind, type, ctx->lineno());
 }
 
-void exitLoop() {
-    loopCounter--;
+static void appendNode(CheckerContext *ctx, AstId parent, AstId child) {
+    if (ctx->ast) {
+        ctx->ast->append(parent, child);
+    }
 }
 
-void exitProgramFuncs() {
-    currentRunningFunctionScopeId = "";
+static void appendNodes(CheckerContext *ctx, AstId parent, const vector<AstId> &children) {
+    for (AstId child : children) {
+        appendNode(ctx, parent, child);
+    }
 }
 
-void exitProgramRuntime() {
+// Copies the folded value of a constant expression to its node
+static void recordConstant(CheckerContext *ctx, Exp *exp) {
+    if (exp->node != NO_NODE && exp->isConstant) {
+        ctx->ast->constant[exp->node] = true;
+        ctx->ast->value[exp->node] = exp->constantValue;
+    }
+}
+
+void exitProgramFuncs(CheckerContext *ctx, FuncDecl *func, Statements *body) {
+    appendNodes(ctx, func->node, body->statements);
+    ctx->currentRunningFunctionScopeId = NO_NAME;
+    // Nothing parsed inside the function is used after its body is done, the next function reuses the memory
+    ctx->nodes.reset();
+}
+
+void exitProgramRuntime(CheckerContext *ctx) {
+    if (ctx->singleFunction) {
+        return;
+    }
     if (DEBUG) {
         printMessage("I am entering program runtime");
     }
-    shared_ptr<SymbolTable> globalScope = symTabStack.front();
-    bool mainFunc = false;
-    for (auto &row : globalScope->rows) {
-        if (row->isFunc && row->name == "main" && row->type.back() == "VOID" && row->type.size() == 1) {
-            mainFunc = true;
-        }
-    }
+    // Only the global scope is still open, so the binding of main (if any) is a global one
+    // Interned, main may be a function of the prelude that the program never names
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, ctx->names.intern("main"));
+    bool mainFunc = row && row->isFunc && row->type == ctx->signatures.find({}, TYPE_VOID);
     if (!mainFunc) {
-        output::errorMainMissing();
-        exit(0);
+        output::errorMainMissing(ctx->sink);
+        throw CheckError();
     }
-    closeCurrentScope();
+    closeCurrentScope(ctx);
     if (DEBUG) printMessage("I am exiting program runtime");
 }
 
-void openNewScope() {
+void openNewScope(CheckerContext *ctx) {
     if (DEBUG) printMessage("creating scope");
     shared_ptr<SymbolTable> nScope = make_shared<SymbolTable>();
-    symTabStack.push_back(nScope);
-    offsetStack.push_back(offsetStack.back());
+    ctx->symTabStack.push_back(nScope);
+    ctx->offsetStack.push_back(ctx->offsetStack.back());
+    COUNT_STAT(ctx, scopesOpened, 1);
     if (DEBUG) printMessage("done creating");
 }
 
-void closeCurrentScope() {
-    output::endScope();
-    shared_ptr<SymbolTable> currentScope = symTabStack.back();
-    for (auto &row : currentScope->rows) {
+// The number of rows the global scope starts with, print and printi, the functions of a prelude come after them
+const size_t BUILTIN_FUNCTIONS = 2;
+
+// The graded dump of a scope that is being closed
+static void dumpScope(CheckerContext *ctx, const SymbolTable &scope) {
+    output::endScope(ctx->sink);
+    // The lines of the prelude functions were written when the prelude was compiled
+    size_t preludeAt = ctx->prelude && ctx->symTabStack.size() == 1 ? BUILTIN_FUNCTIONS : scope.rows.size() + 1;
+    for (size_t i = 0; i <= scope.rows.size(); ++i) {
+        if (i == preludeAt) {
+            ctx->sink.write(ctx->prelude->dump().data(), ctx->prelude->dump().size());
+        }
+        if (i == scope.rows.size()) {
+            break;
+        }
+        const shared_ptr<SymbolTableRow> &row = scope.rows[i];
+        size_t written;
         if (!row->isFunc) {
             // Print a normal variable
-            output::printID(row->name, row->offset, row->type[0]);
+            written = output::printID(ctx->sink, ctx->names.get(row->name), row->offset,
+                                      typeName(row->valueType(ctx->signatures)));
         } else {
-            string funcReturnType = row->type.back();
-            // Taking out the return type from the vector for easy printing
-            row->type.pop_back();
-            output::printID(row->name, row->offset,
-                            output::makeFunctionType(funcReturnType, row->type));
+            vector<string> paramTypes = ctx->signatures.paramNames(row->type);
+            written = output::printID(ctx->sink, ctx->names.get(row->name), row->offset,
+                                      output::makeFunctionType(typeName(row->valueType(ctx->signatures)), paramTypes));
         }
+        COUNT_STAT(ctx, bytesWritten, written);
     }
+}
 
+void closeCurrentScope(CheckerContext *ctx) {
+    shared_ptr<SymbolTable> currentScope = ctx->symTabStack.back();
+    if (ctx->scopeObserver) {
+        ctx->scopeObserver->scopeClosed(*ctx, *currentScope, ctx->symTabStack.size() - 1);
+    }
+    if (ctx->symbolRecords && ctx->prelude && ctx->symTabStack.size() == 1) {
+        SymbolTable global;
+        global.rows.assign(currentScope->rows.begin(), currentScope->rows.begin() + BUILTIN_FUNCTIONS);
+        vector<shared_ptr<SymbolTableRow>> prelude = preludeSymbols(ctx);
+        global.rows.insert(global.rows.end(), prelude.begin(), prelude.end());
+        global.rows.insert(global.rows.end(), currentScope->rows.begin() + BUILTIN_FUNCTIONS, currentScope->rows.end());
+        ctx->symbolRecords->scope(*ctx, global, 0);
+    } else if (ctx->symbolRecords) {
+        ctx->symbolRecords->scope(*ctx, *currentScope, ctx->symTabStack.size() - 1);
+    } else {
+        dumpScope(ctx, *currentScope);
+    }
+    COUNT_STAT(ctx, scopesClosed, 1);
+
+    ctx->symIndex.unbind(*currentScope);
     currentScope->rows.clear();
-    symTabStack.pop_back();
-    offsetStack.pop_back();
+    ctx->symTabStack.pop_back();
+    ctx->offsetStack.pop_back();
+
+}
+
+CheckerContext::CheckerContext(output::Sink &sink) : sink(sink) {
+
+}
+
+TypeNode *CheckerContext::identifier(string_view text) {
+    NameId name = names.intern(text);
+    return nodes.make<TypeNode>(names.get(name), name);
+}
+
+const char *CheckError::what() const noexcept {
+    return "program check failed";
+}
 
+void SymbolIndex::bind(const shared_ptr<SymbolTableRow> &row) {
+    if (size_t(row->name) >= bindings.size()) {
+        bindings.resize(row->name + 1);
+    }
+    bindings[row->name].push_back(row);
+}
+
+void SymbolIndex::unbind(const SymbolTable &scope) {
+    for (auto &row : scope.rows) {
+        if (size_t(row->name) < bindings.size() && !bindings[row->name].empty()) {
+            bindings[row->name].pop_back();
+        }
+    }
 }
 
-bool isDeclared(const string &name) {
+shared_ptr<SymbolTableRow> SymbolIndex::lookup(NameId name) const {
+    if (name < 0 || size_t(name) >= bindings.size() || bindings[name].empty()) {
+        return nullptr;
+    }
+    return bindings[name].back();
+}
+
+void insertSymbol(CheckerContext *ctx, const shared_ptr<SymbolTableRow> &row) {
+    ctx->symTabStack.back()->rows.push_back(row);
+    ctx->symIndex.bind(row);
+}
+
+shared_ptr<SymbolTableRow> findSymbol(CheckerContext *ctx, NameId name) {
+    shared_ptr<SymbolTableRow> row = ctx->symIndex.lookup(name);
+    if (!row && ctx->prelude) {
+        row = findPreludeSymbol(ctx, name);
+    }
+    // The index looks at a single row, a count above the number of lookups means a scan crept back in
+    COUNT_STAT(ctx, lookups, 1);
+    COUNT_STAT(ctx, rowsScanned, row ? 1 : 0);
+    return row;
+}
+
+bool isDeclared(CheckerContext *ctx, NameId name) {
     if (DEBUG) {
         printMessage("In is declared for");
-        printMessage(name);
-        printSymTableStack();
-    }
-    for (int i = symTabStack.size() - 1; i >= 0; --i) {
-        for (auto &row : symTabStack[i]->rows) {
-            if (row->name == name) {
-                if (DEBUG) printMessage("found id");
-                return true;
-            }
-        }
+        printMessage(ctx->names.get(name));
+        printSymTableStack(ctx);
+    }
+    if (findSymbol(ctx, name)) {
+        if (DEBUG) printMessage("found id");
+        return true;
     }
     if (DEBUG) printMessage("can't find id");
     return false;
 }
 
-bool isDeclaredVariable(const string &name) {
+bool isDeclaredVariable(CheckerContext *ctx, NameId name) {
     if (DEBUG) {
         printMessage("In is declared for");
-        printMessage(name);
-        printSymTableStack();
-    }
-    for (int i = symTabStack.size() - 1; i >= 0; --i) {
-        for (auto &row : symTabStack[i]->rows) {
-            if (row->name == name && !row->isFunc) {
-                if (DEBUG) printMessage("found id");
-                return true;
-            }
-        }
+        printMessage(ctx->names.get(name));
+        printSymTableStack(ctx);
+    }
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, name);
+    if (row && !row->isFunc) {
+        if (DEBUG) printMessage("found id");
+        return true;
     }
     if (DEBUG) printMessage("can't find id");
     return false;
 }
 
-SymbolTableRow::SymbolTableRow(string name, vector<string> type, int offset, bool isFunc) : name(std::move(name)), type(std::move(type)),
-                                                                                            offset(offset), isFunc(isFunc) {
+const string &typeName(TypeId type) {
+    return varTypes[type];
+}
+
+TypeId typeFromName(string_view name) {
+    for (unsigned int i = 0; i < TYPE_NONE; ++i) {
+        if (varTypes[i] == name) {
+            return TypeId(i);
+        }
+    }
+    return TYPE_NONE;
+}
+
+Signature::Signature(vector<TypeId> params, TypeId ret) : params(std::move(params)), ret(ret) {
+
+}
+
+// The hash key of a signature is its type tags, one byte each, with the return type last
+static string signatureKey(const vector<TypeId> &params, TypeId ret) {
+    string key(params.begin(), params.end());
+    key.push_back(char(ret));
+    return key;
+}
+
+SigId SignatureTable::intern(const vector<TypeId> &params, TypeId ret) {
+    auto inserted = ids.emplace(signatureKey(params, ret), signatures.size());
+    if (inserted.second) {
+        signatures.emplace_back(params, ret);
+        ParamsId paramsId = NO_PARAMS;
+        for (TypeId param : params) {
+            paramsId = extendParams(paramsId, param);
+        }
+        signatures.back().paramsId = paramsId;
+    }
+    return inserted.first->second;
+}
+
+ParamsId SignatureTable::extendParams(ParamsId prefix, TypeId next) {
+    uint64_t key = (uint64_t(prefix) << 8) | uint8_t(next);
+    // NO_PARAMS is taken, the first list made is 1
+    return paramLists.emplace(key, ParamsId(paramLists.size() + 1)).first->second;
+}
+
+SigId SignatureTable::find(const vector<TypeId> &params, TypeId ret) const {
+    auto it = ids.find(signatureKey(params, ret));
+    if (it == ids.end()) {
+        return -1;
+    }
+    return it->second;
+}
+
+const Signature &SignatureTable::get(SigId id) const {
+    return signatures[id];
+}
+
+vector<string> SignatureTable::paramNames(SigId id) const {
+    vector<string> names;
+    for (TypeId param : signatures[id].params) {
+        names.push_back(typeName(param));
+    }
+    return names;
+}
+
+NameId NameTable::intern(string_view name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    names.emplace_back(name);
+    NameId id = NameId(names.size() - 1);
+    ids.emplace(names.back(), id);
+    return id;
+}
+
+NameId NameTable::find(string_view name) const {
+    auto it = ids.find(name);
+    if (it == ids.end()) {
+        return NO_NAME;
+    }
+    return it->second;
+}
 
+string_view NameTable::get(NameId id) const {
+    return names[id];
+}
+
+SymbolTableRow::SymbolTableRow(NameId name, int type, int offset, bool isFunc) : name(name), type(type),
+                                                                                  offset(offset), isFunc(isFunc) {
+
+}
+
+TypeId SymbolTableRow::valueType(const SignatureTable &signatures) const {
+    if (isFunc) {
+        return signatures.get(type).ret;
+    }
+    return TypeId(type);
 }
 
-TypeNode::TypeNode(string str) : value() {
+TypeNode::TypeNode(string_view str) : value() {
     if (str == "void") {
         value = "VOID";
     } else if (str == "bool") {
@@ -171,6 +373,10 @@ TypeNode::TypeNode(string str) : value() {
     }
 }
 
+TypeNode::TypeNode(string_view str, NameId name) : value(str), name(name) {
+
+}
+
 TypeNode::TypeNode() {
     value = "";
 }
@@ -180,236 +386,299 @@ ostream &operator<<(ostream &os, const TypeNode &node) {
     return os;
 }
 
-Program::Program() : TypeNode("Program") {
+Program::Program(CheckerContext *ctx) : TypeNode("Program") {
+    if (!ctx->singleFunction) {
+        openGlobalScope(ctx);
+    }
+    node = addNode(ctx, AST_PROGRAM, TYPE_NONE);
+    if (ctx->ast) {
+        ctx->ast->root = node;
+    }
+}
+
+void openGlobalScope(CheckerContext *ctx) {
     shared_ptr<SymbolTable> symTab = std::make_shared<SymbolTable>();
-    shared_ptr<SymbolTableRow> printFunc = std::make_shared<SymbolTableRow>(SymbolTableRow("print", {"STRING", "VOID"}, 0, true));
-    shared_ptr<SymbolTableRow> printiFunc = std::make_shared<SymbolTableRow>(SymbolTableRow("printi", {"INT", "VOID"}, 0, true));
-    // Placing the print and printi function at the bottom of the global symbol table
-    symTab->rows.push_back(printFunc);
-    symTab->rows.push_back(printiFunc);
+    shared_ptr<SymbolTableRow> printFunc = std::make_shared<SymbolTableRow>(ctx->names.intern("print"), ctx->signatures.intern({TYPE_STRING}, TYPE_VOID), 0, true);
+    shared_ptr<SymbolTableRow> printiFunc = std::make_shared<SymbolTableRow>(ctx->names.intern("printi"), ctx->signatures.intern({TYPE_INT}, TYPE_VOID), 0, true);
     // Placing the global symbol table at the bottom of the global symbol table stack
-    symTabStack.push_back(symTab);
+    ctx->symTabStack.push_back(symTab);
+    // Placing the print and printi function at the bottom of the global symbol table
+    insertSymbol(ctx, printFunc);
+    insertSymbol(ctx, printiFunc);
     // Placing the global symbol table at the bottom of the offset stack
-    offsetStack.push_back(0);
+    ctx->offsetStack.push_back(0);
+    COUNT_STAT(ctx, scopesOpened, 1);
 }
 
-RetType::RetType(TypeNode *type) : TypeNode(type->value) {
+RetType::RetType(TypeNode *type) : TypeNode(type->value), type(typeFromName(type->value)) {
 
 }
 
-Type::Type(TypeNode *type) : TypeNode(type->value) {
+Type::Type(TypeNode *type) : TypeNode(type->value), type(typeFromName(type->value)) {
 
 }
 
-FormalDecl::FormalDecl(Type *t, TypeNode *id) : TypeNode(id->value), type(t->value) {
+FormalDecl::FormalDecl(Type *t, TypeNode *id) : TypeNode(id->value, id->name), type(t->type) {
 
 }
 
 FormalsList::FormalsList(FormalDecl *formal) {
-    formals.insert(formals.begin(), formal);
+    formals.push_back(formal);
 }
 
-FormalsList::FormalsList(FormalDecl *formal, FormalsList *fList) {
-    formals = vector<FormalDecl *>(fList->formals);
-    formals.insert(formals.begin(), formal);
+FormalsList::FormalsList(FormalsList *fList, FormalDecl *formal) : formals(std::move(fList->formals)) {
+    formals.push_back(formal);
 }
 
 Formals::Formals() = default;
 
-Formals::Formals(FormalsList *formList) {
-    formals = vector<FormalDecl *>(formList->formals);
+Formals::Formals(FormalsList *formList) : formals(std::move(formList->formals)) {
+
 }
 
-FuncDecl::FuncDecl(RetType *rType, TypeNode *id, Formals *funcParams) {
+FuncDecl::FuncDecl(CheckerContext *ctx, RetType *rType, TypeNode *id, Formals *funcParams) {
     if (DEBUG) printMessage("I am in func decl");
-    if (isDeclared(id->value)) {
+    if (isDeclared(ctx, id->name)) {
         // Trying to redeclare a name that is already used for a different variable/fucntion
-        output::errorDef(yylineno, id->value);
-        exit(0);
+        output::errorDef(ctx->sink, ctx->lineno(), id->value);
+        throw CheckError();
     }
 
+    // A single pass over the parameters, the reported parameter is the first one that either
+    // shadows a name that was already declared, has the same name as the function,
+    // or has the same name as a parameter after it
+    unordered_map<NameId, unsigned int> firstIndexOf;
+    unsigned int firstIllegal = funcParams->formals.size();
+    vector<TypeId> paramTypes;
     for (unsigned int i = 0; i < funcParams->formals.size(); ++i) {
-        if (isDeclared(funcParams->formals[i]->value) || funcParams->formals[i]->value == id->value) {
+        NameId name = funcParams->formals[i]->name;
+        auto inserted = firstIndexOf.emplace(name, i);
+        if (!inserted.second) {
+            // Trying to declare a function where 2 parameters or more have the same name, the first of them is the illegal one
+            firstIllegal = min(firstIllegal, inserted.first->second);
+        } else if (i < firstIllegal && (isDeclared(ctx, name) || name == id->name)) {
             // Trying to shadow inside the function a variable that was already declared
             // Or trying to name a function with the same name as one of the function parameters
-            output::errorDef(yylineno, funcParams->formals[i]->value);
-            exit(0);
-        }
-
-        for (unsigned int j = i + 1; j < funcParams->formals.size(); ++j) {
-            if (funcParams->formals[i]->value == funcParams->formals[j]->value) {
-                // Trying to declare a function where 2 parameters or more have the same name
-                output::errorDef(yylineno, funcParams->formals[i]->value);
-                exit(0);
-            }
+            firstIllegal = i;
         }
+        // Saving the types of all the different function parameters
+        paramTypes.push_back(funcParams->formals[i]->type);
+        parameters.push_back(make_shared<SymbolTableRow>(name, funcParams->formals[i]->type, -int(i) - 1, false));
+        parameters.back()->line = ctx->lineno();
+    }
+    if (firstIllegal < funcParams->formals.size()) {
+        output::errorDef(ctx->sink, ctx->lineno(), funcParams->formals[firstIllegal]->value);
+        throw CheckError();
     }
 
     // This is the name of the newly declared function
     value = id->value;
-    if (funcParams->formals.size() != 0) {
-        // Saving the types of all the different function parameters
-        for (auto &formal : funcParams->formals) {
-            type.push_back(formal->type);
-        }
-    } else {
-        // The func has no input parameters, no need to add a specific parameter type
-    }
-    // Saving the return type of the function
-    type.push_back(rType->value);
+    name = id->name;
+    // Interning the parameter types together with the return type of the function
+    type = ctx->signatures.intern(paramTypes, rType->type);
 
     // Adding the new function to the symTab
-    shared_ptr<SymbolTableRow> nFunc = std::make_shared<SymbolTableRow>(value, type, 0, true);
-    symTabStack.back()->rows.push_back(nFunc);
-    currentRunningFunctionScopeId = value;
+    shared_ptr<SymbolTableRow> nFunc = std::make_shared<SymbolTableRow>(name, type, 0, true);
+    nFunc->line = ctx->lineno();
+    insertSymbol(ctx, nFunc);
+
+    if (ctx->ast) {
+        node = addNode(ctx, AST_FUNCTION, rType->type);
+        ctx->ast->name[node] = name;
+        nFunc->node = node;
+        appendNode(ctx, ctx->ast->root, node);
+        for (unsigned int i = 0; i < parameters.size(); ++i) {
+            AstId formal = addNode(ctx, AST_FORMAL, paramTypes[i]);
+            ctx->ast->name[formal] = parameters[i]->name;
+            ctx->ast->value[formal] = parameters[i]->offset;
+            parameters[i]->node = formal;
+            appendNode(ctx, node, formal);
+        }
+    }
+    ctx->currentRunningFunctionScopeId = name;
     if (DEBUG) printMessage("exiting func decl");
 }
 
-Call::Call(TypeNode *id) {
-    for (auto &symTab : symTabStack) {
-        for (auto &row : symTab->rows) {
-            if (row->name == id->value) {
-                if (!row->isFunc) {
-                    // We found a declaration of a variable with the same name, illegal
-                    output::errorUndefFunc(yylineno, id->value);
-                    exit(0);
-                } else if (row->isFunc && row->type.size() == 1) {
-                    // We found the right function, has the same name, it really is a function, and receives no parameters
-                    // Saving the type of the function call return value
-                    value = row->type.back();
-                    return;
-                } else {
-                    row->type.pop_back();
-                    output::errorPrototypeMismatch(yylineno, id->value, row->type);
-                    exit(0);
-                }
-            }
+void Call::recordCall(CheckerContext *ctx, TypeNode *id, const shared_ptr<SymbolTableRow> &row, ExpList *args) {
+    node = addNode(ctx, AST_CALL, type);
+    if (node == NO_NODE) {
+        return;
+    }
+    ctx->ast->name[node] = id->name;
+    ctx->ast->ref[node] = row->node;
+    if (args) {
+        for (Exp *arg : args->list) {
+            appendNode(ctx, node, arg->node);
+        }
+    }
+}
+
+Call::Call(CheckerContext *ctx, TypeNode *id) {
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, id->name);
+    if (row) {
+        if (!row->isFunc) {
+            // We found a declaration of a variable with the same name, illegal
+            output::errorUndefFunc(ctx->sink, ctx->lineno(), id->value);
+            throw CheckError();
+        } else if (row->isFunc && ctx->signatures.get(row->type).params.empty()) {
+            // We found the right function, has the same name, it really is a function, and receives no parameters
+            // Saving the type of the function call return value
+            type = row->valueType(ctx->signatures);
+            value = typeName(type);
+            recordCall(ctx, id, row);
+            return;
+        } else {
+            vector<string> paramTypes = ctx->signatures.paramNames(row->type);
+            output::errorPrototypeMismatch(ctx->sink, ctx->lineno(), id->value, paramTypes);
+            throw CheckError();
         }
     }
     // We didn't find a declaration of the desired function
-    output::errorUndefFunc(yylineno, id->value);
-    exit(0);
+    output::errorUndefFunc(ctx->sink, ctx->lineno(), id->value);
+    throw CheckError();
 }
 
-Call::Call(TypeNode *id, ExpList *list) {
+Call::Call(CheckerContext *ctx, TypeNode *id, ExpList *list) {
     if (DEBUG) printMessage("in call id list");
-    for (auto &symTab : symTabStack) {
-        for (auto &row : symTab->rows) {
-            if (row->name == id->value) {
-                if (!row->isFunc) {
-                    // We found a declaration of a variable with the same name, illegal
-                    output::errorUndefFunc(yylineno, id->value);
-                    exit(0);
-                } else if (row->isFunc && row->type.size() == list->list.size() + 1) {
-                    // We found the right function, has the same name, it really is a function
-                    // Now we need to check that the parameter types are correct between what the function accepts, and what was sent
-                    for (unsigned int i = 0; i < list->list.size(); ++i) {
-                        if (list->list[i].type == row->type[i]) {
-                            // This parameter is of matching type so it is ok
-                            continue;
-                        } else if (list->list[i].type == "BYTE" && row->type[i] == "INT") {
-                            // The function receives int as a paramter, in this instance a byte was sent, but it is ok to cast from BYTE to INT
-                            continue;
-                        }
-                        // Removing the return type of the function so we have an easy list of requested parameters to print
-                        row->type.pop_back();
-                        output::errorPrototypeMismatch(yylineno, id->value, row->type);
-                        exit(0);
-                    }
-                    // Saving the type of the function call return value
-                    value = row->type.back();
-                    return;
-                } else {
-                    // The number of parameters we received does not match the number the function takes as arguments
-                    // Removing the return type of the function so we have an easy list of requested parameters to print
-                    row->type.pop_back();
-                    output::errorPrototypeMismatch(yylineno, id->value, row->type);
-                    exit(0);
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, id->name);
+    if (row) {
+        if (!row->isFunc) {
+            // We found a declaration of a variable with the same name, illegal
+            output::errorUndefFunc(ctx->sink, ctx->lineno(), id->value);
+            throw CheckError();
+        }
+        const Signature &funcSignature = ctx->signatures.get(row->type);
+        type = funcSignature.ret;
+        value = typeName(type);
+        if (funcSignature.paramsId == list->types) {
+            // The arguments have exactly the types of the parameters, the lists are interned so this is one compare
+            recordCall(ctx, id, row, list);
+            return;
+        }
+        if (funcSignature.params.size() == list->list.size()) {
+            // We found the right function, has the same name, it really is a function
+            // Now we need to check that the parameter types are correct between what the function accepts, and what was sent
+            // Only a byte passed for an int, or a wrong argument, gets here
+            for (unsigned int i = 0; i < list->list.size(); ++i) {
+                TypeId argType = list->list[i]->type;
+                if (argType == funcSignature.params[i]) {
+                    // This parameter is of matching type so it is ok
+                    continue;
+                } else if (argType == TYPE_BYTE && funcSignature.params[i] == TYPE_INT) {
+                    // The function receives int as a paramter, in this instance a byte was sent, but it is ok to cast from BYTE to INT
+                    continue;
                 }
+                vector<string> paramTypes = ctx->signatures.paramNames(row->type);
+                output::errorPrototypeMismatch(ctx->sink, ctx->lineno(), id->value, paramTypes);
+                throw CheckError();
             }
+            recordCall(ctx, id, row, list);
+            return;
+        } else {
+            // The number of parameters we received does not match the number the function takes as arguments
+            vector<string> paramTypes = ctx->signatures.paramNames(row->type);
+            output::errorPrototypeMismatch(ctx->sink, ctx->lineno(), id->value, paramTypes);
+            throw CheckError();
         }
     }
     // We didn't find a declaration of the desired function
-    output::errorUndefFunc(yylineno, id->value);
-    exit(0);
+    output::errorUndefFunc(ctx->sink, ctx->lineno(), id->value);
+    throw CheckError();
 }
 
 Exp::Exp(Call *call) {
     // Need to just take the return value of the function and use it as the return type of the expression
     if (DEBUG) printMessage("in exp call");
     value = call->value;
-    type = call->value;
+    type = call->type;
+    node = call->node;
 }
 
-Exp::Exp(TypeNode *id) {
+Exp::Exp(CheckerContext *ctx, TypeNode *id) {
     // Need to make sure that the variable/func we want to use is declared
     if (DEBUG) {
         printMessage("creating exp from id:");
         printMessage(id->value);
     }
-    if (!isDeclaredVariable(id->value)) {
-        output::errorUndef(yylineno, id->value);
-        exit(0);
+    if (!isDeclaredVariable(ctx, id->name)) {
+        output::errorUndef(ctx->sink, ctx->lineno(), id->value);
+        throw CheckError();
     }
 
     // Need to save the type of the variable function as the type of the expression
-    for (int i = symTabStack.size() - 1; i >= 0; --i) {
-        for (auto &row : symTabStack[i]->rows) {
-            if (row->name == id->value) {
-                if (DEBUG) {
-                    printMessage("found a variable with name in symtab:");
-                    printMessage(row->name);
-                }
-                // We found the variable/func we wanted to use in the expression
-                value = id->value;
-                // Getting the type of the variable, or the return type of the function
-                type = row->type.back();
-                return;
-            }
-        }
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, id->name);
+    if (DEBUG) {
+        printMessage("found a variable with name in symtab:");
+        printMessage(ctx->names.get(row->name));
+    }
+    // We found the variable/func we wanted to use in the expression
+    value = id->value;
+    // Getting the type of the variable, or the return type of the function
+    type = row->valueType(ctx->signatures);
+    node = addNode(ctx, AST_ID, type);
+    if (node != NO_NODE) {
+        ctx->ast->name[node] = id->name;
+        ctx->ast->ref[node] = row->node;
     }
 }
 
-Exp::Exp(TypeNode *notNode, Exp *exp) {
-    if (exp->type != "BOOL") {
+Exp::Exp(CheckerContext *ctx, TypeNode *notNode, Exp *exp) {
+    if (exp->type != TYPE_BOOL) {
         // This is not a boolean expression, can't apply NOT
-        output::errorMismatch(yylineno);
-        exit(0);
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
-    type = "BOOL";
-    valueAsBooleanValue = !valueAsBooleanValue;
+    type = TYPE_BOOL;
+    isConstant = exp->isConstant;
+    constantValue = !exp->constantValue;
+    node = addNode(ctx, AST_NOT, type);
+    appendNode(ctx, node, exp->node);
+    recordConstant(ctx, this);
 }
 
-Exp::Exp(TypeNode *terminal, string taggedTypeFromParser) : TypeNode(terminal->value) {
+// The value of a NUM token, saturated just above the int range so that huge literals cannot overflow here
+static int64_t literalValue(string_view digits) {
+    int64_t value = 0;
+    for (char digit : digits) {
+        value = min<int64_t>(value * 10 + (digit - '0'), int64_t(INT32_MAX) + 1);
+    }
+    return value;
+}
+
+Exp::Exp(CheckerContext *ctx, TypeNode *terminal, TypeId taggedTypeFromParser) : TypeNode(terminal->value) {
     if (DEBUG) {
         printMessage("in for num byte");
         printMessage(terminal->value);
         printMessage("tagged type:");
-        printMessage(taggedTypeFromParser);
+        printMessage(typeName(taggedTypeFromParser));
 
     }
     type = taggedTypeFromParser;
-    if (taggedTypeFromParser == "NUM") {
-        type = "INT";
-    }
-    if (type == "BYTE") {
+    if (type == TYPE_INT || type == TYPE_BYTE) {
+        int64_t literal = literalValue(terminal->value);
         // Need to check that BYTE size is legal
-        if (stoi(terminal->value) > 255) {
+        if (type == TYPE_BYTE && literal > 255) {
             // Byte is too large
-            output::errorByteTooLarge(yylineno, terminal->value);
-            exit(0);
+            output::errorByteTooLarge(ctx->sink, ctx->lineno(), terminal->value);
+            throw CheckError();
         }
+        // An int literal above the int range has no value the program could compute with
+        isConstant = literal <= INT32_MAX;
+        constantValue = isConstant ? int(literal) : 0;
     }
-    if (type == "BOOL") {
-        if (terminal->value == "true") {
-            valueAsBooleanValue = true;
-        } else {
-            valueAsBooleanValue = false;
-        }
+    if (type == TYPE_BOOL) {
+        isConstant = true;
+        constantValue = terminal->value == "true";
+    }
+    node = addNode(ctx, AST_LITERAL, type);
+    if (node != NO_NODE && type == TYPE_STRING) {
+        ctx->ast->value[node] = int(ctx->ast->strings.size());
+        ctx->ast->strings.emplace_back(terminal->value);
     }
+    recordConstant(ctx, this);
     if (DEBUG) {
         printMessage("now tagged as:");
-        printMessage(type);
+        printMessage(typeName(type));
     }
 }
 
@@ -417,243 +686,314 @@ Exp::Exp(Exp *ex) {
     if (DEBUG) {
         printMessage("=====exp ex=====");
         printMessage(ex->value);
-        printMessage(ex->type);
+        printMessage(typeName(ex->type));
     }
-//    if (ex->type != "BOOL") {
-//        output::errorMismatch(yylineno);
-//        exit(0);
+//    if (ex->type != TYPE_BOOL) {
+//        output::errorMismatch(ctx->sink, ctx->lineno());
+//        throw CheckError();
 //    }
     value = ex->value;
     type = ex->type;
-    valueAsBooleanValue = ex->valueAsBooleanValue;
+    isConstant = ex->isConstant;
+    constantValue = ex->constantValue;
+    // The tree has no node for the parentheses, its shape already groups the operands
+    node = ex->node;
+}
+
+// Folds an arithmetic or relational operator over two constant numbers, the way the program computes it:
+// int arithmetic wraps around at 32 bits, byte arithmetic at 8 bits, and byte division is unsigned
+// Returns false if the operation has no value (a division by zero, or the one int division that overflows)
+static bool foldNumbers(string_view op, int64_t left, int64_t right, TypeId resultType, int &result,
+                        bool &overflow) {
+    int64_t value;
+    if (op == "+") {
+        value = left + right;
+    } else if (op == "-") {
+        value = left - right;
+    } else if (op == "*") {
+        value = left * right;
+    } else if (op == "/") {
+        if (right == 0 || (resultType == TYPE_INT && left == INT32_MIN && right == -1)) {
+            return false;
+        }
+        value = left / right;
+    } else if (op == "==") {
+        value = left == right;
+    } else if (op == "!=") {
+        value = left != right;
+    } else if (op == "<") {
+        value = left < right;
+    } else if (op == ">") {
+        value = left > right;
+    } else if (op == "<=") {
+        value = left <= right;
+    } else {
+        value = left >= right;
+    }
+    if (resultType == TYPE_BYTE) {
+        overflow = value < 0 || value > 255;
+        result = int(value & 0xff);
+    } else {
+        // Both operands and the exact result fit in 64 bits, so the low 32 bits are the wrapped int result
+        result = int(int32_t(uint32_t(uint64_t(value))));
+    }
+    return true;
 }
 
 // for Exp RELOP, MUL, DIV, ADD, SUB, OR, AND Exp
-Exp::Exp(Exp *e1, TypeNode *op, Exp *e2, const string &taggedTypeFromParser) {
+Exp::Exp(CheckerContext *ctx, Exp *e1, TypeNode *op, Exp *e2, BinOpTag taggedTypeFromParser) {
     // Need to check the type of the expressions on each side, to make sure that a logical operator (AND/OR) is used on a boolean type
-    if ((e1->type == "INT" || e1->type == "BYTE") && (e2->type == "INT" || e2->type == "BYTE")) {
-        if (taggedTypeFromParser == "EQ_NEQ_RELOP" || taggedTypeFromParser == "REL_RELOP") {
+    if ((e1->type == TYPE_INT || e1->type == TYPE_BYTE) && (e2->type == TYPE_INT || e2->type == TYPE_BYTE)) {
+        if (taggedTypeFromParser == EQ_NEQ_RELOP_TAG || taggedTypeFromParser == REL_RELOP_TAG) {
             // This is a boolean operation performed between 2 numbers (>=,<=,>,<,!=,==)
-            type = "BOOL";
-        } else if (taggedTypeFromParser == "ADD_SUB_BINOP" || taggedTypeFromParser == "MUL_DIV_BINOP") {
+            type = TYPE_BOOL;
+        } else if (taggedTypeFromParser == ADD_SUB_TAG || taggedTypeFromParser == MUL_DIV_TAG) {
             // This is an arithmetic operation between two numbers
-            if (e1->type == "INT" || e2->type == "INT") {
+            if (e1->type == TYPE_INT || e2->type == TYPE_INT) {
                 // An automatic cast to int will be performed in case one of the operands is of integer type
-                type = "INT";
+                type = TYPE_INT;
             } else {
-                type = "BYTE";
+                type = TYPE_BYTE;
             }
         }
-    } else if (e1->type == "BOOL" && e2->type == "BOOL") {
+        if (type != TYPE_NONE && e1->isConstant && e2->isConstant) {
+            bool overflow = false;
+            isConstant = foldNumbers(op->value, e1->constantValue, e2->constantValue, type, constantValue, overflow);
+            // Wrapping is what the program does too, so it is only counted for --stats
+            COUNT_STAT(ctx, byteOverflows, overflow ? 1 : 0);
+        }
+    } else if (e1->type == TYPE_BOOL && e2->type == TYPE_BOOL) {
         // Both operands are boolean so this should be a boolean operation
-        type = "BOOL";
-        if (taggedTypeFromParser == "AND" || taggedTypeFromParser == "OR") {
-            if (op->value == "AND") {
-                if (e1->valueAsBooleanValue && e2->valueAsBooleanValue) {
-                    valueAsBooleanValue = true;
-                } else {
-                    valueAsBooleanValue = false;
-                }
-            } else if (op->value == "OR") {
-                if (e1->valueAsBooleanValue || e2->valueAsBooleanValue) {
-                    valueAsBooleanValue = true;
-                } else {
-                    valueAsBooleanValue = false;
-                }
+        type = TYPE_BOOL;
+        if (taggedTypeFromParser == AND_TAG || taggedTypeFromParser == OR_TAG) {
+            bool isAnd = taggedTypeFromParser == AND_TAG;
+            if (e1->isConstant && bool(e1->constantValue) != isAnd) {
+                // false and X, true or X, X is never evaluated so its value does not matter
+                isConstant = true;
+                constantValue = !isAnd;
+            } else if (e1->isConstant && e2->isConstant) {
+                isConstant = true;
+                constantValue = e2->constantValue;
             }
         } else {
-            output::errorMismatch(yylineno);
-            exit(0);
+            output::errorMismatch(ctx->sink, ctx->lineno());
+            throw CheckError();
         }
     } else {
-        output::errorMismatch(yylineno);
-        exit(0);
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
+    }
+    if (ctx->ast) {
+        if (taggedTypeFromParser == AND_TAG || taggedTypeFromParser == OR_TAG) {
+            node = addNode(ctx, taggedTypeFromParser == AND_TAG ? AST_AND : AST_OR, type);
+        } else {
+            node = addNode(ctx, AST_BINARY, type);
+            ctx->ast->op[node] = astOp(op->value);
+        }
+        appendNode(ctx, node, e1->node);
+        appendNode(ctx, node, e2->node);
+        recordConstant(ctx, this);
     }
 }
 
-Exp::Exp(Exp *e1, string tag) {
-    if (tag == "switch" && (e1->type != "INT" && e1->type != "BYTE")) {
-        output::errorMismatch(yylineno);
-        exit(0);
+Exp::Exp(CheckerContext *ctx, Exp *e1, string tag) {
+    if (tag == "switch" && (e1->type != TYPE_INT && e1->type != TYPE_BYTE)) {
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
 }
 
-ExpList::ExpList(Exp *exp) {
-    list.insert(list.begin(), exp);
+ExpList::ExpList(CheckerContext *ctx, Exp *exp) : types(ctx->signatures.extendParams(NO_PARAMS, exp->type)) {
+    list.push_back(exp);
 }
 
-ExpList::ExpList(Exp *exp, ExpList *expList) {
-    list = vector<Exp>(expList->list);
-    list.insert(list.begin(), exp);
+ExpList::ExpList(CheckerContext *ctx, ExpList *expList, Exp *exp)
+        : list(std::move(expList->list)), types(ctx->signatures.extendParams(expList->types, exp->type)) {
+    list.push_back(exp);
 }
 
-Statement::Statement(TypeNode *type) {
+Statement::Statement(CheckerContext *ctx, TypeNode *type) {
     if (DEBUG) {
         printMessage("In BREAK/CONTINUE");
         printMessage(type->value);
-        printMessage(to_string(yylineno));
+        printMessage(to_string(ctx->lineno()));
     }
-//    int l = loopCounter;
-//    int s = switchCounter;
-    if (loopCounter == 0 && switchCounter == 0) {
+//    int l = ctx->loopCounter;
+//    int s = ctx->switchCounter;
+    if (ctx->loopCounter == 0 && ctx->switchCounter == 0) {
         // We are not inside any loop, so a break or continue is illegal in this context
         if (type->value == "break") {
-            output::errorUnexpectedBreak(yylineno);
-            exit(0);
+            output::errorUnexpectedBreak(ctx->sink, ctx->lineno());
+            throw CheckError();
         } else if (type->value == "continue") {
-            output::errorUnexpectedContinue(yylineno);
-            exit(0);
+            output::errorUnexpectedContinue(ctx->sink, ctx->lineno());
+            throw CheckError();
         } else {
             if (DEBUG) {
                 printMessage("not break or continue");
             }
         }
-    } else if (loopCounter != 0) {
+    } else if (ctx->loopCounter != 0) {
         // We are inside a loop so break and continue are both legal
-    } else if (type->value == "continue" && switchCounter != 0) {
-        output::errorUnexpectedContinue(yylineno);
-        exit(0);
+    } else if (type->value == "continue" && ctx->switchCounter != 0) {
+        output::errorUnexpectedContinue(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
     dataTag = "break or continue";
+    node = addNode(ctx, type->value == "break" ? AST_BREAK : AST_CONTINUE, TYPE_NONE);
 }
 
-Statement::Statement(string type, Exp *exp) {
+Statement::Statement(CheckerContext *ctx, string type, Exp *exp) {
     if (DEBUG) {
         printMessage("exp type ex");
         printMessage(type);
-        printMessage(exp->type);
+        printMessage(typeName(exp->type));
         printMessage(exp->value);
     }
-    if (exp->type != "BOOL") {
-        output::errorMismatch(yylineno);
-        exit(0);
+    if (exp->type != TYPE_BOOL) {
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
     dataTag = "if if else while";
+    node = addNode(ctx, type == "while" ? AST_WHILE : AST_IF, TYPE_NONE);
+    appendNode(ctx, node, exp->node);
 }
 
 // For Return SC -> this is for a function with a void return type
-Statement::Statement(const string &funcReturnType) {
+Statement::Statement(CheckerContext *ctx, TypeId funcReturnType) {
     if (DEBUG) printMessage("statement func ret type");
     // Need to check if the current running function is of void type
-    for (int i = symTabStack.size() - 1; i >= 0; i--) {
-        // Need to search in the current symtab with no particular order for the current function
-        for (auto &row : symTabStack[i]->rows) {
-            if (row->isFunc && row->name == currentRunningFunctionScopeId) {
-                // We found the current running function
-                if (row->type.back() == funcReturnType) {
-                    dataTag = "void return value";
-                } else {
-                    output::errorMismatch(yylineno);
-                    exit(0);
-                }
-            }
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, ctx->currentRunningFunctionScopeId);
+    if (row && row->isFunc) {
+        // We found the current running function
+        if (row->valueType(ctx->signatures) == funcReturnType) {
+            dataTag = "void return value";
+        } else {
+            output::errorMismatch(ctx->sink, ctx->lineno());
+            throw CheckError();
         }
     }
+    node = addNode(ctx, AST_RETURN, TYPE_NONE);
 }
 
-Statement::Statement(Exp *exp) {
+Statement::Statement(CheckerContext *ctx, Exp *exp) {
     if (DEBUG) {
         printMessage("statement exp!!!!!!");
-        printMessage(exp->type);
+        printMessage(typeName(exp->type));
         printMessage(exp->value);
         printMessage("current func:");
-        printMessage(currentRunningFunctionScopeId);
-        //printSymTableStack();
+        printMessage(ctx->names.get(ctx->currentRunningFunctionScopeId));
+        //printSymTableStack(ctx);
     }
     // Need to check if the current running function is of the specified type
-    if (exp->type == "VOID") {
+    if (exp->type == TYPE_VOID) {
         // Attempt to return a void expression from a value returning function
-        output::errorMismatch(yylineno);
-        exit(0);
-    }
-
-    for (int i = symTabStack.size() - 1; i >= 0; i--) {
-        // Need to search in the current symtab with no particular order for the current function
-        for (auto &row : symTabStack[i]->rows) {
-            if (row->isFunc && row->name == currentRunningFunctionScopeId) {
-                // We found the current running function
-                if (row->type.back() == exp->type) {
-                    dataTag = exp->value;
-                } else if (row->type.back() == "INT" && exp->type == "BYTE") {
-                    // Allowing automatic cast from byte to int
-                    dataTag = row->type.back();
-                } else {
-                    output::errorMismatch(yylineno);
-                    exit(0);
-                }
-            }
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
+    }
+
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, ctx->currentRunningFunctionScopeId);
+    if (row && row->isFunc) {
+        // We found the current running function
+        if (row->valueType(ctx->signatures) == exp->type) {
+            dataTag = exp->value;
+        } else if (row->valueType(ctx->signatures) == TYPE_INT && exp->type == TYPE_BYTE) {
+            // Allowing automatic cast from byte to int
+            dataTag = typeName(row->valueType(ctx->signatures));
+        } else {
+            output::errorMismatch(ctx->sink, ctx->lineno());
+            throw CheckError();
         }
     }
+    node = addNode(ctx, AST_RETURN, TYPE_NONE);
+    appendNode(ctx, node, exp->node);
 }
 
 Statement::Statement(Call *call) {
     dataTag = "function call";
+    node = call->node;
 }
 
-Statement::Statement(TypeNode *id, Exp *exp) {
-    if (!isDeclared(id->value)) {
-        output::errorUndef(yylineno, id->value);
-        exit(0);
+Statement::Statement(CheckerContext *ctx, TypeNode *id, Exp *exp) {
+    if (!isDeclared(ctx, id->name)) {
+        output::errorUndef(ctx->sink, ctx->lineno(), id->value);
+        throw CheckError();
     }
 
     // Searching for the variable in the symtab
-    for (int i = symTabStack.size() - 1; i >= 0; i--) {
-        // Need to search in the current symtab with no particular order for the current function
-        for (auto &row : symTabStack[i]->rows) {
-            if (!row->isFunc && row->name == id->value) {
-                // We found the desired variable
-                if ((row->type.back() == exp->type) || (row->type.back() == "INT" && exp->type == "BYTE")) {
-                    dataTag = row->type.back();
-                }
-            }
+    shared_ptr<SymbolTableRow> row = findSymbol(ctx, id->name);
+    if (!row->isFunc) {
+        // We found the desired variable
+        if ((row->valueType(ctx->signatures) == exp->type) || (row->valueType(ctx->signatures) == TYPE_INT && exp->type == TYPE_BYTE)) {
+            dataTag = typeName(row->valueType(ctx->signatures));
         }
     }
+    node = addNode(ctx, AST_ASSIGN, row->valueType(ctx->signatures));
+    if (node != NO_NODE) {
+        ctx->ast->name[node] = id->name;
+        ctx->ast->ref[node] = row->node;
+        appendNode(ctx, node, exp->node);
+    }
 }
 
-Statement::Statement(Type *t, TypeNode *id, Exp *exp) {
+void Statement::recordDecl(CheckerContext *ctx, const shared_ptr<SymbolTableRow> &row) {
+    node = addNode(ctx, AST_DECL, TypeId(row->type));
+    if (node != NO_NODE) {
+        ctx->ast->name[node] = row->name;
+        ctx->ast->value[node] = row->offset;
+        row->node = node;
+    }
+}
+
+Statement::Statement(CheckerContext *ctx, Type *t, TypeNode *id, Exp *exp) {
     if (DEBUG) printMessage("statement t id exp");
-    if (isDeclared(id->value)) {
+    if (isDeclared(ctx, id->name)) {
         // Trying to redeclare a name that is already used for a different variable/fucntion
-        output::errorDef(yylineno, id->value);
-        exit(0);
+        output::errorDef(ctx->sink, ctx->lineno(), id->value);
+        throw CheckError();
     }
-    if ((t->value == exp->type) || (t->value == "INT" && exp->type == "BYTE")) {
+    if ((t->type == exp->type) || (t->type == TYPE_INT && exp->type == TYPE_BYTE)) {
         dataTag = t->value;
         // Creating a new variable on the stack will cause the next one to have a higher offset
-        int offset = offsetStack.back()++;
-        vector<string> varType = {t->value};
-        shared_ptr<SymbolTableRow> nVar = std::make_shared<SymbolTableRow>(id->value, varType, offset, false);
-        symTabStack.back()->rows.push_back(nVar);
+        int offset = ctx->offsetStack.back()++;
+        shared_ptr<SymbolTableRow> nVar = std::make_shared<SymbolTableRow>(id->name, t->type, offset, false);
+        nVar->line = ctx->lineno();
+        insertSymbol(ctx, nVar);
+        recordDecl(ctx, nVar);
+        appendNode(ctx, node, exp->node);
     } else {
-        output::errorMismatch(yylineno);
-        exit(0);
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
 }
 
-Statement::Statement(Type *t, TypeNode *id) {
-    if (isDeclared(id->value)) {
+Statement::Statement(CheckerContext *ctx, Type *t, TypeNode *id) {
+    if (isDeclared(ctx, id->name)) {
         // Trying to redeclare a name that is already used for a different variable/fucntion
-        output::errorDef(yylineno, id->value);
-        exit(0);
+        output::errorDef(ctx->sink, ctx->lineno(), id->value);
+        throw CheckError();
     }
     // Creating a new variable on the stack will cause the next one to have a higher offset
-    int offset = offsetStack.back()++;
-    vector<string> varType = {t->value};
-    shared_ptr<SymbolTableRow> nVar = std::make_shared<SymbolTableRow>(id->value, varType, offset, false);
-    symTabStack.back()->rows.push_back(nVar);
+    int offset = ctx->offsetStack.back()++;
+    shared_ptr<SymbolTableRow> nVar = std::make_shared<SymbolTableRow>(id->name, t->type, offset, false);
+    nVar->line = ctx->lineno();
+    insertSymbol(ctx, nVar);
+    recordDecl(ctx, nVar);
     dataTag = t->value;
-    if (DEBUG) printSymTableStack();
+    if (DEBUG) printSymTableStack(ctx);
 }
 
-Statement::Statement(Statements *states) {
+Statement::Statement(CheckerContext *ctx, Statements *states) {
     if (DEBUG) {
         printMessage("In statement from statements");
         printMessage(states->value);
     }
     dataTag = "statement block";
+    node = addNode(ctx, AST_BLOCK, TYPE_NONE);
+    appendNodes(ctx, node, states->statements);
 }
 
-Statement::Statement(Exp *exp, CaseList *cList) {
+Statement::Statement(CheckerContext *ctx, Exp *exp, CaseList *cList) {
     // Need to check that exp is a number (int,byte) and that all case decl in caselist are int or byte
     if (DEBUG) {
         if (!exp) {
@@ -661,55 +1001,80 @@ Statement::Statement(Exp *exp, CaseList *cList) {
         }
         printMessage("statement exp caselist");
         printMessage(exp->value);
-        printMessage(exp->type);
+        printMessage(typeName(exp->type));
     }
-    if (exp->type != "INT" && exp->type != "BYTE") {
+    if (exp->type != TYPE_INT && exp->type != TYPE_BYTE) {
         if (DEBUG) printMessage("Mismatch in exp type");
-        output::errorMismatch(yylineno);
-        exit(0);
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
 
     for (auto &i : cList->cases) {
-        if (i->value != "INT" && i->value != "BYTE") {
+        if (i->type != TYPE_INT && i->type != TYPE_BYTE) {
             if (DEBUG) {
                 printMessage("Mismatch in case type");
-                printMessage(i->value);
+                printMessage(typeName(i->type));
             }
-            output::errorMismatch(yylineno);
-            exit(0);
+            output::errorMismatch(ctx->sink, ctx->lineno());
+            throw CheckError();
         }
     }
 
     dataTag = "switch block";
+    if (ctx->ast) {
+        node = addNode(ctx, AST_SWITCH, TYPE_NONE);
+        appendNode(ctx, node, exp->node);
+        for (auto &i : cList->cases) {
+            appendNode(ctx, node, i->node);
+        }
+        if (cList->defaultCase) {
+            AstId defaultNode = addNode(ctx, AST_DEFAULT, TYPE_NONE);
+            appendNodes(ctx, defaultNode, cList->defaultCase->statements);
+            appendNode(ctx, node, defaultNode);
+        }
+    }
 }
 
-Statements::Statements(Statement *state) {
-
+void attachBody(CheckerContext *ctx, TypeNode *statement, TypeNode *body) {
+    appendNode(ctx, statement->node, body->node);
 }
 
-Statements::Statements(Statements *states, Statement *state) {
+Statements::Statements(Statement *state) {
+    if (state->node != NO_NODE) {
+        statements.push_back(state->node);
+    }
+}
 
+Statements::Statements(Statements *states, Statement *state) : statements(std::move(states->statements)) {
+    if (state->node != NO_NODE) {
+        statements.push_back(state->node);
+    }
 }
 
-CaseDecl::CaseDecl(Exp *num, Statements *states) {
+CaseDecl::CaseDecl(CheckerContext *ctx, Exp *num, Statements *states) {
     if (DEBUG) {
         printMessage("value of statements is:");
         printMessage(states->value);
         printMessage("value of exp:");
         printMessage(num->value);
         printMessage("type of exp:");
-        printMessage(num->type);
+        printMessage(typeName(num->type));
     }
-    if (num->type != "INT" && num->type != "BYTE") {
+    if (num->type != TYPE_INT && num->type != TYPE_BYTE) {
         //if (num->value != "INT" && num->value != "BYTE") {
-        output::errorMismatch(yylineno);
-        exit(0);
+        output::errorMismatch(ctx->sink, ctx->lineno());
+        throw CheckError();
+    }
+    type = num->type;
+    value = typeName(type);
+    node = addNode(ctx, AST_CASE, type);
+    if (node != NO_NODE) {
+        ctx->ast->value[node] = num->constantValue;
+        appendNodes(ctx, node, states->statements);
     }
-    value = num->type;
 }
 
-CaseList::CaseList(CaseDecl *cDec, CaseList *cList) {
-    cases = vector<CaseDecl *>(cList->cases);
+CaseList::CaseList(CaseList *cList, CaseDecl *cDec) : cases(std::move(cList->cases)) {
     cases.push_back(cDec);
     value = "case list";
 }
@@ -719,22 +1084,25 @@ CaseList::CaseList(CaseDecl *cDec) {
     value = "case list";
 }
 
-CaseList::CaseList(Statements *states) {
+CaseList::CaseList(CaseList *cList, Statements *states) : cases(std::move(cList->cases)), defaultCase(states) {
+    value = "case list";
+}
+
+CaseList::CaseList(Statements *states) : defaultCase(states) {
 
 }
 
-void insertFunctionParameters(Formals *formals) {
-    for (unsigned int i = 0; i < formals->formals.size(); ++i) {
-        vector<string> nType = {formals->formals[i]->type};
-        shared_ptr<SymbolTableRow> nParameter = make_shared<SymbolTableRow>(formals->formals[i]->value, nType, -i - 1, false);
-        symTabStack.back()->rows.push_back(nParameter);
+void insertFunctionParameters(CheckerContext *ctx, FuncDecl *func) {
+    // The rows were already built and validated by FuncDecl
+    for (auto &nParameter : func->parameters) {
+        insertSymbol(ctx, nParameter);
     }
 }
 
-Funcs::Funcs() {
+Funcs::Funcs(CheckerContext *ctx) {
     if (DEBUG) printMessage("I am in funcs");
-    if (strcmp(yytext, "") != 0) {
-        output::errorSyn(yylineno);
-        exit(0);
+    if (strcmp(ctx->text(), "") != 0) {
+        output::errorSyn(ctx->sink, ctx->lineno());
+        throw CheckError();
     }
 }
@@ -5,65 +5,318 @@
 #ifndef HW3_SEMANTICS_H
 #define HW3_SEMANTICS_H
 
+#include <climits>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include "vector"
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <ostream>
+#include <exception>
 #include "hw3_output.hpp"
+#include "AllocProfile.h"
+#include "Arena.h"
+#include "Stats.h"
 
-extern int yylineno;
-extern char * yytext;
 using namespace std;
 
-void enterSwitch();
+class CheckerContext;
 
-void exitSwitch();
+// Index of an interned identifier in the NameTable
+typedef int NameId;
 
-void enterLoop();
+// Not an identifier
+const NameId NO_NAME = -1;
 
-void exitLoop();
+// Index of a node in the syntax tree of the program, see Ast.h
+typedef int AstId;
 
-void exitProgramFuncs();
+// Not a node, or no tree is being built
+const AstId NO_NODE = -1;
 
-void exitProgramRuntime();
+class Ast;
 
-void openNewScope();
+class SymbolRecordWriter;
 
-void closeCurrentScope();
+class Prelude;
 
-void printMessage(string message);
+class TypeNode;
 
-bool isDeclared(const string &name);
-bool isDeclaredVariable(const string &name);
+class FuncDecl;
+
+class Statements;
+
+void enterSwitch(CheckerContext *ctx);
+
+void exitSwitch(CheckerContext *ctx);
+
+void enterLoop(CheckerContext *ctx);
+
+void exitLoop(CheckerContext *ctx);
+
+// Closes the function whose body was just parsed, the body becomes part of the syntax tree of the function
+void exitProgramFuncs(CheckerContext *ctx, FuncDecl *func, Statements *body);
+
+void exitProgramRuntime(CheckerContext *ctx);
+
+// Opens the global scope with the print and printi functions
+void openGlobalScope(CheckerContext *ctx);
+
+void openNewScope(CheckerContext *ctx);
+
+void closeCurrentScope(CheckerContext *ctx);
+
+void printMessage(string_view message);
+
+bool isDeclared(CheckerContext *ctx, NameId name);
+bool isDeclaredVariable(CheckerContext *ctx, NameId name);
+
+// Compact type tags, the value of each tag is the index of its name in varTypes
+// TYPE_NONE is the type of an expression the checker could not type (e.g. int AND int)
+enum TypeId : unsigned char {
+    TYPE_VOID,
+    TYPE_INT,
+    TYPE_BYTE,
+    TYPE_BOOL,
+    TYPE_STRING,
+    TYPE_NONE
+};
+
+// Returns the printed name of a type ("INT", "BYTE", ...)
+const string &typeName(TypeId type);
+
+// Returns the type tag of a printed type name, TYPE_NONE for anything else
+TypeId typeFromName(string_view name);
+
+// Index of an interned function signature in the SignatureTable
+typedef int SigId;
+
+// Index of an interned list of parameter types in the SignatureTable, two lists are equal iff their ids are equal
+typedef int ParamsId;
+
+// The list with no parameters, every other list extends a shorter one by one type
+const ParamsId NO_PARAMS = 0;
+
+class Signature : public ProfiledObject<Signature> {
+public:
+    vector<TypeId> params;
+    TypeId ret;
+    // The interned params, set by SignatureTable::intern
+    ParamsId paramsId = NO_PARAMS;
+
+    Signature(vector<TypeId> params, TypeId ret);
+};
+
+// Every distinct (params)->ret tuple is stored exactly once, so two signatures are equal iff their ids are equal
+class SignatureTable {
+public:
+    vector<Signature> signatures;
+    unordered_map<string, SigId> ids;
+    // The parameter lists, keyed by the list they extend and the type they add
+    unordered_map<uint64_t, ParamsId> paramLists;
+
+    SignatureTable() = default;
+
+    SigId intern(const vector<TypeId> &params, TypeId ret);
+
+    // The list prefix followed by next, so the arguments of a call are interned one at a time as they are reduced
+    ParamsId extendParams(ParamsId prefix, TypeId next);
+
+    // Same as intern, but never adds a new signature, returns -1 if the signature was never interned
+    SigId find(const vector<TypeId> &params, TypeId ret) const;
+
+    const Signature &get(SigId id) const;
+
+    // The printed parameter types of a signature, for output::makeFunctionType and output::errorPrototypeMismatch
+    vector<string> paramNames(SigId id) const;
+};
+
+// Every distinct identifier of a program is stored exactly once, so two names are equal iff their ids are equal
+// The scanner interns each ID token, everything after it compares and indexes names by id
+class NameTable {
+public:
+    // A deque never moves its strings, so the views into them stay valid as names are added
+    deque<string> names;
+    unordered_map<string_view, NameId> ids;
+
+    NameTable() = default;
+
+    NameTable(const NameTable &) = delete;
+
+    NameTable &operator=(const NameTable &) = delete;
+
+    // Moving a deque keeps its strings where they are, so the views of ids stay valid
+    NameTable(NameTable &&) = default;
+
+    NameTable &operator=(NameTable &&) = default;
+
+    NameId intern(string_view name);
+
+    // Same as intern, but never adds a new name, returns NO_NAME if the name was never interned
+    NameId find(string_view name) const;
+
+    // The text of a name, it views the copy kept by the table
+    string_view get(NameId id) const;
+};
 
 // Single row in the table of a scope
-class SymbolTableRow {
+class SymbolTableRow : public ProfiledObject<SymbolTableRow> {
 public:
-    string name;
+    // The interned name, its text is in the NameTable of the check
+    NameId name;
     // This is for variables and function definitions
-    // For a variable, the type at cell 0 is the actual type, other cells should be empty
-    // For a function, all types except the last one, are parameter types, the last type is the return type of the function
-    vector<string> type;
+    // For a variable, this is the TypeId of the variable
+    // For a function, this is the SigId of the function signature in the SignatureTable of the check
+    int type;
     int offset;
     bool isFunc;
+    // The declaration in the syntax tree, NO_NODE if no tree is built or for print and printi
+    AstId node = NO_NODE;
+    // The line of the declaration, 0 for print and printi
+    int line = 0;
 
-    SymbolTableRow(string name, vector<string> type, int offset, bool isFunc);
+    SymbolTableRow(NameId name, int type, int offset, bool isFunc);
+
+    // The type of a variable, or the return type of a function
+    TypeId valueType(const SignatureTable &signatures) const;
 };
 
 // The object storing the entries of the current scope
-class SymbolTable {
+class SymbolTable : public ProfiledObject<SymbolTable> {
 public:
     vector<shared_ptr<SymbolTableRow>> rows;
 
     SymbolTable() = default;
 };
 
+// Index over every open scope, maps a name to the rows currently bound to it
+// The innermost binding is always the last element, so lookups never walk symTabStack
+// Names are interned, so the index is a plain vector indexed by NameId and a lookup never hashes the name
+class SymbolIndex {
+public:
+    vector<vector<shared_ptr<SymbolTableRow>>> bindings;
+
+    SymbolIndex() = default;
+
+    void bind(const shared_ptr<SymbolTableRow> &row);
+
+    // Drops the innermost binding of every row of a scope that is being closed
+    void unbind(const SymbolTable &scope);
+
+    shared_ptr<SymbolTableRow> lookup(NameId name) const;
+};
+
+// The entries the parser stacks may grow to by default, a few bytes each, only nesting uses them (see parser.ypp)
+const size_t DEFAULT_MAX_PARSER_DEPTH = 100000;
+
+// Told about every scope the check closes, before its rows are dropped, for tools that keep the symbols (see Lsp.h)
+class ScopeObserver {
+public:
+    virtual ~ScopeObserver() = default;
+
+    // depth is 0 for the global scope, the current line of the check is the end of the scope
+    virtual void scopeClosed(const CheckerContext &ctx, const SymbolTable &scope, size_t depth) = 0;
+};
+
+// Everything a single check of a program reads and writes, nothing is shared between two checks
+// so several programs can be checked at the same time, each with its own context
+class CheckerContext {
+public:
+    // Scope dumps and the diagnostic go here, not owned
+    output::Sink &sink;
+    vector<shared_ptr<SymbolTable>> symTabStack;
+    SymbolIndex symIndex;
+    vector<int> offsetStack;
+    SignatureTable signatures;
+    NameTable names;
+    // Every semantic value of the parser is allocated here, the arena is reset when each function is closed
+    NodeArena nodes;
+    int loopCounter = 0;
+    int switchCounter = 0;
+    // The function whose body is being checked, NO_NAME between functions
+    NameId currentRunningFunctionScopeId = NO_NAME;
+    // The reentrant flex scanner reading the program, owned by parseProgram
+    void *scanner = nullptr;
+    // The parser stacks once they outgrow the arrays bison starts with, see yyoverflow in parser.ypp
+    vector<char> parserStates;
+    vector<TypeNode *> parserValues;
+    // Deeper programs are rejected with output::errorTooDeep instead of growing the stacks further
+    size_t maxParserDepth = DEFAULT_MAX_PARSER_DEPTH;
+    // The text being parsed is a single function of a larger program (see Incremental.h)
+    // The global scope is opened before the parse and closed by the caller, not by the program rule
+    bool singleFunction = false;
+    // Only counted when built with HW3_STATS, see Stats.h
+    CheckStats stats;
+    // The syntax tree of the program is recorded here when set, not owned
+    Ast *ast = nullptr;
+    // The closed scopes are written as symbol records instead of scope dumps when set, not owned (see SymbolRecords.h)
+    SymbolRecordWriter *symbolRecords = nullptr;
+    // Functions declared before the program, looked up when a name is not in any scope, not owned (see Prelude.h)
+    const Prelude *prelude = nullptr;
+    // Told about each closed scope when set, on top of the dumps or the records, not owned
+    ScopeObserver *scopeObserver = nullptr;
+
+    explicit CheckerContext(output::Sink &sink);
+
+    CheckerContext(const CheckerContext &) = delete;
+
+    CheckerContext &operator=(const CheckerContext &) = delete;
+
+    // The line and the text of the current token, defined in scanner.lex
+    int lineno() const;
+
+    const char *text() const;
+
+    // Interns an identifier of the program and makes its token, called by the scanner
+    TypeNode *identifier(string_view text);
+};
+
+// Thrown once a diagnostic was written to the sink, nothing else of the program is checked after it
+class CheckError : public exception {
+public:
+    const char *what() const noexcept override;
+};
+
+// The largest program the scanner takes, flex keeps the size of its buffer in an int
+const size_t MAX_PROGRAM_SIZE = INT_MAX - 2;
+
+// Scans and parses a whole program with the given context, defined in scanner.lex
+// Throws CheckError on the first error, or with output::errorTooLarge for a program above MAX_PROGRAM_SIZE
+void parseProgram(CheckerContext *ctx, const char *data, size_t size);
+
+// Same as parseProgram, but scans data where it is instead of copying it, data[size] and data[size + 1] must be 0
+void parseProgramInPlace(CheckerContext *ctx, char *data, size_t size);
+
+// Scans a whole program without parsing it and appends the kind of each token to kinds, defined in scanner.lex
+// Returns false on a lexical error, or without scanning for a program above MAX_PROGRAM_SIZE
+bool scanTokens(const char *data, size_t size, vector<int> &kinds);
+
+// Runs the parse tables over a sequence of token kinds without the semantic actions, defined in parser.ypp
+// Returns the number of reductions up to the end of the tokens or to the first syntax error
+size_t countReductions(const vector<int> &kinds);
+
+// Adds a row to the current (innermost) scope and to the index
+void insertSymbol(CheckerContext *ctx, const shared_ptr<SymbolTableRow> &row);
+
+// Returns the innermost row bound to name, or nullptr if it is not declared in any open scope
+shared_ptr<SymbolTableRow> findSymbol(CheckerContext *ctx, NameId name);
+
 class TypeNode {
 public:
-    string value;
+    // Views the program text for tokens, or a static string (type names, tags)
+    // It stays valid while the program is parsed, an identifier views its copy in the NameTable instead
+    string_view value;
+    // The interned name of an ID token, and of the nodes declaring it (FormalDecl, FuncDecl), NO_NAME otherwise
+    NameId name = NO_NAME;
+    // The node of the syntax tree built for this semantic value, NO_NODE if no tree is built or it has none
+    AstId node = NO_NODE;
 
-    explicit TypeNode(string str);
+    explicit TypeNode(string_view str);
+
+    TypeNode(string_view str, NameId name);
 
     TypeNode();
 
@@ -76,34 +329,49 @@ public:
 
 class Type : public TypeNode {
 public:
+    TypeId type;
+
     explicit Type(TypeNode *type);
 };
 
+// The kind of binary operator, tagged by bison when creating the Exp object
+enum BinOpTag {
+    ADD_SUB_TAG,
+    MUL_DIV_TAG,
+    AND_TAG,
+    OR_TAG,
+    EQ_NEQ_RELOP_TAG,
+    REL_RELOP_TAG
+};
+
 class Call;
 
 class Exp : public TypeNode {
 public:
     // Type is used for tagging in bison when creating the Exp object
-    string type;
-    bool valueAsBooleanValue;
+    TypeId type = TYPE_NONE;
+    // Set when the value is known at check time: literals, and operators whose value only depends on constants
+    bool isConstant = false;
+    // The value of a constant expression, an int, a byte (0 to 255) or a bool (0 or 1)
+    int constantValue = 0;
 
     // This is for NUM, NUM B, STRING, TRUE and FALSE
-    Exp(TypeNode *terminal, string taggedTypeFromParser);
+    Exp(CheckerContext *ctx, TypeNode *terminal, TypeId taggedTypeFromParser);
 
     // for Call
     explicit Exp(Call *call);
 
     // for exp in switch
-    Exp(Exp *e1, string tag);
+    Exp(CheckerContext *ctx, Exp *e1, string tag);
 
     // for NOT Exp
-    Exp(TypeNode *notNode, Exp *exp);
+    Exp(CheckerContext *ctx, TypeNode *notNode, Exp *exp);
 
     // for Exp RELOP, MUL, DIV, ADD, SUB, OR, AND Exp
-    Exp(Exp *e1, TypeNode *op, Exp *e2, const string &taggedTypeFromParser);
+    Exp(CheckerContext *ctx, Exp *e1, TypeNode *op, Exp *e2, BinOpTag taggedTypeFromParser);
 
     // for Exp ID
-    explicit Exp(TypeNode *id);
+    Exp(CheckerContext *ctx, TypeNode *id);
 
     // for Lparen Exp Rparen, need to just remove the parentheses
     Exp(Exp *ex);
@@ -111,22 +379,34 @@ public:
 
 class ExpList : public TypeNode {
 public:
-    vector<Exp> list;
+    vector<Exp *> list;
+    // The types of the list, a call whose arguments match its parameters exactly compares this id only
+    ParamsId types;
 
-    explicit ExpList(Exp *exp);
+    ExpList(CheckerContext *ctx, Exp *exp);
 
-    ExpList(Exp *exp, ExpList *expList);
+    // Appends exp to the list built so far, the list is moved, not copied
+    ExpList(CheckerContext *ctx, ExpList *expList, Exp *exp);
 };
 
 class Call : public TypeNode {
 public:
-    Call(TypeNode *id, ExpList *list);
+    // The return type of the called function
+    TypeId type = TYPE_NONE;
+
+    Call(CheckerContext *ctx, TypeNode *id, ExpList *list);
 
-    explicit Call(TypeNode *id);
+    Call(CheckerContext *ctx, TypeNode *id);
+
+private:
+    // The syntax tree node of a call that passed the checks
+    void recordCall(CheckerContext *ctx, TypeNode *id, const shared_ptr<SymbolTableRow> &row, ExpList *args = nullptr);
 };
 
 class RetType : public TypeNode {
 public:
+    TypeId type;
+
     explicit RetType(TypeNode *type);
 };
 
@@ -137,65 +417,83 @@ class CaseList;
 
 class Statement : public TypeNode {
 public:
-    string dataTag;
+    string_view dataTag;
 
     // For Lbrace Statements Rbrace
-    explicit Statement(Statements *states);
+    Statement(CheckerContext *ctx, Statements *states);
 
     // For Type ID SC
-    Statement(Type *t, TypeNode *id);
+    Statement(CheckerContext *ctx, Type *t, TypeNode *id);
 
     // For Type ID Assign Exp SC
-    Statement(Type *t, TypeNode *id, Exp *exp);
+    Statement(CheckerContext *ctx, Type *t, TypeNode *id, Exp *exp);
 
     // For ID Assign Exp SC
-    Statement(TypeNode *id, Exp *exp);
+    Statement(CheckerContext *ctx, TypeNode *id, Exp *exp);
 
     // For Call SC
     explicit Statement(Call *call);
 
     // For Return SC -> this is for a function with a void return type
-    explicit Statement(const string& funcReturnType);
+    Statement(CheckerContext *ctx, TypeId funcReturnType);
 
     // For Return Exp SC -> This is for a non-void function, exp stores the type so it is enough
-    explicit Statement(Exp *exp);
+    Statement(CheckerContext *ctx, Exp *exp);
 
     // For if,if/else,while
-    Statement(string type, Exp *exp);
+    Statement(CheckerContext *ctx, string type, Exp *exp);
 
     // For break,continue
-    explicit Statement(TypeNode *type);
+    Statement(CheckerContext *ctx, TypeNode *type);
 
     // For Switch LParen Exp RParen Lbrace CaseList Rbrace
-    Statement(Exp *exp, CaseList *cList);
+    Statement(CheckerContext *ctx, Exp *exp, CaseList *cList);
+
+private:
+    // The syntax tree node of a declared variable, also linked from its row for the names that refer to it
+    void recordDecl(CheckerContext *ctx, const shared_ptr<SymbolTableRow> &row);
 };
 
 class Statements : public TypeNode {
 public:
+    // The syntax tree nodes of the statements, in order
+    vector<AstId> statements;
+
     // For Statement
     explicit Statements(Statement *state);
 
-    // For Statements Statement
+    // For Statements Statement, the statements built so far are moved, not copied
     Statements(Statements *states, Statement *state);
 };
 
+// Adds the statement of an if, an else or a while to the syntax tree node of the if or the while
+void attachBody(CheckerContext *ctx, TypeNode *statement, TypeNode *body);
+
 class CaseDecl : public TypeNode {
 public:
+    // The type of the case label
+    TypeId type;
+
     // For Case Num Colon Statements
-    CaseDecl(Exp *num, Statements *states);
+    CaseDecl(CheckerContext *ctx, Exp *num, Statements *states);
     //CaseDecl(TypeNode *num, Statements *states);
 };
 
 class CaseList : public TypeNode {
 public:
     vector<CaseDecl *> cases;
+    // The statements of the default case, nullptr if there is none
+    Statements *defaultCase = nullptr;
 
-    // For CaseDecl CaseList
-    CaseList(CaseDecl *cDec, CaseList *cList);
+    // For CaseDecls CaseDecl, the cases built so far are moved, not copied
+    CaseList(CaseList *cList, CaseDecl *cDec);
 
     // For CaseDecl
     explicit CaseList(CaseDecl *cDec);
 
+    // For CaseDecls Default Colon Statements
+    CaseList(CaseList *cList, Statements *states);
+
     // For Default Colon Statements
     explicit CaseList(Statements *states);
 };
@@ -203,7 +501,7 @@ public:
 class FormalDecl : public TypeNode {
 public:
     // The parameter type
-    string type;
+    TypeId type;
 
     // for Type ID
     FormalDecl(Type *t, TypeNode *id);
@@ -216,8 +514,8 @@ public:
     // To initialize from an empty formal list
     explicit FormalsList(FormalDecl *formal);
 
-    // To append a new formal to an existing formal list
-    FormalsList(FormalDecl *formal, FormalsList *fList);
+    // To append a new formal to an existing formal list, the list is moved, not copied
+    FormalsList(FormalsList *fList, FormalDecl *formal);
 };
 
 class Formals : public TypeNode {
@@ -233,22 +531,24 @@ public:
 
 class FuncDecl : public TypeNode {
 public:
-    // This is an array to denote the types of the func parameters, with the func return type being the last elemtn of the array
-    vector<string> type;
+    // The interned signature of the function, see SignatureTable
+    SigId type;
+    // The rows of the function parameters, in order, with their offsets already assigned
+    vector<shared_ptr<SymbolTableRow>> parameters;
 
-    FuncDecl(RetType *rType, TypeNode *id, Formals *funcParams);
+    FuncDecl(CheckerContext *ctx, RetType *rType, TypeNode *id, Formals *funcParams);
 };
 
 class Funcs : public TypeNode {
 public:
-    Funcs();
+    explicit Funcs(CheckerContext *ctx);
 };
 
 class Program : public TypeNode {
 public:
-    Program();
+    explicit Program(CheckerContext *ctx);
 };
 
-void insertFunctionParameters(Formals *formals);
+void insertFunctionParameters(CheckerContext *ctx, FuncDecl *func);
 
 #endif //HW3_SEMANTICS_H
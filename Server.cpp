@@ -0,0 +1,455 @@
+//
+// Resident checker, serving programs over a Unix domain socket
+//
+
+#include "Server.h"
+#include "Checker.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Larger requests are not programs, the connection is dropped
+static const uint32_t MAX_REQUEST_SIZE = 256u << 20;
+// A connection with no request for this long is closed
+static const auto IDLE_TIMEOUT = chrono::seconds(60);
+// A worker gives a request this long to arrive once it started, and its answer this long to be taken, a client too
+// slow for either loses its connection so it does not keep the worker
+static const auto REQUEST_TIMEOUT = chrono::seconds(10);
+// The program of a request is read in pieces of this size, its buffer only grows as the bytes arrive
+static const size_t READ_CHUNK = 64 << 10;
+
+// Connections accepted but not served yet, the acceptor never waits on it
+class ConnectionQueue {
+public:
+    explicit ConnectionQueue(size_t capacity) : capacity(capacity) {
+
+    }
+
+    // Returns false if the queue is full or closed
+    bool tryPush(int fd) {
+        lock_guard<mutex> guard(lock);
+        if (closed || connections.size() >= capacity) {
+            return false;
+        }
+        connections.push_back(fd);
+        ready.notify_one();
+        return true;
+    }
+
+    // Waits for a connection, returns false once the queue is closed and empty
+    bool pop(int &fd) {
+        unique_lock<mutex> guard(lock);
+        ready.wait(guard, [this] { return closed || !connections.empty(); });
+        if (connections.empty()) {
+            return false;
+        }
+        fd = connections.front();
+        connections.pop_front();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        ready.notify_all();
+    }
+
+private:
+    size_t capacity;
+    mutex lock;
+    condition_variable ready;
+    deque<int> connections;
+    bool closed = false;
+};
+
+// Connections between two requests, a worker gives its connection back here after each answer and the poller watches
+// them, so a client keeping its connection open holds no worker while it sends nothing
+class IdleConnections {
+public:
+    IdleConnections() {
+        if (pipe2(wake, O_CLOEXEC | O_NONBLOCK) != 0) {
+            wake[0] = wake[1] = -1;
+        }
+    }
+
+    ~IdleConnections() {
+        close(wake[0]);
+        close(wake[1]);
+    }
+
+    bool valid() const {
+        return wake[0] >= 0;
+    }
+
+    // The poller watches the connection again, or it is closed if the poller already stopped
+    void giveBack(int fd) {
+        lock_guard<mutex> guard(lock);
+        if (stopped) {
+            close(fd);
+            return;
+        }
+        returned.push_back(fd);
+        notify();
+    }
+
+    void stop() {
+        lock_guard<mutex> guard(lock);
+        stopped = true;
+        notify();
+    }
+
+    // The read end of the pipe that wakes the poller
+    int wakeFd() const {
+        return wake[0];
+    }
+
+    // Empties the pipe and takes the connections given back since the last call, returns false once stopped
+    bool take(vector<int> &fds) {
+        char drained[64];
+        while (read(wake[0], drained, sizeof(drained)) > 0) {
+        }
+        lock_guard<mutex> guard(lock);
+        fds.insert(fds.end(), returned.begin(), returned.end());
+        returned.clear();
+        return !stopped;
+    }
+
+private:
+    mutex lock;
+    vector<int> returned;
+    bool stopped = false;
+    int wake[2];
+
+    void notify() {
+        // The pipe only needs one byte to be readable, a full pipe already wakes the poller
+        ssize_t ignored = write(wake[1], "", 1);
+        (void) ignored;
+    }
+};
+
+// The clients have no deadline, they wait for the server as long as it takes
+static const auto NO_DEADLINE = chrono::steady_clock::time_point::max();
+
+// Waits until fd is ready for events, returns false once the deadline passed or the connection failed
+static bool waitFor(int fd, short events, chrono::steady_clock::time_point deadline) {
+    for (;;) {
+        int timeout = -1;
+        if (deadline != NO_DEADLINE) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (left <= 0) {
+                return false;
+            }
+            timeout = (int) left;
+        }
+        pollfd watched{fd, events, 0};
+        int ready = poll(&watched, 1, timeout);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        return ready > 0;
+    }
+}
+
+// The sockets stay blocking, each call is made not to wait and poll does the waiting, so the deadline holds for the
+// whole transfer and not for each piece of it
+static bool readAll(int fd, char *data, size_t size, chrono::steady_clock::time_point deadline) {
+    while (size > 0) {
+        ssize_t got = recv(fd, data, size, MSG_DONTWAIT);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!waitFor(fd, POLLIN, deadline)) {
+                return false;
+            }
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        data += got;
+        size -= got;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const char *data, size_t size, chrono::steady_clock::time_point deadline) {
+    while (size > 0) {
+        // A client that went away must not kill the server with SIGPIPE
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!waitFor(fd, POLLOUT, deadline)) {
+                return false;
+            }
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+static bool readNumber(int fd, uint32_t &number, chrono::steady_clock::time_point deadline) {
+    uint32_t wire;
+    if (!readAll(fd, reinterpret_cast<char *>(&wire), sizeof(wire), deadline)) {
+        return false;
+    }
+    number = ntohl(wire);
+    return true;
+}
+
+static bool writeResponse(int fd, ServeStatus status, uint32_t micros, const string &text,
+                          chrono::steady_clock::time_point deadline) {
+    uint32_t header[3] = {htonl(status), htonl(micros), htonl((uint32_t) text.size())};
+    return writeAll(fd, reinterpret_cast<const char *>(header), sizeof(header), deadline) &&
+           writeAll(fd, text.data(), text.size(), deadline);
+}
+
+static int openSocket(const string &path, sockaddr_un &address) {
+    if (path.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+}
+
+class ServerStats {
+public:
+    atomic<uint64_t> requests{0};
+    atomic<uint64_t> busy{0};
+    atomic<uint64_t> totalMicros{0};
+    atomic<uint64_t> maxMicros{0};
+
+    void record(uint64_t micros) {
+        requests++;
+        totalMicros += micros;
+        uint64_t seen = maxMicros;
+        while (micros > seen && !maxMicros.compare_exchange_weak(seen, micros)) {
+        }
+    }
+};
+
+// Answers the next request of a connection, returns false once the client closed it or broke the protocol
+static bool serveRequest(int fd, ServerStats &stats) {
+    auto deadline = chrono::steady_clock::now() + REQUEST_TIMEOUT;
+    uint32_t size;
+    if (!readNumber(fd, size, deadline) || size > MAX_REQUEST_SIZE) {
+        return false;
+    }
+    // The size is only what the client claims, the memory follows the bytes it really sent
+    string program;
+    while (program.size() < size) {
+        size_t received = program.size();
+        program.resize(received + min(READ_CHUNK, size - received));
+        if (!readAll(fd, &program[received], program.size() - received, deadline)) {
+            return false;
+        }
+    }
+    auto start = chrono::steady_clock::now();
+    CheckResult result = check(program);
+    auto end = chrono::steady_clock::now();
+    uint64_t micros = chrono::duration_cast<chrono::microseconds>(end - start).count();
+    stats.record(micros);
+    return writeResponse(fd, SERVE_CHECKED, (uint32_t) micros, result.output, end + REQUEST_TIMEOUT);
+}
+
+// A connection the poller watches, and when it last had a request
+class IdleConnection {
+public:
+    int fd;
+    chrono::steady_clock::time_point since;
+};
+
+// Accepts the connections and watches the idle ones, a connection with a request coming goes to the queue, or is
+// answered SERVE_BUSY if the queue is full
+// Returns once idle is stopped, closing the connections it still watches
+static void pollConnections(int listener, IdleConnections &idle, ConnectionQueue &queue, ServerStats &stats) {
+    vector<IdleConnection> connections;
+    vector<pollfd> watched;
+    vector<int> returned;
+    for (;;) {
+        watched.clear();
+        watched.push_back({listener, POLLIN, 0});
+        watched.push_back({idle.wakeFd(), POLLIN, 0});
+        for (auto &connection : connections) {
+            watched.push_back({connection.fd, POLLIN, 0});
+        }
+        // Wakes up every second to close the connections idle for too long
+        if (poll(watched.data(), watched.size(), 1000) < 0 && errno != EINTR) {
+            break;
+        }
+        auto now = chrono::steady_clock::now();
+        vector<IdleConnection> stillIdle;
+        for (size_t i = 0; i < connections.size(); ++i) {
+            int fd = connections[i].fd;
+            if (watched[i + 2].revents) {
+                // A request, or the client closed the connection, which the worker finds out
+                if (!queue.tryPush(fd)) {
+                    stats.busy++;
+                    // The poller never waits for a client, the answer goes out only if the socket takes it now
+                    writeResponse(fd, SERVE_BUSY, 0, "", now);
+                    close(fd);
+                }
+            } else if (now - connections[i].since >= IDLE_TIMEOUT) {
+                close(fd);
+            } else {
+                stillIdle.push_back(connections[i]);
+            }
+        }
+        connections.swap(stillIdle);
+
+        returned.clear();
+        bool running = idle.take(returned);
+        for (int fd : returned) {
+            connections.push_back({fd, now});
+        }
+        if (!running) {
+            break;
+        }
+        if (watched[0].revents & POLLIN) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                connections.push_back({fd, now});
+            }
+        }
+    }
+    for (auto &connection : connections) {
+        close(connection.fd);
+    }
+}
+
+int runServer(const ServeOptions &options) {
+    // Only the main thread takes the stop signals, it waits for them with sigwait
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, nullptr);
+
+    sockaddr_un address;
+    int listener = openSocket(options.socketPath, address);
+    if (listener < 0) {
+        cerr << "cannot create socket " << options.socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    // A socket left behind by a server that did not stop cleanly
+    unlink(options.socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, 128) != 0) {
+        cerr << "cannot listen on " << options.socketPath << ": " << strerror(errno) << endl;
+        close(listener);
+        return 1;
+    }
+
+    unsigned jobs = options.jobs ? options.jobs : thread::hardware_concurrency();
+    if (!jobs) {
+        jobs = 1;
+    }
+    IdleConnections idle;
+    if (!idle.valid()) {
+        cerr << "cannot create the poller pipe: " << strerror(errno) << endl;
+        close(listener);
+        unlink(options.socketPath.c_str());
+        return 1;
+    }
+    ServerStats stats;
+    ConnectionQueue queue(options.queueCapacity);
+    vector<thread> workers;
+    for (unsigned w = 0; w < jobs; ++w) {
+        workers.emplace_back([&] {
+            int fd;
+            while (queue.pop(fd)) {
+                // One request per turn, the connection waits for the next one in the poller and not in this worker
+                if (serveRequest(fd, stats)) {
+                    idle.giveBack(fd);
+                } else {
+                    close(fd);
+                }
+            }
+        });
+    }
+    thread poller([&] {
+        pollConnections(listener, idle, queue, stats);
+    });
+    cerr << "serving on " << options.socketPath << " with " << jobs << " workers" << endl;
+
+    int signal;
+    sigwait(&stopSignals, &signal);
+
+    idle.stop();
+    poller.join();
+    close(listener);
+    unlink(options.socketPath.c_str());
+    // The requests already queued are still answered
+    queue.close();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    uint64_t requests = stats.requests;
+    char line[256];
+    snprintf(line, sizeof(line), "served %llu checks, %llu connections busy, mean %.1f us, max %llu us",
+             (unsigned long long) requests, (unsigned long long) stats.busy.load(),
+             requests ? double(stats.totalMicros) / requests : 0.0, (unsigned long long) stats.maxMicros.load());
+    cerr << line << endl;
+    return 0;
+}
+
+int runClient(const string &socketPath) {
+    sockaddr_un address;
+    int fd = openSocket(socketPath, address);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        cerr << "cannot connect to " << socketPath << ": " << strerror(errno) << endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    string program((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+    uint32_t size = htonl((uint32_t) program.size());
+    uint32_t status, micros, length;
+    bool ok = writeAll(fd, reinterpret_cast<const char *>(&size), sizeof(size), NO_DEADLINE) &&
+              writeAll(fd, program.data(), program.size(), NO_DEADLINE) &&
+              readNumber(fd, status, NO_DEADLINE) && readNumber(fd, micros, NO_DEADLINE) &&
+              readNumber(fd, length, NO_DEADLINE);
+    string text(ok ? length : 0, '\0');
+    ok = ok && readAll(fd, &text[0], text.size(), NO_DEADLINE);
+    close(fd);
+    if (!ok) {
+        cerr << "connection to " << socketPath << " was lost" << endl;
+        return 1;
+    }
+    if (status == SERVE_BUSY) {
+        cerr << "server is busy" << endl;
+        return 1;
+    }
+    fwrite(text.data(), 1, text.size(), stdout);
+    return 0;
+}
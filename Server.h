@@ -0,0 +1,41 @@
+//
+// Resident checker, serving programs over a Unix domain socket
+//
+
+#ifndef HW3_SERVER_H
+#define HW3_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Every frame on the socket starts with 32 bit big endian numbers
+// Request:  length, then the program text
+// Response: status, check time in microseconds, length, then the output text (exactly what "hw3 < program" prints)
+// A connection can send any number of requests, each one is answered before the next one is read
+// Between two requests a connection holds no worker, it is closed after 60 seconds without a request, or when a
+// request takes more than 10 seconds to arrive or its answer more than 10 seconds to be read
+enum ServeStatus : uint32_t {
+    SERVE_CHECKED = 0,
+    // The request was not queued because every worker is busy and the queue is full, nothing was checked
+    SERVE_BUSY = 1
+};
+
+class ServeOptions {
+public:
+    string socketPath;
+    // 0 is one worker per core
+    unsigned jobs = 0;
+    // Requests waiting for a worker, a request that does not fit is answered SERVE_BUSY and its connection closed
+    size_t queueCapacity = 64;
+};
+
+// Serves until SIGINT or SIGTERM, then removes the socket and prints the request count and timing to stderr
+int runServer(const ServeOptions &options);
+
+// Sends the program read from stdin to a server and prints the answer, for scripts and editor hooks
+int runClient(const string &socketPath);
+
+#endif //HW3_SERVER_H
@@ -0,0 +1,71 @@
+//
+// Where the time of a check goes, for hw3 --stats
+//
+
+#include "Stats.h"
+#include "Semantics.h"
+
+#include <chrono>
+#include <vector>
+#include <sys/resource.h>
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void measureFrontEnd(const char *data, size_t size, StatsReport &report) {
+    report.bytes = size;
+    vector<int> kinds;
+    auto start = chrono::steady_clock::now();
+    scanTokens(data, size, kinds);
+    report.scanSeconds = secondsSince(start);
+    report.tokens = kinds.size();
+
+    start = chrono::steady_clock::now();
+    report.reductions = countReductions(kinds);
+    report.parseSeconds = secondsSince(start);
+}
+
+size_t peakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in kilobytes on Linux
+    return size_t(usage.ru_maxrss);
+}
+
+void StatsReport::print(FILE *out) const {
+    // What the check spent beyond scanning and parsing, never below 0 when the timings are noisy
+    double semanticSeconds = checkSeconds - scanSeconds - parseSeconds;
+    if (semanticSeconds < 0) {
+        semanticSeconds = 0;
+    }
+    fprintf(out, "phase            ms\n");
+    fprintf(out, "read       %9.3f\n", readSeconds * 1000);
+    fprintf(out, "scan       %9.3f  (scanner alone)\n", scanSeconds * 1000);
+    fprintf(out, "parse      %9.3f  (parse tables alone)\n", parseSeconds * 1000);
+    fprintf(out, "semantic   %9.3f  (check - scan - parse)\n", semanticSeconds * 1000);
+    fprintf(out, "check      %9.3f\n", checkSeconds * 1000);
+    fprintf(out, "output     %9.3f\n", outputSeconds * 1000);
+    fprintf(out, "bytes          %llu\n", (unsigned long long) bytes);
+    fprintf(out, "tokens         %llu  (%.0f tokens/s checked)\n", (unsigned long long) tokens,
+            checkSeconds > 0 ? tokens / checkSeconds : 0.0);
+    fprintf(out, "reductions     %llu\n", (unsigned long long) reductions);
+    if (parserDepth) {
+        fprintf(out, "parser stack   %llu entries\n", (unsigned long long) parserDepth);
+    } else {
+        fprintf(out, "parser stack   initial\n");
+    }
+    fprintf(out, "peak rss       %llu KB\n", (unsigned long long) peakRssKb);
+#ifdef HW3_STATS
+    fprintf(out, "lookups        %llu\n", (unsigned long long) counters.lookups);
+    fprintf(out, "rows scanned   %llu\n", (unsigned long long) counters.rowsScanned);
+    fprintf(out, "scopes opened  %llu\n", (unsigned long long) counters.scopesOpened);
+    fprintf(out, "scopes closed  %llu\n", (unsigned long long) counters.scopesClosed);
+    fprintf(out, "bytes written  %llu\n", (unsigned long long) counters.bytesWritten);
+    fprintf(out, "byte overflows %llu  (folded byte arithmetic that wrapped)\n",
+            (unsigned long long) counters.byteOverflows);
+#else
+    fprintf(out, "lookups, rows scanned, scopes, bytes written and byte overflows are only counted when built with "
+                 "HW3_STATS\n");
+#endif
+}
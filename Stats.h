@@ -0,0 +1,70 @@
+//
+// Where the time of a check goes, for hw3 --stats
+//
+
+#ifndef HW3_STATS_H
+#define HW3_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+using namespace std;
+
+// Counters of the semantic hot paths, one set per check
+// They are only incremented when the checker is built with HW3_STATS, otherwise COUNT_STAT compiles to nothing
+// and they stay 0
+class CheckStats {
+public:
+    // findSymbol calls (isDeclared, isDeclaredVariable, Call::Call, ...) and the rows they looked at
+    uint64_t lookups = 0;
+    uint64_t rowsScanned = 0;
+    uint64_t scopesOpened = 0;
+    uint64_t scopesClosed = 0;
+    // Bytes of the scope dump lines written by output::printID
+    uint64_t bytesWritten = 0;
+    // Folded byte arithmetic whose exact result left 0 to 255 and was wrapped, the way it is at run time
+    uint64_t byteOverflows = 0;
+};
+
+#ifdef HW3_STATS
+#define COUNT_STAT(ctx, counter, amount) ((ctx)->stats.counter += (amount))
+#else
+#define COUNT_STAT(ctx, counter, amount) ((void) (amount))
+#endif
+
+// Wall time of each phase and the counters of one check
+// The check interleaves scanning, parsing and the semantic actions, so the scanner and the parse tables are also
+// timed alone on the same input, and the semantic actions get the rest of the check
+class StatsReport {
+public:
+    size_t bytes = 0;
+    size_t tokens = 0;
+    size_t reductions = 0;
+    // The entries the parser stacks grew to, 0 if they never outgrew the arrays bison starts with
+    size_t parserDepth = 0;
+    // The peak resident memory of the process once the check is done, ru_maxrss
+    size_t peakRssKb = 0;
+    double readSeconds = 0;
+    // The scanner alone
+    double scanSeconds = 0;
+    // The parse tables alone, over the tokens of the scanner, no semantic action runs
+    double parseSeconds = 0;
+    // The whole check
+    double checkSeconds = 0;
+    // Flushing the scope dumps
+    double outputSeconds = 0;
+    CheckStats counters;
+
+    void print(FILE *out) const;
+};
+
+// Scans the program and replays its tokens through the parse tables, filling bytes, tokens, reductions and the scan
+// and parse times
+// A lexical error stops both at the token before it
+void measureFrontEnd(const char *data, size_t size, StatsReport &report);
+
+// The peak resident memory of the process so far, in kilobytes
+size_t peakRssKb();
+
+#endif //HW3_STATS_H
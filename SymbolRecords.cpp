@@ -0,0 +1,178 @@
+//
+// Symbol records, see SymbolRecords.h for the two formats
+//
+
+#include "SymbolRecords.h"
+
+#include <cstdio>
+
+static const char *const KIND_NAMES[] = {"", "types", "signature", "scope", "variable", "parameter", "function",
+                                         "error"};
+
+static void appendU32(string &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(char((value >> shift) & 0xff));
+    }
+}
+
+// The names and the messages are plain ASCII, only quotes, backslashes and control characters need escaping
+void appendJsonString(string &out, string_view text) {
+    out.push_back('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if ((unsigned char) c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) c);
+            out.append(escaped);
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+static void beginJson(string &out, SymbolRecordKind kind) {
+    out.clear();
+    out.append("{\"kind\":\"").append(KIND_NAMES[kind]).append("\"");
+}
+
+static void beginBinary(string &out, SymbolRecordKind kind) {
+    out.clear();
+    appendU32(out, 0);
+    out.push_back(char(kind));
+}
+
+SymbolRecordWriter::SymbolRecordWriter(output::Sink &target, SymbolFormat format) : target(target), format(format) {
+    if (format == SYMBOLS_JSON) {
+        beginJson(record, RECORD_TYPES);
+        record.append(",\"names\":[");
+        for (int type = TYPE_VOID; type < TYPE_NONE; ++type) {
+            if (type != TYPE_VOID) {
+                record.push_back(',');
+            }
+            appendJsonString(record, typeName(TypeId(type)));
+        }
+        record.append("]}\n");
+        target.write(record);
+        return;
+    }
+    string header = "HW3S";
+    appendU32(header, SYMBOL_RECORDS_VERSION);
+    target.write(header);
+    for (int type = TYPE_VOID; type < TYPE_NONE; ++type) {
+        beginBinary(record, RECORD_TYPES);
+        appendU32(record, uint32_t(type));
+        record.append(typeName(TypeId(type)));
+        endBinary();
+    }
+}
+
+void SymbolRecordWriter::scope(const CheckerContext &ctx, const SymbolTable &scope, size_t depth) {
+    // The functions of the scope come after the signatures they use
+    for (const shared_ptr<SymbolTableRow> &row : scope.rows) {
+        if (row->isFunc) {
+            signature(ctx.signatures, row->type);
+        }
+    }
+    if (format == SYMBOLS_JSON) {
+        beginJson(record, RECORD_SCOPE);
+        record.append(",\"depth\":").append(to_string(depth));
+        record.append(",\"symbols\":").append(to_string(scope.rows.size())).append("}\n");
+        target.write(record);
+    } else {
+        beginBinary(record, RECORD_SCOPE);
+        appendU32(record, uint32_t(depth));
+        appendU32(record, uint32_t(scope.rows.size()));
+        endBinary();
+    }
+    for (const shared_ptr<SymbolTableRow> &row : scope.rows) {
+        SymbolRecordKind kind = row->isFunc ? RECORD_FUNCTION : row->offset < 0 ? RECORD_PARAMETER : RECORD_VARIABLE;
+        string_view name = ctx.names.get(row->name);
+        if (format == SYMBOLS_JSON) {
+            beginJson(record, kind);
+            record.append(",\"name\":");
+            appendJsonString(record, name);
+            record.append(row->isFunc ? ",\"signature\":" : ",\"type\":").append(to_string(row->type));
+            record.append(",\"offset\":").append(to_string(row->offset));
+            record.append(",\"depth\":").append(to_string(depth));
+            record.append(",\"line\":").append(to_string(row->line)).append("}\n");
+            target.write(record);
+        } else {
+            beginBinary(record, kind);
+            appendU32(record, uint32_t(row->type));
+            appendU32(record, uint32_t(row->offset));
+            appendU32(record, uint32_t(depth));
+            appendU32(record, uint32_t(row->line));
+            record.append(name);
+            endBinary();
+        }
+    }
+}
+
+void SymbolRecordWriter::signature(const SignatureTable &signatures, SigId id) {
+    if (size_t(id) >= signaturesWritten.size()) {
+        signaturesWritten.resize(id + 1);
+    }
+    if (signaturesWritten[id]) {
+        return;
+    }
+    signaturesWritten[id] = true;
+    const Signature &signature = signatures.get(id);
+    if (format == SYMBOLS_JSON) {
+        beginJson(record, RECORD_SIGNATURE);
+        record.append(",\"id\":").append(to_string(id)).append(",\"params\":[");
+        for (size_t i = 0; i < signature.params.size(); ++i) {
+            if (i) {
+                record.push_back(',');
+            }
+            record.append(to_string(signature.params[i]));
+        }
+        record.append("],\"returns\":").append(to_string(signature.ret)).append("}\n");
+        target.write(record);
+        return;
+    }
+    beginBinary(record, RECORD_SIGNATURE);
+    appendU32(record, uint32_t(id));
+    appendU32(record, uint32_t(signature.ret));
+    appendU32(record, uint32_t(signature.params.size()));
+    for (TypeId param : signature.params) {
+        appendU32(record, uint32_t(param));
+    }
+    endBinary();
+}
+
+void SymbolRecordWriter::endBinary() {
+    string length;
+    appendU32(length, uint32_t(record.size() - 4));
+    record.replace(0, 4, length);
+    target.write(record);
+}
+
+void SymbolRecordWriter::write(const char *data, size_t size) {
+    target.write(data, size);
+}
+
+void SymbolRecordWriter::diagnostic(const char *data, size_t size) {
+    string_view message(data, size);
+    if (!message.empty() && message.back() == '\n') {
+        message.remove_suffix(1);
+    }
+    if (format == SYMBOLS_JSON) {
+        beginJson(record, RECORD_ERROR);
+        record.append(",\"message\":");
+        appendJsonString(record, message);
+        record.append("}\n");
+        target.write(record);
+    } else {
+        beginBinary(record, RECORD_ERROR);
+        record.append(message);
+        endBinary();
+    }
+    target.flush();
+}
+
+void SymbolRecordWriter::flush() {
+    target.flush();
+}
@@ -0,0 +1,93 @@
+//
+// Symbol records, a structured alternative to the scope dumps for tools that read every symbol of a program
+//
+
+#ifndef HW3_SYMBOL_RECORDS_H
+#define HW3_SYMBOL_RECORDS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "hw3_output.hpp"
+#include "Semantics.h"
+
+using namespace std;
+
+// How the scopes closed by the check are written
+enum SymbolFormat : unsigned char {
+    // The graded scope dumps, ---end scope--- then one "name TYPE offset" line per symbol
+    SYMBOLS_TEXT,
+    // One JSON object per line
+    SYMBOLS_JSON,
+    // Length prefixed little endian records
+    SYMBOLS_BINARY
+};
+
+// What a record describes, the same kinds in both formats
+// The JSON objects have a "kind" field with the name of the kind, the binary records start with its number
+//
+// types      JSON: {"kind":"types","names":["VOID","INT",...]}, the index of a name is its type id
+//            binary: a record per type, u32 id then the name
+// signature  written before the first function that has it
+//            JSON: {"kind":"signature","id":N,"params":[type ids],"returns":type id}
+//            binary: u32 id, u32 return type id, u32 parameter count, a u32 type id per parameter
+// scope      a closed scope, followed by its symbols in declaration order, the global scope closes last
+//            JSON: {"kind":"scope","depth":N,"symbols":N}, the global scope has depth 0
+//            binary: u32 depth, u32 symbol count
+// variable,  JSON: {"kind":"variable","name":"x","type":1,"offset":0,"depth":N,"line":N}
+// parameter  binary: u32 type id, i32 offset, u32 depth, u32 line, then the name
+// function   same as a variable, with "signature" (the signature id) instead of "type", line 0 for print and printi
+// error      the diagnostic of an invalid program, nothing follows it
+//            JSON: {"kind":"error","message":"line 3: syntax error"}
+//            binary: the message
+//
+// A binary stream starts with the 4 bytes HW3S and a u32 version, each record is a u32 length (of the kind byte and
+// the payload), a u8 kind and the payload, the name or the message takes the rest of the record
+enum SymbolRecordKind : unsigned char {
+    RECORD_TYPES = 1,
+    RECORD_SIGNATURE,
+    RECORD_SCOPE,
+    RECORD_VARIABLE,
+    RECORD_PARAMETER,
+    RECORD_FUNCTION,
+    RECORD_ERROR
+};
+
+const uint32_t SYMBOL_RECORDS_VERSION = 1;
+
+// Appends text to out as a quoted JSON string
+void appendJsonString(string &out, string_view text);
+
+// Writes the records of a check to another sink, in place of the scope dumps
+// The check writes its diagnostic through it, so an invalid program ends with an error record instead of a text line
+class SymbolRecordWriter : public output::Sink {
+public:
+    // Writes the header and the types records
+    SymbolRecordWriter(output::Sink &target, SymbolFormat format);
+
+    // Writes a scope that is being closed, called by closeCurrentScope, depth is 0 for the global scope
+    void scope(const CheckerContext &ctx, const SymbolTable &scope, size_t depth);
+
+    using output::Sink::write;
+
+    void write(const char *data, size_t size) override;
+
+    void diagnostic(const char *data, size_t size) override;
+
+    void flush() override;
+
+private:
+    output::Sink &target;
+    SymbolFormat format;
+    // The signature ids that already have a record
+    vector<bool> signaturesWritten;
+    string record;
+
+    void signature(const SignatureTable &signatures, SigId id);
+
+    // The binary record in record gets its length and goes to the target
+    void endBinary();
+};
+
+#endif //HW3_SYMBOL_RECORDS_H
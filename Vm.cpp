@@ -0,0 +1,215 @@
+//
+// Runs the bytecode of a checked program, see Bytecode.h
+//
+
+#include "Vm.h"
+
+#include <charconv>
+#include <vector>
+
+// Each handler jumps straight to the handler of the next instruction through a table of label addresses (a GNU
+// extension), instead of going back to the top of one switch, so the branch predictor sees one indirect jump per
+// opcode instead of a single shared one
+// Building with HW3_SWITCH_DISPATCH, or with a compiler without the extension, falls back to the switch
+#if defined(__GNUC__) && !defined(HW3_SWITCH_DISPATCH)
+#define VM_COMPUTED_GOTO
+#endif
+
+// The caller of a call in progress
+class CallFrame {
+public:
+    const Instruction *returnPc;
+    int32_t *registers;
+    int32_t frameSize;
+    // The caller register receiving the returned value
+    int32_t target;
+};
+
+static const char DIVISION_BY_ZERO[] = "Error division by zero\n";
+
+#ifdef VM_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+RunResult runProgram(const Module &module, output::Sink &sink, const RunOptions &options) {
+    RunResult result;
+    if (module.main < 0) {
+        result.status = RUN_NO_MAIN;
+        return result;
+    }
+    vector<int32_t> stack(options.stackSlots);
+    vector<CallFrame> frames(options.maxFrames);
+    const BytecodeFunction &main = module.functions[module.main];
+    if (size_t(main.frameSize) > stack.size()) {
+        result.status = RUN_STACK_OVERFLOW;
+        return result;
+    }
+
+    const Instruction *code = module.code.data();
+    const Instruction *pc = code + main.entry;
+    int32_t *registers = stack.data();
+    const int32_t *stackEnd = stack.data() + stack.size();
+    int32_t frameSize = main.frameSize;
+    size_t depth = 0;
+
+#ifdef VM_COMPUTED_GOTO
+    // In the order of Opcode
+    static const void *const HANDLERS[BC_OPCODE_COUNT] = {
+            &&BC_CONST, &&BC_MOVE, &&BC_ADD, &&BC_SUB, &&BC_MUL, &&BC_DIV, &&BC_TRUNC, &&BC_EQ, &&BC_NE, &&BC_LT,
+            &&BC_GT, &&BC_LE, &&BC_GE, &&BC_NOT, &&BC_JUMP, &&BC_JUMP_FALSE, &&BC_JUMP_TRUE, &&BC_JUMP_CASE,
+            &&BC_CALL, &&BC_RETURN, &&BC_RETURN_VOID, &&BC_PRINT, &&BC_PRINTI};
+#define VM_CASE(opcode) opcode
+#define VM_DISPATCH() goto *HANDLERS[pc->op]
+    VM_DISPATCH();
+#else
+#define VM_CASE(opcode) case opcode
+#define VM_DISPATCH() continue
+    for (;;) {
+        switch (pc->op) {
+#endif
+    // The int operations wrap around, so they are done on unsigned values, where that is defined
+    VM_CASE(BC_CONST):
+        registers[pc->a] = pc->b;
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_MOVE):
+        registers[pc->a] = registers[pc->b];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_ADD):
+        registers[pc->a] = int32_t(uint32_t(registers[pc->b]) + uint32_t(registers[pc->c]));
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_SUB):
+        registers[pc->a] = int32_t(uint32_t(registers[pc->b]) - uint32_t(registers[pc->c]));
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_MUL):
+        registers[pc->a] = int32_t(uint32_t(registers[pc->b]) * uint32_t(registers[pc->c]));
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_DIV): {
+        int32_t divisor = registers[pc->c];
+        if (divisor == 0) {
+            sink.write(DIVISION_BY_ZERO, sizeof(DIVISION_BY_ZERO) - 1);
+            result.status = RUN_DIVISION_BY_ZERO;
+            return result;
+        }
+        int32_t dividend = registers[pc->b];
+        // The one quotient that does not fit wraps around to itself
+        registers[pc->a] = divisor == -1 ? int32_t(0u - uint32_t(dividend)) : dividend / divisor;
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(BC_TRUNC):
+        registers[pc->a] &= 0xff;
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_EQ):
+        registers[pc->a] = registers[pc->b] == registers[pc->c];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_NE):
+        registers[pc->a] = registers[pc->b] != registers[pc->c];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_LT):
+        registers[pc->a] = registers[pc->b] < registers[pc->c];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_GT):
+        registers[pc->a] = registers[pc->b] > registers[pc->c];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_LE):
+        registers[pc->a] = registers[pc->b] <= registers[pc->c];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_GE):
+        registers[pc->a] = registers[pc->b] >= registers[pc->c];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_NOT):
+        registers[pc->a] = !registers[pc->b];
+        ++pc;
+        VM_DISPATCH();
+    VM_CASE(BC_JUMP):
+        pc = code + pc->a;
+        VM_DISPATCH();
+    VM_CASE(BC_JUMP_FALSE):
+        pc = registers[pc->a] ? pc + 1 : code + pc->b;
+        VM_DISPATCH();
+    VM_CASE(BC_JUMP_TRUE):
+        pc = registers[pc->a] ? code + pc->b : pc + 1;
+        VM_DISPATCH();
+    VM_CASE(BC_JUMP_CASE):
+        pc = registers[pc->a] == pc->b ? code + pc->c : pc + 1;
+        VM_DISPATCH();
+    VM_CASE(BC_CALL): {
+        const BytecodeFunction &callee = module.functions[pc->b];
+        int32_t *calleeRegisters = registers + frameSize;
+        if (depth == frames.size() || calleeRegisters + callee.frameSize > stackEnd) {
+            result.status = RUN_STACK_OVERFLOW;
+            return result;
+        }
+        frames[depth++] = CallFrame{pc + 1, registers, frameSize, pc->a};
+        const int32_t *args = registers + pc->c;
+        for (int32_t i = 0; i < callee.params; ++i) {
+            calleeRegisters[i] = args[i];
+        }
+        registers = calleeRegisters;
+        frameSize = callee.frameSize;
+        pc = code + callee.entry;
+        VM_DISPATCH();
+    }
+    VM_CASE(BC_RETURN): {
+        if (depth == 0) {
+            return result;
+        }
+        int32_t value = registers[pc->a];
+        const CallFrame &caller = frames[--depth];
+        registers = caller.registers;
+        frameSize = caller.frameSize;
+        registers[caller.target] = value;
+        pc = caller.returnPc;
+        VM_DISPATCH();
+    }
+    VM_CASE(BC_RETURN_VOID): {
+        if (depth == 0) {
+            return result;
+        }
+        const CallFrame &caller = frames[--depth];
+        registers = caller.registers;
+        frameSize = caller.frameSize;
+        pc = caller.returnPc;
+        VM_DISPATCH();
+    }
+    VM_CASE(BC_PRINT): {
+        const string &text = module.strings[registers[pc->a]];
+        sink.write(text.data(), text.size());
+        sink.write("\n", 1);
+        ++pc;
+        VM_DISPATCH();
+    }
+    VM_CASE(BC_PRINTI): {
+        char buffer[16];
+        char *end = to_chars(buffer, buffer + sizeof(buffer) - 1, registers[pc->a]).ptr;
+        *end++ = '\n';
+        sink.write(buffer, size_t(end - buffer));
+        ++pc;
+        VM_DISPATCH();
+    }
+#ifndef VM_COMPUTED_GOTO
+            default:
+                return result;
+        }
+    }
+#endif
+#undef VM_CASE
+#undef VM_DISPATCH
+}
+
+#ifdef VM_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
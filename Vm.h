@@ -0,0 +1,41 @@
+//
+// Runs the bytecode of a checked program, see Bytecode.h
+//
+
+#ifndef HW3_VM_H
+#define HW3_VM_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Bytecode.h"
+#include "hw3_output.hpp"
+
+using namespace std;
+
+class RunOptions {
+public:
+    // Registers of the frame stack, allocated once before main is called
+    size_t stackSlots = 1 << 20;
+    // Calls that can be active at once
+    size_t maxFrames = 1 << 16;
+};
+
+enum RunStatus {
+    RUN_OK,
+    // The program divided by zero, the error line was printed like the program output
+    RUN_DIVISION_BY_ZERO,
+    // The calls did not fit in the frame stack
+    RUN_STACK_OVERFLOW,
+    RUN_NO_MAIN
+};
+
+class RunResult {
+public:
+    RunStatus status = RUN_OK;
+};
+
+// Calls main, what the program prints goes to sink
+// The frames are taken from a stack allocated before the first instruction, nothing is allocated while running
+RunResult runProgram(const Module &module, output::Sink &sink, const RunOptions &options = RunOptions());
+
+#endif //HW3_VM_H
@@ -0,0 +1,69 @@
+#!/bin/bash
+
+# Checks the allocation profile of a checker built with -DHW3_ALLOC_PROFILE=ON: every counted object is gone at exit,
+# the nodes of only one function are live at a time, and the output is the same as without the profile
+# Usage: ./alloc_profile_test.bash [path to hw3 built with HW3_ALLOC_PROFILE]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+status=0
+
+fail() {
+    echo "$1"
+    status=1
+}
+
+# $1 functions, each with a loop, a branch and a call to the one before it
+generate() {
+    awk -v n="$1" 'BEGIN {
+        for (i = 0; i < n; i++) {
+            printf "int f%d(int p) {\n    int x = p;\n", i;
+            if (i) printf "    x = f%d(x);\n", i - 1;
+            printf "    while (x > 3) {\n        x = x - 1;\n    }\n    if (x == 2) {\n        return x;\n    }\n";
+            printf "    return x + 1;\n}\n";
+        }
+        printf "void main() {\n    printi(f%d(1));\n}\n", n - 1;
+    }'
+}
+
+# $1 profile, $2 class, $3 column: 2 count, 3 bytes, 4 peak live, 5 live at exit
+column() {
+    awk -v name="$2" -v column="$3" '$1 == name { print $column; exit }' "$1"
+}
+
+generate 1000 > "$tmpdir/small.in"
+generate 2000 > "$tmpdir/large.in"
+"$hw3" < "$tmpdir/small.in" > "$tmpdir/small.out" 2> "$tmpdir/small.profile"
+"$hw3" < "$tmpdir/large.in" > "$tmpdir/large.out" 2> "$tmpdir/large.profile"
+if ! grep -q "^class " "$tmpdir/large.profile"; then
+    echo "$hw3 printed no allocation profile, is it built with -DHW3_ALLOC_PROFILE=ON?"
+    exit 1
+fi
+cat "$tmpdir/large.profile"
+
+for class in TypeNode Exp Statement Statements FormalsList SymbolTableRow SymbolTable Signature; do
+    if [ "$(column "$tmpdir/large.profile" $class 2)" = "" ]; then
+        fail "$class is not in the profile"
+    fi
+done
+if awk 'NR > 1 && $1 == "phase" { exit } NR > 1 && $5 != 0 { found = 1 } END { exit !found }' "$tmpdir/large.profile"; then
+    fail "some objects are still live at exit"
+fi
+# Twice the functions, twice the nodes, but the arena is reset after each function
+if [ "$(column "$tmpdir/large.profile" Exp 2)" -le "$(column "$tmpdir/small.profile" Exp 2)" ] ||
+    [ "$(column "$tmpdir/large.profile" Exp 4)" != "$(column "$tmpdir/small.profile" Exp 4)" ]; then
+    fail "the peak of live Exp nodes grows with the number of functions"
+fi
+# The rows of the global scope stay until the end
+if [ "$(column "$tmpdir/large.profile" SymbolTableRow 4)" -le "$(column "$tmpdir/small.profile" SymbolTableRow 4)" ]; then
+    fail "the peak of live rows does not grow with the functions of the global scope"
+fi
+if [ "$(column "$tmpdir/large.profile" check 2)" = 0 ] || [ "$(column "$tmpdir/large.profile" scan 2)" = 0 ]; then
+    fail "no heap allocation is charged to the scan or the check"
+fi
+if [ "$(tail -n 2 "$tmpdir/large.out" | head -n 1)" != "f1999 (INT)->INT 0" ]; then
+    fail "the scope dump of the program differs"
+fi
+
+exit $status
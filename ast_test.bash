@@ -0,0 +1,88 @@
+#!/bin/bash
+
+# Checks the syntax tree printed by --ast
+# Usage: ./ast_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+status=0
+# Building the tree never changes the result of the check, and a valid program has one function node per function
+for f in hw3-tests/*.in tests/*.in; do
+    "$hw3" --quiet < "$f" 2> /dev/null
+    expected=$?
+    "$hw3" --ast < "$f" > "$tmpdir/tree" 2> /dev/null
+    actual=$?
+    if [ "$actual" != "$expected" ]; then
+        echo "$f: --ast exits with $actual, the check with $expected"
+        status=1
+    elif [ "$actual" = 0 ] && [ "$(grep -c '^  function ' "$tmpdir/tree")" != "$(grep -cE '^(int|byte|bool|void) ' "$f")" ]; then
+        echo "$f: the tree does not have one node per function"
+        status=1
+    fi
+done
+
+# Every value the checker used to drop is in the tree: the bodies of if, else and while, the switch value, the default
+cat > "$tmpdir/p.in" <<'PROGRAM'
+int f(int a) {
+    int c = a + 2 * 3;
+    if (c > a) c = c - 1; else return 0;
+    while (c < 10) { c = f(c); }
+    switch (c) { case 1: break; default: print("d"); }
+    return c;
+}
+void main() {
+    printi(f(1));
+}
+PROGRAM
+cat > "$tmpdir/expected" <<'TREE'
+program  #0 line 1
+  function f : INT  #1 line 1
+    formal a : INT @-1  #2 line 1
+    decl c : INT @0  #8 line 2
+      binary + : INT  #7 line 2
+        id a : INT -> 2  #3 line 2
+        binary * : INT = 6  #6 line 2
+          literal : INT = 2  #4 line 2
+          literal : INT = 3  #5 line 2
+    if  #16 line 3
+      binary > : BOOL  #11 line 3
+        id c : INT -> 8  #9 line 3
+        id a : INT -> 2  #10 line 3
+      assign c : INT -> 8  #15 line 3
+        binary - : INT  #14 line 3
+          id c : INT -> 8  #12 line 3
+          literal : INT = 1  #13 line 3
+      return  #18 line 3
+        literal : INT = 0  #17 line 3
+    while  #22 line 4
+      binary < : BOOL  #21 line 4
+        id c : INT -> 8  #19 line 4
+        literal : INT = 10  #20 line 4
+      block  #26 line 4
+        assign c : INT -> 8  #25 line 4
+          call f : INT -> 1  #24 line 4
+            id c : INT -> 8  #23 line 4
+    switch  #33 line 5
+      id c : INT -> 8  #27 line 5
+      case : INT = 1  #30 line 5
+        break  #28 line 5
+      default  #34 line 5
+        call print : VOID  #32 line 5
+          literal : STRING "d"  #31 line 5
+    return  #36 line 6
+      id c : INT -> 8  #35 line 6
+  function main : VOID  #37 line 8
+    call printi : VOID  #40 line 9
+      call f : INT -> 1  #39 line 9
+        literal : INT = 1  #38 line 9
+TREE
+"$hw3" --ast < "$tmpdir/p.in" > "$tmpdir/tree"
+if ! cmp -s "$tmpdir/tree" "$tmpdir/expected"; then
+    echo "unexpected tree"
+    diff "$tmpdir/expected" "$tmpdir/tree" | head -20
+    status=1
+fi
+
+exit $status
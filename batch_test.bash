@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# Checks that batch mode gives every file exactly the output of a single "hw3 < file" run
+# Usage: ./batch_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+# Every corpus in one directory, so the batch has enough files to spread over the workers
+for dir in hw3-tests tests; do
+    for f in "$dir"/*.in; do
+        cp "$f" "$tmpdir/${dir}_$(basename "$f")"
+    done
+done
+
+status=0
+"$hw3" --batch "$tmpdir" || status=1
+for f in "$tmpdir"/*.in; do
+    "$hw3" < "$f" > "$tmpdir/expected"
+    if ! cmp -s "$tmpdir/expected" "${f%.in}.res"; then
+        echo "$(basename "$f"): batch output differs from a single run"
+        status=1
+    fi
+    cat "$tmpdir/expected" >> "$tmpdir/expected_stream"
+done
+
+# The stream keeps input order, whatever the order the workers finish in
+"$hw3" --batch --stream --jobs 4 "$tmpdir" > "$tmpdir/stream" || status=1
+if ! cmp -s "$tmpdir/expected_stream" "$tmpdir/stream"; then
+    echo "stream: output differs from the single runs in input order"
+    status=1
+fi
+
+exit $status
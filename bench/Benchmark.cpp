@@ -0,0 +1,210 @@
+//
+// Scaling benchmark, checks generated programs of growing size along each axis and reports the cost as JSON
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "Checker.h"
+#include "Generator.h"
+
+using namespace std;
+
+// The default sizes of each axis, doubling so that the growth of the time shows the complexity
+// The nesting axes stay below the parser depth limit
+static const size_t DEFAULT_SIZES[AXIS_COUNT][4] = {
+        {1000, 2000, 4000, 8000},       // functions
+        {1000, 2000, 4000, 8000},       // params
+        {125,  250,  500,  1000},       // depth
+        {1000, 2000, 4000, 8000},       // locals
+        {1000, 2000, 4000, 8000},       // args
+        {1000, 2000, 4000, 8000},       // cases
+        {250,  500,  1000, 2000},       // expr-depth
+};
+
+class BenchmarkOptions {
+public:
+    uint64_t seed = 1;
+    // The best of this many checks is reported
+    unsigned repeat = 3;
+    // Multiplies every size
+    double scale = 1;
+    vector<GeneratorAxis> axes;
+    // Writes the JSON report there instead of stdout
+    string outputPath;
+};
+
+// What one case measured, sent back from the child process
+class Measurement {
+public:
+    size_t bytes = 0;
+    size_t tokens = 0;
+    bool ok = false;
+    double seconds = 0;
+};
+
+class CaseResult {
+public:
+    GeneratorAxis axis;
+    size_t size;
+    Measurement measurement;
+    // Peak resident set of the process that generated and checked the program, in kilobytes
+    long peakRssKb = 0;
+    bool crashed = false;
+};
+
+static int usage(const char *name) {
+    cerr << "usage: " << name << " [--seed N] [--repeat N] [--scale X] [--axis name]... [--output file]" << endl;
+    cerr << "       " << name << " --emit axis size [--seed N]" << endl;
+    cerr << "axes:";
+    for (int i = 0; i < AXIS_COUNT; ++i) {
+        cerr << " " << axisName(GeneratorAxis(i));
+    }
+    cerr << endl;
+    return 1;
+}
+
+// Generates and checks the program in a child process, so that its peak resident set is the one of this case
+// alone, and a crash only loses this case
+static CaseResult runCase(const BenchmarkOptions &options, GeneratorAxis axis, size_t size) {
+    CaseResult result{axis, size};
+    int channel[2];
+    if (pipe(channel) != 0) {
+        result.crashed = true;
+        return result;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        // Each case gets its own stream, so running a single axis gives the same programs as running all of them
+        ProgramGenerator generator(options.seed * AXIS_COUNT + axis);
+        GeneratedProgram program = generator.generate(axis, size);
+        Measurement measurement;
+        measurement.bytes = program.text.size();
+        measurement.tokens = program.tokens;
+        for (unsigned run = 0; run < options.repeat; ++run) {
+            output::NullSink sink;
+            auto start = chrono::steady_clock::now();
+            measurement.ok = check(program.text.data(), program.text.size(), sink).ok;
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (run == 0 || seconds < measurement.seconds) {
+                measurement.seconds = seconds;
+            }
+        }
+        bool sent = write(channel[1], &measurement, sizeof(measurement)) == (ssize_t) sizeof(measurement);
+        _exit(sent ? 0 : 1);
+    }
+    close(channel[1]);
+    bool received = child > 0 &&
+                    read(channel[0], &result.measurement, sizeof(result.measurement)) ==
+                    (ssize_t) sizeof(result.measurement);
+    close(channel[0]);
+    int status = 0;
+    rusage usage{};
+    if (child < 0 || wait4(child, &status, 0, &usage) < 0) {
+        result.crashed = true;
+        return result;
+    }
+    result.crashed = !received || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    // ru_maxrss is in kilobytes on Linux
+    result.peakRssKb = usage.ru_maxrss;
+    return result;
+}
+
+static void writeReport(FILE *out, const BenchmarkOptions &options, const vector<CaseResult> &results) {
+    fprintf(out, "{\n  \"seed\": %llu,\n  \"repeat\": %u,\n  \"cases\": [", (unsigned long long) options.seed,
+            options.repeat);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CaseResult &result = results[i];
+        const Measurement &measurement = result.measurement;
+        fprintf(out, "%s\n    {\"axis\": \"%s\", \"size\": %zu, \"bytes\": %zu, \"tokens\": %zu, \"ok\": %s, "
+                     "\"crashed\": %s, \"seconds\": %.6f, \"peakRssKb\": %ld, \"tokensPerSecond\": %.0f",
+                i ? "," : "", axisName(result.axis), result.size, measurement.bytes, measurement.tokens,
+                measurement.ok ? "true" : "false", result.crashed ? "true" : "false", measurement.seconds,
+                result.peakRssKb, measurement.seconds > 0 ? measurement.tokens / measurement.seconds : 0.0);
+        // The time ratio to the previous size of the same axis, about 2 for linear growth and 4 for quadratic
+        if (i && results[i - 1].axis == result.axis && results[i - 1].measurement.seconds > 0) {
+            fprintf(out, ", \"growth\": %.2f", measurement.seconds / results[i - 1].measurement.seconds);
+        }
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkOptions options;
+    // --emit prints one generated program instead of running the benchmark
+    bool emit = false;
+    GeneratorAxis emitAxis = AXIS_FUNCTIONS;
+    size_t emitSize = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        GeneratorAxis axis;
+        if (arg == "--seed" && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = (unsigned) atoi(argv[++i]);
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.scale = atof(argv[++i]);
+        } else if (arg == "--axis" && i + 1 < argc && axisByName(argv[i + 1], axis)) {
+            options.axes.push_back(axis);
+            i++;
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else if (arg == "--emit" && i + 2 < argc && axisByName(argv[i + 1], emitAxis)) {
+            emit = true;
+            emitSize = (size_t) atol(argv[i + 2]);
+            i += 2;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!options.repeat || options.scale <= 0) {
+        return usage(argv[0]);
+    }
+    if (emit) {
+        ProgramGenerator generator(options.seed * AXIS_COUNT + emitAxis);
+        GeneratedProgram program = generator.generate(emitAxis, emitSize);
+        fwrite(program.text.data(), 1, program.text.size(), stdout);
+        return 0;
+    }
+    if (options.axes.empty()) {
+        for (int i = 0; i < AXIS_COUNT; ++i) {
+            options.axes.push_back(GeneratorAxis(i));
+        }
+    }
+
+    vector<CaseResult> results;
+    bool failed = false;
+    for (GeneratorAxis axis : options.axes) {
+        for (size_t base : DEFAULT_SIZES[axis]) {
+            size_t size = max<size_t>(1, size_t(base * options.scale));
+            results.push_back(runCase(options, axis, size));
+            const CaseResult &result = results.back();
+            // Progress goes to stderr, so that stdout is only the report
+            fprintf(stderr, "%-10s %8zu  %9.3f ms  %8ld KB%s\n", axisName(axis), size,
+                    result.measurement.seconds * 1000, result.peakRssKb,
+                    result.crashed ? "  crashed" : result.measurement.ok ? "" : "  rejected");
+            failed = failed || result.crashed || !result.measurement.ok;
+        }
+    }
+
+    FILE *out = options.outputPath.empty() ? stdout : fopen(options.outputPath.c_str(), "w");
+    if (!out) {
+        cerr << "cannot write " << options.outputPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    writeReport(out, options, results);
+    if (out != stdout) {
+        fclose(out);
+    }
+    // Every generated program is valid, a rejected one is a bug in the checker or in the generator
+    return failed ? 1 : 0;
+}
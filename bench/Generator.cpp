@@ -0,0 +1,347 @@
+//
+// Synthetic programs for the benchmarks, valid programs that grow along one axis at a time
+//
+
+#include "Generator.h"
+
+static const char *const AXIS_NAMES[AXIS_COUNT] = {"functions", "params", "depth", "locals", "args", "cases",
+                                                   "expr-depth"};
+
+const char *axisName(GeneratorAxis axis) {
+    return AXIS_NAMES[axis];
+}
+
+bool axisByName(string_view name, GeneratorAxis &axis) {
+    for (int i = 0; i < AXIS_COUNT; ++i) {
+        if (name == AXIS_NAMES[i]) {
+            axis = GeneratorAxis(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+ProgramGenerator::ProgramGenerator(uint64_t seed) : random(seed) {
+
+}
+
+size_t ProgramGenerator::choose(size_t count) {
+    return size_t(random() % count);
+}
+
+void ProgramGenerator::token(string_view text) {
+    if (!program.text.empty() && program.text.back() == '\n') {
+        program.text.append(size_t(indentation) * 4, ' ');
+    }
+    program.text.append(text.data(), text.size());
+    program.text.push_back(' ');
+    program.tokens++;
+}
+
+void ProgramGenerator::tokens(initializer_list<string_view> texts) {
+    for (string_view text : texts) {
+        token(text);
+    }
+}
+
+void ProgramGenerator::newline() {
+    program.text.push_back('\n');
+}
+
+void ProgramGenerator::openBlock() {
+    token("{");
+    newline();
+    indentation++;
+}
+
+void ProgramGenerator::closeBlock() {
+    indentation--;
+    token("}");
+    newline();
+}
+
+void ProgramGenerator::intExp(const vector<string> &names, size_t depth) {
+    static const char *const operators[] = {"+", "-", "*"};
+    // Nested to the right, "a + (b * (c - d))", iteratively so that deep expressions do not recurse here
+    auto operand = [&] {
+        size_t kind = choose(4);
+        if (kind == 0) {
+            token(to_string(1 + choose(9)));
+        } else if (kind == 1) {
+            tokens({to_string(choose(256)), "b"});
+        } else {
+            token(names[choose(names.size())]);
+        }
+    };
+    for (size_t i = 0; i < depth; ++i) {
+        operand();
+        tokens({operators[choose(3)], "("});
+    }
+    operand();
+    for (size_t i = 0; i < depth; ++i) {
+        token(")");
+    }
+}
+
+void ProgramGenerator::filler(const vector<string> &names) {
+    const string &name = names[choose(names.size())];
+    switch (choose(4)) {
+        case 0:
+            tokens({"if", "(", name, "<", to_string(choose(100)), ")"});
+            openBlock();
+            tokens({name, "="});
+            intExp(names, 1);
+            token(";");
+            newline();
+            closeBlock();
+            break;
+        case 1:
+            tokens({"while", "(", name, ">", to_string(choose(100)), ")"});
+            openBlock();
+            tokens({name, "=", name, "-", "1", ";"});
+            newline();
+            tokens({"break", ";"});
+            newline();
+            closeBlock();
+            break;
+        case 2:
+            tokens({name, "="});
+            intExp(names, 2);
+            token(";");
+            newline();
+            break;
+        default:
+            tokens({"printi", "(", name, ")", ";"});
+            newline();
+            break;
+    }
+}
+
+void ProgramGenerator::sumFunction(const string &name, size_t params) {
+    tokens({"int", name, "("});
+    for (size_t i = 0; i < params; ++i) {
+        if (i) {
+            token(",");
+        }
+        tokens({choose(4) ? "int" : "byte", "p" + to_string(i)});
+    }
+    token(")");
+    openBlock();
+    token("return");
+    for (size_t i = 0; i < params; ++i) {
+        if (i) {
+            token("+");
+        }
+        token("p" + to_string(i));
+    }
+    if (!params) {
+        token("0");
+    }
+    token(";");
+    newline();
+    closeBlock();
+}
+
+void ProgramGenerator::call(const string &name, size_t args, const vector<string> &names) {
+    tokens({name, "("});
+    for (size_t i = 0; i < args; ++i) {
+        if (i) {
+            token(",");
+        }
+        // A byte argument is accepted for an int parameter, an int one is not accepted for a byte parameter,
+        // so the arguments are byte literals and byte locals
+        if (names.empty() || choose(2)) {
+            tokens({to_string(choose(256)), "b"});
+        } else {
+            token(names[choose(names.size())]);
+        }
+    }
+    token(")");
+}
+
+void ProgramGenerator::functions(size_t count) {
+    tokens({"int", "f0", "(", "int", "p", ")"});
+    openBlock();
+    tokens({"return", "p", ";"});
+    newline();
+    closeBlock();
+    const vector<string> names = {"p", "x"};
+    for (size_t i = 1; i < count; ++i) {
+        tokens({"int", "f" + to_string(i), "(", "int", "p", ")"});
+        openBlock();
+        tokens({"int", "x", "=", "f" + to_string(i - 1), "(", "p", ")", ";"});
+        newline();
+        filler(names);
+        tokens({"return", "x", ";"});
+        newline();
+        closeBlock();
+    }
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    tokens({"printi", "(", "f" + to_string(count ? count - 1 : 0), "(", "1", ")", ")", ";"});
+    newline();
+    closeBlock();
+}
+
+void ProgramGenerator::params(size_t count) {
+    sumFunction("wide", count);
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    tokens({"printi", "("});
+    call("wide", count, {});
+    tokens({")", ";"});
+    newline();
+    closeBlock();
+}
+
+void ProgramGenerator::depth(size_t levels) {
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    vector<string> names;
+    // Each level declares a local and opens a plain block, an if or a while, the innermost level prints them
+    vector<bool> loops;
+    for (size_t i = 0; i < levels; ++i) {
+        string name = "v" + to_string(i);
+        tokens({"int", name, "="});
+        if (names.empty()) {
+            token(to_string(choose(10)));
+        } else {
+            intExp({names.back()}, 1);
+        }
+        token(";");
+        newline();
+        names.push_back(name);
+        size_t kind = choose(3);
+        if (kind == 1) {
+            tokens({"if", "(", name, "<", to_string(choose(100)), ")"});
+        } else if (kind == 2) {
+            tokens({"while", "(", name, ">", to_string(choose(100)), ")"});
+        }
+        loops.push_back(kind == 2);
+        openBlock();
+    }
+    tokens({"printi", "(", names.empty() ? "0" : names.back(), ")", ";"});
+    newline();
+    for (size_t i = levels; i-- > 0;) {
+        if (loops[i]) {
+            tokens({"break", ";"});
+            newline();
+        }
+        closeBlock();
+    }
+    closeBlock();
+}
+
+void ProgramGenerator::locals(size_t count) {
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    vector<string> names;
+    for (size_t i = 0; i < count; ++i) {
+        string name = "l" + to_string(i);
+        // The bool locals are only declared, they are looked up like the others but never used in expressions
+        bool isBool = choose(4) == 0;
+        tokens({isBool ? "bool" : "int", name, "="});
+        if (isBool) {
+            token(choose(2) ? "true" : "false");
+        } else if (names.empty()) {
+            token(to_string(choose(10)));
+        } else {
+            vector<string> recent(names.end() - min<size_t>(names.size(), 3), names.end());
+            intExp(recent, 1);
+        }
+        token(";");
+        newline();
+        if (!isBool) {
+            names.push_back(name);
+        }
+    }
+    tokens({"printi", "(", names.empty() ? "0" : names.back(), ")", ";"});
+    newline();
+    closeBlock();
+}
+
+void ProgramGenerator::args(size_t count) {
+    // The parameters of sum are a mix of int and byte, byte literals and byte locals fit both
+    sumFunction("sum", count);
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    const vector<string> names = {"a", "c"};
+    for (auto &name : names) {
+        tokens({"byte", name, "=", to_string(choose(256)), "b", ";"});
+        newline();
+    }
+    for (int i = 0; i < 16; ++i) {
+        tokens({"printi", "("});
+        call("sum", count, names);
+        tokens({")", ";"});
+        newline();
+    }
+    closeBlock();
+}
+
+void ProgramGenerator::cases(size_t count) {
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    const vector<string> names = {"s"};
+    tokens({"int", "s", "=", to_string(choose(count ? count : 1)), ";"});
+    newline();
+    tokens({"switch", "(", "s", ")"});
+    openBlock();
+    for (size_t i = 0; i < count; ++i) {
+        tokens({"case", to_string(i), ":"});
+        newline();
+        indentation++;
+        filler(names);
+        tokens({"break", ";"});
+        newline();
+        indentation--;
+    }
+    tokens({"default", ":", "break", ";"});
+    newline();
+    closeBlock();
+    closeBlock();
+}
+
+void ProgramGenerator::exprDepth(size_t levels) {
+    tokens({"void", "main", "(", ")"});
+    openBlock();
+    const vector<string> names = {"x"};
+    tokens({"int", "x", "=", to_string(choose(10)), ";"});
+    newline();
+    tokens({"int", "y", "="});
+    intExp(names, levels);
+    token(";");
+    newline();
+    tokens({"printi", "(", "y", ")", ";"});
+    newline();
+    closeBlock();
+}
+
+GeneratedProgram ProgramGenerator::generate(GeneratorAxis axis, size_t size) {
+    program = GeneratedProgram();
+    indentation = 0;
+    switch (axis) {
+        case AXIS_FUNCTIONS:
+            functions(size);
+            break;
+        case AXIS_PARAMS:
+            params(size);
+            break;
+        case AXIS_DEPTH:
+            depth(size);
+            break;
+        case AXIS_LOCALS:
+            locals(size);
+            break;
+        case AXIS_ARGS:
+            args(size);
+            break;
+        case AXIS_CASES:
+            cases(size);
+            break;
+        default:
+            exprDepth(size);
+            break;
+    }
+    return std::move(program);
+}
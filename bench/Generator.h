@@ -0,0 +1,83 @@
+//
+// Synthetic programs for the benchmarks, valid programs that grow along one axis at a time
+//
+
+#ifndef HW3_GENERATOR_H
+#define HW3_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// The dimensions a program can grow along, every other dimension stays at a small fixed size
+enum GeneratorAxis {
+    AXIS_FUNCTIONS,     // functions, each one calling the one before it
+    AXIS_PARAMS,        // parameters of one function
+    AXIS_DEPTH,         // nested blocks
+    AXIS_LOCALS,        // locals declared in one scope
+    AXIS_ARGS,          // arguments of each call to a function
+    AXIS_CASES,         // cases of one switch
+    AXIS_EXPR_DEPTH,    // nested parenthesized operators in one expression
+    AXIS_COUNT
+};
+
+// The name used on the command line and in the reports
+const char *axisName(GeneratorAxis axis);
+
+// Returns false if no axis has this name
+bool axisByName(string_view name, GeneratorAxis &axis);
+
+// A generated program, with the number of tokens the scanner will find in it
+class GeneratedProgram {
+public:
+    string text;
+    size_t tokens = 0;
+};
+
+// The same seed, axis and size always give the same program
+// The random choices (operators, literals, filler statements) only vary the text, the shape is fixed by the size
+class ProgramGenerator {
+public:
+    explicit ProgramGenerator(uint64_t seed);
+
+    GeneratedProgram generate(GeneratorAxis axis, size_t size);
+
+private:
+    // std::mt19937_64 is specified bit for bit, unlike the distributions, so choices use plain modulo
+    mt19937_64 random;
+    GeneratedProgram program;
+    int indentation = 0;
+
+    size_t choose(size_t count);
+
+    // Appends one token followed by a space
+    void token(string_view text);
+    void tokens(initializer_list<string_view> texts);
+    void newline();
+    void openBlock();
+    void closeBlock();
+
+    // An int expression over the given variables, with the given number of nested operators
+    void intExp(const vector<string> &names, size_t depth);
+    // A statement that does not declare anything, using the given variables
+    void filler(const vector<string> &names);
+    // "int f(int p0, ..., int pN) { return p0 + ... }", the sum keeps every parameter used
+    void sumFunction(const string &name, size_t params);
+    void call(const string &name, size_t args, const vector<string> &names);
+
+    void functions(size_t count);
+    void params(size_t count);
+    void depth(size_t levels);
+    void locals(size_t count);
+    void args(size_t count);
+    void cases(size_t count);
+    void exprDepth(size_t levels);
+};
+
+#endif //HW3_GENERATOR_H
@@ -0,0 +1,250 @@
+//
+// Regression runner, checks every .in/.out pair of the test corpora in one process and compares the time of each test
+// with a stored baseline
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Batch.h"
+#include "Checker.h"
+
+using namespace std;
+
+class RegressionOptions {
+public:
+    vector<string> paths;
+    // 0 is one worker per core
+    unsigned jobs = 0;
+    // Each test is checked this many times, the best time is the one reported
+    unsigned repeat = 5;
+    // The times of a previous run, a missing file is written with the times of this run
+    string baselinePath;
+    // Replace the baseline with the times of this run, even if it exists
+    bool updateBaseline = false;
+    // A test is slower when its time grew by more than this fraction of the baseline and by more than minMicros,
+    // so the noise of the smallest tests is not reported
+    double tolerance = 0.5;
+    double minMicros = 50;
+};
+
+enum TestStatus {
+    TEST_PASSED,
+    TEST_FAILED,
+    // The .in or the .out cannot be read
+    TEST_UNREADABLE
+};
+
+class TestResult {
+public:
+    string path;
+    string expectedPath;
+    TestStatus status = TEST_PASSED;
+    // The first line where the output differs from the expected one, 1 based
+    size_t differingLine = 0;
+    string expectedLine;
+    string actualLine;
+    double micros = 0;
+};
+
+static int usage(const char *name) {
+    cerr << "usage: " << name << " [--jobs N] [--repeat N] [--baseline file [--update-baseline]] [--tolerance X] "
+                                 "[--min-us N] directory|file.in..." << endl;
+    return 1;
+}
+
+// The expected output of t1.in is t1.out, or t1.in.out in the corpora that name it so, "" if neither exists
+static string expectedOutputPath(const string &test) {
+    error_code error;
+    filesystem::path path(test);
+    filesystem::path replaced = path;
+    replaced.replace_extension(".out");
+    if (filesystem::is_regular_file(replaced, error)) {
+        return replaced.string();
+    }
+    if (filesystem::is_regular_file(test + ".out", error)) {
+        return test + ".out";
+    }
+    return "";
+}
+
+static bool readFile(const string &path, string &text) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return false;
+    }
+    ostringstream contents;
+    contents << in.rdbuf();
+    text = contents.str();
+    return !in.bad();
+}
+
+static string lineAt(const string &text, size_t start) {
+    return text.substr(start, min(text.find('\n', start), text.size()) - start);
+}
+
+// Fills the first line where actual and expected differ
+static void describeDifference(const string &actual, const string &expected, TestResult &result) {
+    size_t line = 1;
+    size_t start = 0;
+    for (size_t i = 0; i < min(actual.size(), expected.size()) && actual[i] == expected[i]; ++i) {
+        if (actual[i] == '\n') {
+            ++line;
+            start = i + 1;
+        }
+    }
+    result.differingLine = line;
+    result.expectedLine = start < expected.size() ? lineAt(expected, start) : "<end of output>";
+    result.actualLine = start < actual.size() ? lineAt(actual, start) : "<end of output>";
+}
+
+// Checks the test repeat times, the output of the first check is the one compared, the output is what "hw3 < test"
+// prints, scope dumps and error line
+static void runTest(const RegressionOptions &options, TestResult &result) {
+    string program;
+    string expected;
+    if (!readFile(result.path, program) || !readFile(result.expectedPath, expected)) {
+        result.status = TEST_UNREADABLE;
+        return;
+    }
+    for (unsigned run = 0; run < options.repeat; ++run) {
+        output::StringSink sink;
+        auto start = chrono::steady_clock::now();
+        check(program.data(), program.size(), sink);
+        double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        if (run == 0) {
+            result.micros = micros;
+            if (sink.text != expected) {
+                result.status = TEST_FAILED;
+                describeDifference(sink.text, expected, result);
+            }
+        } else {
+            result.micros = min(result.micros, micros);
+        }
+    }
+}
+
+// One "microseconds path" line per test
+static bool readBaseline(const string &path, map<string, double> &baseline) {
+    ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    double micros;
+    string test;
+    while (in >> micros >> ws && getline(in, test)) {
+        baseline[test] = micros;
+    }
+    return true;
+}
+
+static bool writeBaseline(const string &path, const vector<TestResult> &results) {
+    ofstream out(path, ios::trunc);
+    char line[64];
+    for (auto &result : results) {
+        if (result.status == TEST_PASSED) {
+            snprintf(line, sizeof(line), "%.1f ", result.micros);
+            out << line << result.path << "\n";
+        }
+    }
+    return bool(out);
+}
+
+int main(int argc, char *argv[]) {
+    RegressionOptions options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc) {
+            options.jobs = (unsigned) atoi(argv[++i]);
+        } else if (arg == "--repeat" && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options.repeat = (unsigned) atoi(argv[++i]);
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        } else if (arg == "--update-baseline") {
+            options.updateBaseline = true;
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = atof(argv[++i]);
+        } else if (arg == "--min-us" && i + 1 < argc) {
+            options.minMicros = atof(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.paths.push_back(arg);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (options.paths.empty() || (options.updateBaseline && options.baselinePath.empty())) {
+        return usage(argv[0]);
+    }
+    unsigned jobs = options.jobs ? options.jobs : thread::hardware_concurrency();
+    if (!jobs) {
+        jobs = 1;
+    }
+
+    // The inputs without an expected output are programs to run by hand, not tests
+    vector<TestResult> results;
+    for (auto &path : collectBatchFiles(options.paths)) {
+        string expectedPath = expectedOutputPath(path);
+        if (!expectedPath.empty()) {
+            results.push_back({path, expectedPath});
+        }
+    }
+    map<string, double> baseline;
+    bool compare = !options.baselinePath.empty() && !options.updateBaseline &&
+                   readBaseline(options.baselinePath, baseline);
+
+    auto start = chrono::steady_clock::now();
+    WorkStealingPool pool(jobs);
+    pool.run(results.size(), [&](size_t task) {
+        runTest(options, results[task]);
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    size_t slower = 0;
+    for (auto &result : results) {
+        char line[512];
+        if (result.status == TEST_UNREADABLE) {
+            ++failed;
+            printf("FAIL               %s: cannot read it or %s\n", result.path.c_str(), result.expectedPath.c_str());
+            continue;
+        }
+        if (result.status == TEST_FAILED) {
+            ++failed;
+            printf("FAIL    %9.3f ms  %s: line %zu differs\n", result.micros / 1000, result.path.c_str(),
+                   result.differingLine);
+            printf("        expected  %s\n        actual    %s\n", result.expectedLine.c_str(),
+                   result.actualLine.c_str());
+            continue;
+        }
+        auto found = baseline.find(result.path);
+        if (compare && found != baseline.end() && result.micros > found->second * (1 + options.tolerance) &&
+            result.micros - found->second > options.minMicros) {
+            ++slower;
+            snprintf(line, sizeof(line), "SLOWER  %9.3f ms  %s  (baseline %.3f ms, %+.0f%%)", result.micros / 1000,
+                     result.path.c_str(), found->second / 1000, (result.micros / found->second - 1) * 100);
+        } else {
+            snprintf(line, sizeof(line), "ok      %9.3f ms  %s", result.micros / 1000, result.path.c_str());
+        }
+        printf("%s\n", line);
+    }
+    printf("%zu tests: %zu passed, %zu failed, %zu slower than the baseline, in %.3f s with %u jobs\n",
+           results.size(), results.size() - failed, failed, slower, seconds, jobs);
+
+    if (!options.baselinePath.empty() && (options.updateBaseline || !compare)) {
+        if (!writeBaseline(options.baselinePath, results)) {
+            cerr << "cannot write " << options.baselinePath << endl;
+            return 1;
+        }
+        printf("baseline of %zu tests written to %s\n", results.size() - failed, options.baselinePath.c_str());
+    }
+    return failed || slower ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+//
+// The baseline of the VM benchmark, runs a checked program straight from its syntax tree
+//
+
+#include "TreeWalker.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How a statement ended
+enum Completion {
+    COMPLETION_NORMAL,
+    COMPLETION_BREAK,
+    COMPLETION_CONTINUE,
+    COMPLETION_RETURN
+};
+
+class DivisionByZero {
+};
+
+class TreeWalker {
+public:
+    TreeWalker(const Ast &ast, output::Sink &sink) : ast(ast), sink(sink) {
+
+    }
+
+    void run() {
+        for (AstId func = ast.firstChild[ast.root]; func != NO_NODE; func = ast.nextSibling[func]) {
+            if (ast.names.get(ast.name[func]) == "main") {
+                call(func, {});
+                return;
+            }
+        }
+    }
+
+private:
+    // The variables of one call, by offset, the parameters have negative offsets
+    class Frame {
+    public:
+        vector<int32_t> params;
+        vector<int32_t> locals;
+        int32_t returned = 0;
+
+        int32_t &at(int32_t offset) {
+            if (offset < 0) {
+                return params[-offset - 1];
+            }
+            if (size_t(offset) >= locals.size()) {
+                locals.resize(offset + 1);
+            }
+            return locals[offset];
+        }
+    };
+
+    const Ast &ast;
+    output::Sink &sink;
+    Frame *frame = nullptr;
+
+    int32_t call(AstId func, vector<int32_t> args) {
+        Frame callee;
+        callee.params = std::move(args);
+        Frame *caller = frame;
+        frame = &callee;
+        for (AstId child = ast.firstChild[func]; child != NO_NODE; child = ast.nextSibling[child]) {
+            if (ast.kind[child] != AST_FORMAL && statement(child) == COMPLETION_RETURN) {
+                break;
+            }
+        }
+        frame = caller;
+        return callee.returned;
+    }
+
+    Completion statements(AstId first) {
+        for (AstId child = first; child != NO_NODE; child = ast.nextSibling[child]) {
+            Completion completion = statement(child);
+            if (completion != COMPLETION_NORMAL) {
+                return completion;
+            }
+        }
+        return COMPLETION_NORMAL;
+    }
+
+    void store(int32_t offset, TypeId targetType, AstId value) {
+        int32_t result = evaluate(value);
+        frame->at(offset) = targetType == TYPE_BYTE ? result & 0xff : result;
+    }
+
+    Completion statement(AstId node) {
+        AstId first = ast.firstChild[node];
+        switch (ast.kind[node]) {
+            case AST_BLOCK:
+                return statements(first);
+            case AST_DECL:
+                if (first == NO_NODE) {
+                    frame->at(ast.value[node]) = 0;
+                } else {
+                    store(ast.value[node], ast.type[node], first);
+                }
+                return COMPLETION_NORMAL;
+            case AST_ASSIGN:
+                store(ast.value[ast.ref[node]], ast.type[node], first);
+                return COMPLETION_NORMAL;
+            case AST_RETURN:
+                frame->returned = first == NO_NODE ? 0 : evaluate(first);
+                return COMPLETION_RETURN;
+            case AST_CALL:
+                evaluate(node);
+                return COMPLETION_NORMAL;
+            case AST_IF: {
+                AstId thenStatement = ast.nextSibling[first];
+                if (evaluate(first)) {
+                    return statement(thenStatement);
+                }
+                AstId elseStatement = ast.nextSibling[thenStatement];
+                return elseStatement == NO_NODE ? COMPLETION_NORMAL : statement(elseStatement);
+            }
+            case AST_WHILE:
+                while (evaluate(first)) {
+                    Completion completion = statement(ast.nextSibling[first]);
+                    if (completion == COMPLETION_BREAK) {
+                        break;
+                    } else if (completion == COMPLETION_RETURN) {
+                        return completion;
+                    }
+                }
+                return COMPLETION_NORMAL;
+            case AST_SWITCH: {
+                int32_t value = evaluate(first);
+                AstId start = NO_NODE;
+                for (AstId child = ast.nextSibling[first]; child != NO_NODE; child = ast.nextSibling[child]) {
+                    if (ast.kind[child] == AST_DEFAULT || ast.value[child] == value) {
+                        start = child;
+                        break;
+                    }
+                }
+                // Falls through the cases after the one that matched
+                for (AstId child = start; child != NO_NODE; child = ast.nextSibling[child]) {
+                    Completion completion = statements(ast.firstChild[child]);
+                    if (completion == COMPLETION_BREAK) {
+                        break;
+                    } else if (completion != COMPLETION_NORMAL) {
+                        return completion;
+                    }
+                }
+                return COMPLETION_NORMAL;
+            }
+            case AST_BREAK:
+                return COMPLETION_BREAK;
+            case AST_CONTINUE:
+                return COMPLETION_CONTINUE;
+            default:
+                return COMPLETION_NORMAL;
+        }
+    }
+
+    int32_t evaluate(AstId node) {
+        AstId first = ast.firstChild[node];
+        switch (ast.kind[node]) {
+            case AST_ID:
+                return frame->at(ast.value[ast.ref[node]]);
+            case AST_LITERAL:
+                return ast.value[node];
+            case AST_NOT:
+                return !evaluate(first);
+            case AST_AND:
+                return evaluate(first) ? evaluate(ast.nextSibling[first]) : 0;
+            case AST_OR:
+                return evaluate(first) ? 1 : evaluate(ast.nextSibling[first]);
+            case AST_BINARY: {
+                int32_t result = arithmetic(ast.op[node], evaluate(first), evaluate(ast.nextSibling[first]));
+                return ast.type[node] == TYPE_BYTE ? result & 0xff : result;
+            }
+            case AST_CALL: {
+                vector<int32_t> args;
+                for (AstId arg = first; arg != NO_NODE; arg = ast.nextSibling[arg]) {
+                    args.push_back(evaluate(arg));
+                }
+                if (ast.ref[node] != NO_NODE) {
+                    return call(ast.ref[node], std::move(args));
+                }
+                string text;
+                if (ast.names.get(ast.name[node]) == "print") {
+                    const string &literal = ast.strings[args[0]];
+                    text = literal.substr(1, literal.size() - 2);
+                } else {
+                    text = to_string(args[0]);
+                }
+                text += "\n";
+                sink.write(text);
+                return 0;
+            }
+            default:
+                return 0;
+        }
+    }
+
+    int32_t arithmetic(AstOp op, int32_t left, int32_t right) {
+        int64_t wide;
+        switch (op) {
+            case OP_ADD:
+                wide = int64_t(left) + right;
+                break;
+            case OP_SUB:
+                wide = int64_t(left) - right;
+                break;
+            case OP_MUL:
+                wide = int64_t(left) * right;
+                break;
+            case OP_DIV:
+                if (right == 0) {
+                    throw DivisionByZero();
+                }
+                wide = int64_t(left) / right;
+                break;
+            case OP_EQ:
+                return left == right;
+            case OP_NE:
+                return left != right;
+            case OP_LT:
+                return left < right;
+            case OP_GT:
+                return left > right;
+            case OP_LE:
+                return left <= right;
+            default:
+                return left >= right;
+        }
+        return int32_t(uint32_t(uint64_t(wide)));
+    }
+};
+
+bool walkProgram(const Ast &ast, output::Sink &sink) {
+    try {
+        TreeWalker(ast, sink).run();
+    } catch (const DivisionByZero &) {
+        sink.write("Error division by zero\n");
+        return false;
+    }
+    return true;
+}
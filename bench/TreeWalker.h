@@ -0,0 +1,18 @@
+//
+// The baseline of the VM benchmark, runs a checked program straight from its syntax tree
+//
+
+#ifndef HW3_TREE_WALKER_H
+#define HW3_TREE_WALKER_H
+
+#include "Ast.h"
+#include "hw3_output.hpp"
+
+using namespace std;
+
+// Evaluates the tree recursively, node by node, with a heap allocated frame for each call
+// It computes exactly what the VM computes, the benchmark compares their outputs
+// Returns false if the program divided by zero
+bool walkProgram(const Ast &ast, output::Sink &sink);
+
+#endif //HW3_TREE_WALKER_H
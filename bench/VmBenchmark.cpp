@@ -0,0 +1,233 @@
+//
+// Runs the same programs with the bytecode VM and with a tree walker, and reports both times as JSON
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Checker.h"
+#include "Vm.h"
+#include "TreeWalker.h"
+
+using namespace std;
+
+// A workload is a program with a size, the first N of its text is replaced by the size
+// The sizes make each run take a few hundred milliseconds with the VM
+class Workload {
+public:
+    const char *name;
+    const char *text;
+    long size;
+};
+
+static const Workload WORKLOADS[] = {
+        // Calls and returns
+        {"fib", R"(int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+void main() {
+    printi(fib(N));
+}
+)", 30},
+        // Nested loops, a switch, byte arithmetic
+        {"loops", R"(void main() {
+    int i = 0;
+    int total = 0;
+    byte small = 0 b;
+    while (i < N) {
+        int j = 0;
+        while (j < 100) {
+            switch (j / 10) {
+                case 0: total = total + j; break;
+                case 1: total = total - 1;
+                case 2: total = total + 3; break;
+                default: small = small + 7 b;
+            }
+            j = j + 1;
+            if (j == 50) continue;
+        }
+        i = i + 1;
+    }
+    printi(total);
+    printi(small);
+}
+)", 40000},
+        // Short circuit conditions and a call per iteration
+        {"collatz", R"(int steps(int n) {
+    int count = 0;
+    while (n != 1 and count < 1000) {
+        if (n / 2 * 2 == n) n = n / 2; else n = 3 * n + 1;
+        count = count + 1;
+    }
+    return count;
+}
+void main() {
+    int i = 1;
+    int total = 0;
+    while (i < N) {
+        total = total + steps(i);
+        i = i + 1;
+    }
+    printi(total);
+}
+)", 50000},
+};
+
+class BenchmarkOptions {
+public:
+    // The best of this many runs is reported
+    unsigned repeat = 3;
+    // Multiplies every size
+    double scale = 1;
+    vector<string> workloads;
+    // Writes the JSON report there instead of stdout
+    string outputPath;
+};
+
+class WorkloadResult {
+public:
+    string name;
+    long size = 0;
+    double compileSeconds = 0;
+    double vmSeconds = 0;
+    double walkSeconds = 0;
+    // The VM and the tree walker printed the same thing
+    bool same = false;
+};
+
+static int usage(const char *name) {
+    cerr << "usage: " << name << " [--repeat N] [--scale X] [--workload name]... [--output file]" << endl;
+    cerr << "workloads:";
+    for (const Workload &workload : WORKLOADS) {
+        cerr << " " << workload.name;
+    }
+    cerr << endl;
+    return 1;
+}
+
+static bool workloadByName(const string &name) {
+    for (const Workload &workload : WORKLOADS) {
+        if (name == workload.name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Times fn, the best of repeat runs
+template<typename Run>
+static double bestOf(unsigned repeat, Run run) {
+    double best = 0;
+    for (unsigned i = 0; i < repeat; ++i) {
+        auto start = chrono::steady_clock::now();
+        run();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+static bool runWorkload(const Workload &workload, const BenchmarkOptions &options, WorkloadResult &result) {
+    result.name = workload.name;
+    result.size = max(1L, long(workload.size * options.scale));
+    string program = workload.text;
+    program.replace(program.find('N'), 1, to_string(result.size));
+
+    output::NullSink checkSink;
+    Ast ast;
+    if (!check(program.data(), program.size(), checkSink, ast).ok) {
+        return false;
+    }
+    Module module;
+    result.compileSeconds = bestOf(options.repeat, [&] {
+        module = compileProgram(ast);
+    });
+    output::StringSink vmOutput;
+    output::StringSink walkOutput;
+    result.vmSeconds = bestOf(options.repeat, [&] {
+        vmOutput.text.clear();
+        runProgram(module, vmOutput);
+    });
+    result.walkSeconds = bestOf(options.repeat, [&] {
+        walkOutput.text.clear();
+        walkProgram(ast, walkOutput);
+    });
+    result.same = vmOutput.text == walkOutput.text;
+    return true;
+}
+
+static void writeReport(FILE *out, const BenchmarkOptions &options, const vector<WorkloadResult> &results) {
+    fprintf(out, "{\n  \"repeat\": %u,\n  \"workloads\": [", options.repeat);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const WorkloadResult &result = results[i];
+        fprintf(out, "%s\n    {\"name\": \"%s\", \"size\": %ld, \"compileSeconds\": %.6f, \"vmSeconds\": %.6f, "
+                     "\"walkSeconds\": %.6f, \"speedup\": %.2f, \"sameOutput\": %s}",
+                i ? "," : "", result.name.c_str(), result.size, result.compileSeconds, result.vmSeconds,
+                result.walkSeconds, result.vmSeconds > 0 ? result.walkSeconds / result.vmSeconds : 0.0,
+                result.same ? "true" : "false");
+    }
+    fprintf(out, "\n  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = (unsigned) atoi(argv[++i]);
+        } else if (arg == "--scale" && i + 1 < argc) {
+            options.scale = atof(argv[++i]);
+        } else if (arg == "--workload" && i + 1 < argc && workloadByName(argv[i + 1])) {
+            options.workloads.emplace_back(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.outputPath = argv[++i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!options.repeat || options.scale <= 0) {
+        return usage(argv[0]);
+    }
+
+    vector<WorkloadResult> results;
+    bool failed = false;
+    for (const Workload &workload : WORKLOADS) {
+        if (!options.workloads.empty() &&
+            find(options.workloads.begin(), options.workloads.end(), workload.name) == options.workloads.end()) {
+            continue;
+        }
+        WorkloadResult result;
+        if (!runWorkload(workload, options, result)) {
+            cerr << workload.name << ": the program does not pass the check" << endl;
+            return 1;
+        }
+        // Progress goes to stderr, so that stdout is only the report
+        fprintf(stderr, "%-8s %8ld  vm %9.3f ms  tree %9.3f ms  x%.2f%s\n", result.name.c_str(), result.size,
+                result.vmSeconds * 1000, result.walkSeconds * 1000,
+                result.vmSeconds > 0 ? result.walkSeconds / result.vmSeconds : 0.0,
+                result.same ? "" : "  different output");
+        failed = failed || !result.same;
+        results.push_back(result);
+    }
+
+    FILE *out = options.outputPath.empty() ? stdout : fopen(options.outputPath.c_str(), "w");
+    if (!out) {
+        cerr << "cannot write " << options.outputPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    writeReport(out, options, results);
+    if (out != stdout) {
+        fclose(out);
+    }
+    // The two must agree, a difference is a bug in the compiler, the VM or the tree walker
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#!/bin/bash
+
+# Checks that long lists keep the parser stacks at their initial size, and that deep nesting is either accepted or
+# reported as too deep, without the memory of the check growing with the nesting
+# Usage: ./depth_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+status=0
+
+fail() {
+    echo "$1"
+    status=1
+}
+
+# The value of a line of hw3 --stats, the stats are printed to stderr
+stat() {
+    grep "^$2 " "$1" | sed "s/^$2 *//"
+}
+
+# A function with $1 parameters called with $1 arguments, a switch with $1 cases, $1 statements and $1 functions
+lists() {
+    awk -v n="$1" 'BEGIN {
+        for (i = 0; i < n; i++) printf "void f%d() { return; }\n", i;
+        printf "int wide(";
+        for (i = 0; i < n; i++) printf "%sint p%d", (i ? ", " : ""), i;
+        printf ") { return p%d; }\n", n - 1;
+        printf "void main() {\n    int x = 0;\n";
+        for (i = 0; i < n; i++) printf "    x = x + 1;\n";
+        printf "    switch (x) {\n";
+        for (i = 0; i < n; i++) printf "        case %d: f%d();\n", i, i;
+        printf "    }\n    printi(wide(";
+        for (i = 0; i < n; i++) printf "%s%d", (i ? ", " : ""), i;
+        printf "));\n}\n";
+    }'
+}
+
+# $1 nested blocks, then $1 nested parentheses, each level on its own line
+nesting() {
+    awk -v n="$1" 'BEGIN {
+        printf "void main() {\n    int a = 1;\n";
+        for (i = 0; i < n; i++) printf "{\n";
+        printf "printi(";
+        for (i = 0; i < n; i++) printf "(\n";
+        printf "a";
+        for (i = 0; i < n; i++) printf " + a)";
+        printf ");\n";
+        for (i = 0; i < n; i++) printf "}";
+        printf "\n}\n";
+    }'
+}
+
+# Long lists: the stacks never grow, whatever the length
+lists 100000 > "$tmpdir/lists.in"
+if ! "$hw3" --quiet --stats "$tmpdir/lists.in" 2> "$tmpdir/lists.stats"; then
+    fail "lists n=100000: rejected"
+    cat "$tmpdir/lists.stats"
+fi
+depth=$(stat "$tmpdir/lists.stats" "parser stack")
+echo "lists n=100000: parser stack $depth, peak rss $(stat "$tmpdir/lists.stats" "peak rss")"
+if [ "$depth" != "initial" ]; then
+    fail "lists n=100000: the parser stacks grew to $depth"
+fi
+if [ "$("$hw3" --run "$tmpdir/lists.in")" != "99999" ]; then
+    fail "lists n=100000: --run printed something else than 99999"
+fi
+
+# Nesting below the default limit is accepted, and every backend handles it
+nesting 10000 > "$tmpdir/nesting.in"
+if ! "$hw3" --quiet --stats "$tmpdir/nesting.in" 2> "$tmpdir/nesting.stats"; then
+    fail "10000 levels: rejected"
+    cat "$tmpdir/nesting.stats"
+fi
+echo "10000 levels: parser stack $(stat "$tmpdir/nesting.stats" "parser stack")"
+if [ "$("$hw3" --run "$tmpdir/nesting.in")" != "10001" ]; then
+    fail "10000 levels: --run printed something else than 10001"
+fi
+for mode in --ast --bytecode --emit-llvm; do
+    if ! "$hw3" $mode "$tmpdir/nesting.in" > /dev/null; then
+        fail "10000 levels: $mode failed"
+    fi
+done
+
+# Past the limit the program is reported as too deep on the line it was at, for the check and for the backends
+# The blocks take 2 entries a level, so 2000 entries run out about a thousand lines in
+expected="line 996: program nested too deeply (parser depth limit 2000)"
+for mode in --quiet --run; do
+    "$hw3" $mode --max-depth 2000 "$tmpdir/nesting.in" > /dev/null 2> "$tmpdir/too-deep.err"
+    if [ "$(cat "$tmpdir/too-deep.err")" != "$expected" ]; then
+        fail "--max-depth 2000 $mode: expected '$expected', got '$(cat "$tmpdir/too-deep.err")'"
+    fi
+done
+printf 'void main() {\n' > "$tmpdir/graded.in"
+head -c 3000 /dev/zero | tr '\0' '{' >> "$tmpdir/graded.in"
+"$hw3" --max-depth 2000 < "$tmpdir/graded.in" > "$tmpdir/graded.out"
+if [ "$(tail -n 1 "$tmpdir/graded.out")" != "line 2: program nested too deeply (parser depth limit 2000)" ]; then
+    fail "graded output: expected the too deep diagnostic, got '$(tail -n 1 "$tmpdir/graded.out")'"
+fi
+
+# Far past the default limit the check stops at the limit, its memory does not grow with the nesting
+printf 'void main() {\n' > "$tmpdir/deep.in"
+head -c 1000000 /dev/zero | tr '\0' '{' >> "$tmpdir/deep.in"
+if "$hw3" --quiet --stats "$tmpdir/deep.in" 2> "$tmpdir/deep.stats"; then
+    fail "1000000 levels: accepted"
+fi
+if ! grep -q "^line 2: program nested too deeply (parser depth limit 100000)$" "$tmpdir/deep.stats"; then
+    fail "1000000 levels: no too deep diagnostic"
+fi
+rss=$(stat "$tmpdir/deep.stats" "peak rss" | sed 's/ KB//')
+echo "1000000 levels: parser stack $(stat "$tmpdir/deep.stats" "parser stack"), peak rss $rss KB"
+# The program text, its tokens for --stats and the stacks, far below what a scope for each level would take
+if [ "$rss" -gt $((32 * 1024)) ]; then
+    fail "1000000 levels: peak rss ${rss} KB"
+fi
+
+# The backends get a stack for the depth of the tree, not for the limit, and a stack that cannot be created is an
+# error, never a crash on the stack of the main thread
+awk 'BEGIN {
+    printf "void main() {\n    int a = 1;\n    printi(";
+    for (i = 0; i < 200000; i++) printf "(a + ";
+    printf "a";
+    for (i = 0; i < 200000; i++) printf ")";
+    printf ");\n}\n";
+}' > "$tmpdir/expression.in"
+for mode in --run --emit-llvm; do
+    if ! "$hw3" $mode --max-depth 100000000000 "$tmpdir/expression.in" > "$tmpdir/expression.out"; then
+        fail "200000 nested operators, $mode: failed"
+    fi
+done
+if [ "$("$hw3" --run --max-depth 100000000000 "$tmpdir/expression.in")" != "200001" ]; then
+    fail "200000 nested operators: --run printed something else than 200001"
+fi
+if (ulimit -v 500000; ! "$hw3" --run "$tmpdir/nesting.in" > /dev/null); then
+    fail "10000 levels: --run needs more than 500 MB of address space"
+fi
+(ulimit -v 500000; "$hw3" --run --max-depth 100000000000 "$tmpdir/expression.in" > /dev/null 2> "$tmpdir/stack.err")
+code=$?
+if [ $code != 1 ] || ! grep -q "^cannot create a stack of [0-9]* MB for the backend" "$tmpdir/stack.err"; then
+    fail "200000 nested operators in 500 MB: expected exit 1 and the stack error, got $code: $(cat "$tmpdir/stack.err")"
+fi
+
+# A file the scanner cannot take is rejected before it is read, a sparse file costs no disk
+if truncate -s 2147483648 "$tmpdir/large.in" 2> /dev/null; then
+    timeout 20 "$hw3" "$tmpdir/large.in" > "$tmpdir/large.out" 2>&1
+    if ! grep -q "^Program of 2147483648 bytes is too large (scanner limit 2147483645 bytes)$" "$tmpdir/large.out"; then
+        fail "2 GB file: expected the too large diagnostic, got: $(head -c 200 "$tmpdir/large.out")"
+    fi
+fi
+
+exit $status
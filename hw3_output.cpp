@@ -1,15 +1,74 @@
 #include <iostream>
 #include "hw3_output.hpp"
 #include <sstream>
+#include <cstdio>
 
 using namespace std;
 
-void output::endScope(){
-    cout << "---end scope---" << endl;
+void output::Sink::diagnostic(const char* data, size_t size) {
+    write(data, size);
+    flush();
 }
 
-void output::printID(const string& id, int offset, const string& type) {
-    cout << id << " " << type <<  " " << offset <<  endl;
+void output::Sink::flush() {
+}
+
+void output::Sink::write(const string& text) {
+    write(text.data(), text.size());
+}
+
+output::StdoutSink::StdoutSink() {
+    buffer.reserve(BUFFER_SIZE);
+}
+
+output::StdoutSink::~StdoutSink() {
+    flush();
+}
+
+void output::StdoutSink::write(const char* data, size_t size) {
+    if (buffer.size() + size > BUFFER_SIZE) {
+        flush();
+    }
+    buffer.append(data, size);
+}
+
+void output::StdoutSink::flush() {
+    if (!buffer.empty()) {
+        fwrite(buffer.data(), 1, buffer.size(), stdout);
+        buffer.clear();
+    }
+    fflush(stdout);
+}
+
+void output::StringSink::write(const char* data, size_t size) {
+    text.append(data, size);
+}
+
+void output::NullSink::write(const char* data, size_t size) {
+}
+
+void output::NullSink::diagnostic(const char* data, size_t size) {
+    if (firstDiagnostic.empty()) {
+        firstDiagnostic.assign(data, size);
+        fwrite(data, 1, size, stderr);
+    }
+}
+
+static void diagnosticLine(output::Sink& sink, const string& line) {
+    string text = line + "\n";
+    sink.diagnostic(text.data(), text.size());
+}
+
+void output::endScope(Sink& sink){
+    sink.write("---end scope---\n", 16);
+}
+
+size_t output::printID(Sink& sink, string_view id, int offset, const string& type) {
+    string line;
+    line.reserve(id.size() + type.size() + 16);
+    line.append(id).append(" ").append(type).append(" ").append(to_string(offset)).append("\n");
+    sink.write(line);
+    return line.size();
 }
 
 string typeListToString(const std::vector<string>& argTypes) {
@@ -42,46 +101,56 @@ string output::makeFunctionType(const string& retType, std::vector<string>& argT
     return res.str();
 }
 
-void output::errorLex(int lineno){
-    cout << "line " << lineno << ":" << " lexical error" << endl;
+void output::errorLex(Sink& sink, int lineno){
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " lexical error");
+}
+
+void output::errorSyn(Sink& sink, int lineno){
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " syntax error");
+}
+
+void output::errorUndef(Sink& sink, int lineno, string_view id){
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " variable " + string(id) + " is not defined");
 }
 
-void output::errorSyn(int lineno){
-    cout << "line " << lineno << ":" << " syntax error" << endl;
+void output::errorDef(Sink& sink, int lineno, string_view id){
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " identifier " + string(id) + " is already defined");
 }
 
-void output::errorUndef(int lineno, const string& id){
-    cout << "line " << lineno << ":" << " variable " << id << " is not defined" << endl;
+void output::errorUndefFunc(Sink& sink, int lineno, string_view id) {
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " function " + string(id) + " is not defined");
 }
 
-void output::errorDef(int lineno, const string& id){
-    cout << "line " << lineno << ":" << " identifier " << id << " is already defined" << endl;
+void output::errorMismatch(Sink& sink, int lineno){
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " type mismatch");
 }
 
-void output::errorUndefFunc(int lineno, const string& id) {
-    cout << "line " << lineno << ":" << " function " << id << " is not defined" << endl;
+void output::errorPrototypeMismatch(Sink& sink, int lineno, string_view id, std::vector<string>& argTypes) {
+    diagnosticLine(sink, "line " + to_string(lineno) + ": prototype mismatch, function " + string(id) + " expects arguments " + typeListToString(argTypes));
 }
 
-void output::errorMismatch(int lineno){
-    cout << "line " << lineno << ":" << " type mismatch" << endl;
+void output::errorUnexpectedBreak(Sink& sink, int lineno) {
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " unexpected break statement");
 }
 
-void output::errorPrototypeMismatch(int lineno, const string& id, std::vector<string>& argTypes) {
-    cout << "line " << lineno << ": prototype mismatch, function " << id << " expects arguments " << typeListToString(argTypes) << endl;
+void output::errorUnexpectedContinue(Sink& sink, int lineno) {
+    diagnosticLine(sink, "line " + to_string(lineno) + ":" + " unexpected continue statement");
 }
 
-void output::errorUnexpectedBreak(int lineno) {
-    cout << "line " << lineno << ":" << " unexpected break statement" << endl;
+void output::errorMainMissing(Sink& sink) {
+    diagnosticLine(sink, "Program has no 'void main()' function");
 }
 
-void output::errorUnexpectedContinue(int lineno) {
-    cout << "line " << lineno << ":" << " unexpected continue statement" << endl;	
+void output::errorByteTooLarge(Sink& sink, int lineno, string_view value) {
+    diagnosticLine(sink, "line " + to_string(lineno) + ": byte value " + string(value) + " out of range");
 }
 
-void output::errorMainMissing() {
-    cout << "Program has no 'void main()' function" << endl;
+void output::errorTooDeep(Sink& sink, int lineno, size_t limit) {
+    diagnosticLine(sink, "line " + to_string(lineno) + ": program nested too deeply (parser depth limit " +
+                         to_string(limit) + ")");
 }
 
-void output::errorByteTooLarge(int lineno, const string& value) {
-    cout << "line " << lineno << ": byte value " << value << " out of range" << endl;
+void output::errorTooLarge(Sink& sink, size_t size, size_t limit) {
+    diagnosticLine(sink, "Program of " + to_string(size) + " bytes is too large (scanner limit " + to_string(limit) +
+                         " bytes)");
 }
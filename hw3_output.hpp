@@ -3,28 +3,80 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 using namespace std;
 
 namespace output{
-    void endScope();
-    void printID(const string& id, int offset, const string& type);
+    // Everything printed by the functions below goes through the sink they are given
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+
+        // Scope dump lines
+        virtual void write(const char* data, size_t size) = 0;
+        // Error lines, nothing is printed after one of them
+        virtual void diagnostic(const char* data, size_t size);
+        virtual void flush();
+
+        void write(const string& text);
+    };
+
+    // The default sink, keeps everything in a large buffer and writes it to stdout only when the buffer fills up,
+    // on error, or when the program exits
+    class StdoutSink : public Sink {
+    public:
+        static const size_t BUFFER_SIZE = 1 << 20;
+
+        StdoutSink();
+        ~StdoutSink() override;
+
+        void write(const char* data, size_t size) override;
+        void flush() override;
+
+    private:
+        string buffer;
+    };
+
+    // Keeps everything in memory, for embedding the checker
+    class StringSink : public Sink {
+    public:
+        string text;
+
+        void write(const char* data, size_t size) override;
+    };
+
+    // Drops the scope dumps, only the first diagnostic is kept and written to stderr
+    // For runs that only need to know if the program is valid
+    class NullSink : public Sink {
+    public:
+        string firstDiagnostic;
+
+        void write(const char* data, size_t size) override;
+        void diagnostic(const char* data, size_t size) override;
+    };
+
+    void endScope(Sink& sink);
+    // Returns the number of bytes written
+    size_t printID(Sink& sink, string_view id, int offset, const string& type);
 
     /* Do not save the string returned from this function in a data structure
         as it is not dynamically allocated and will be destroyed(!) at the end of the calling scope.
     */
     string makeFunctionType(const string& retType, vector<string>& argTypes);
 
-    void errorLex(int lineno);
-    void errorSyn(int lineno);
-    void errorUndef(int lineno, const string& id);
-    void errorDef(int lineno, const string& id);
-    void errorUndefFunc(int lineno, const string& id);
-    void errorMismatch(int lineno);
-    void errorPrototypeMismatch(int lineno, const string& id, vector<string>& argTypes);
-    void errorUnexpectedBreak(int lineno);
-    void errorUnexpectedContinue(int lineno);
-    void errorMainMissing();
-    void errorByteTooLarge(int lineno, const string& value);
+    void errorLex(Sink& sink, int lineno);
+    void errorSyn(Sink& sink, int lineno);
+    void errorUndef(Sink& sink, int lineno, string_view id);
+    void errorDef(Sink& sink, int lineno, string_view id);
+    void errorUndefFunc(Sink& sink, int lineno, string_view id);
+    void errorMismatch(Sink& sink, int lineno);
+    void errorPrototypeMismatch(Sink& sink, int lineno, string_view id, vector<string>& argTypes);
+    void errorUnexpectedBreak(Sink& sink, int lineno);
+    void errorUnexpectedContinue(Sink& sink, int lineno);
+    void errorMainMissing(Sink& sink);
+    void errorByteTooLarge(Sink& sink, int lineno, string_view value);
+    void errorTooDeep(Sink& sink, int lineno, size_t limit);
+    void errorTooLarge(Sink& sink, size_t size, size_t limit);
 }
 
 #endif
@@ -0,0 +1,54 @@
+#!/bin/bash
+
+# Checks that replaying functions from the cache prints exactly what a full check prints
+# Usage: ./incremental_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+status=0
+# Compares a cached check of $1 with a full check, the cache is shared by every call
+compare() {
+    "$hw3" < "$1" > "$tmpdir/full"
+    "$hw3" --cache "$tmpdir/cache" "$1" > "$tmpdir/cached"
+    if ! cmp -s "$tmpdir/full" "$tmpdir/cached"; then
+        echo "$2: cached output differs from a full check"
+        diff "$tmpdir/full" "$tmpdir/cached" | head -5
+        status=1
+    fi
+}
+
+# $2 functions, each one calling the one before it, f$3 returns $4 instead of its parameter
+generate() {
+    awk -v n="$2" -v edited="$3" -v value="$4" 'BEGIN {
+        printf "int f0(int p) {\n    return p;\n}\n";
+        for (i = 1; i < n; i++) {
+            printf "// function %d\nint f%d(int p) {\n    int x = f%d(p);\n", i, i, i - 1;
+            printf "    if (x > 3) {\n        x = x - 1;\n    }\n";
+            printf "    return %s;\n}\n", (i == edited ? value : "x");
+        }
+        printf "void main() {\n    printi(f%d(1));\n}\n", n - 1;
+    }' > "$1"
+}
+
+for pass in cold warm; do
+    for f in hw3-tests/*.in tests/*.in; do
+        compare "$f" "$pass $f"
+    done
+done
+
+generate "$tmpdir/p.in" 400 -1 x
+compare "$tmpdir/p.in" "400 functions, cold"
+compare "$tmpdir/p.in" "400 functions, warm"
+# The edited function and the ones after it are checked again, the line numbers of the ones after it are unchanged
+generate "$tmpdir/p.in" 400 200 "x + 1"
+compare "$tmpdir/p.in" "400 functions, one body edited"
+# An error in the middle, reported with its line in the whole program
+generate "$tmpdir/p.in" 400 200 "true"
+compare "$tmpdir/p.in" "400 functions, type error"
+# Everything after an inserted line moves down, the cached diagnostic moves with it
+(echo; cat "$tmpdir/p.in") > "$tmpdir/q.in"
+compare "$tmpdir/q.in" "400 functions, type error one line down"
+
+exit $status
@@ -0,0 +1,114 @@
+#!/bin/bash
+
+# Checks the IR of --emit-llvm with the LLVM tools, when they are installed
+# Every valid program of the tests must assemble, and lli must print what --run prints
+# Usage: ./llvm_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+if ! command -v llvm-as > /dev/null || ! command -v lli > /dev/null; then
+    echo "llvm-as and lli not found, skipped"
+    exit 0
+fi
+# The IR uses opaque pointers, LLVM 14 only reads them with a flag
+flags=()
+if [ "$(lli --version | sed -n 's/.*LLVM version \([0-9]*\).*/\1/p')" -lt 15 ]; then
+    flags=(-opaque-pointers)
+fi
+
+status=0
+for f in hw3-tests/*.in tests/*.in; do
+    if "$hw3" --emit-llvm < "$f" > "$tmpdir/p.ll" 2> /dev/null &&
+       ! llvm-as "${flags[@]}" "$tmpdir/p.ll" -o /dev/null 2> "$tmpdir/error"; then
+        echo "$f: invalid IR"
+        head -3 "$tmpdir/error"
+        status=1
+    fi
+done
+
+# Compares the output of the IR run by lli with the output of --run
+compare() {
+    "$hw3" --emit-llvm < "$1" > "$tmpdir/p.ll"
+    lli "${flags[@]}" "$tmpdir/p.ll" > "$tmpdir/native" 2>&1
+    "$hw3" --run < "$1" > "$tmpdir/vm" 2>&1
+    if ! cmp -s "$tmpdir/native" "$tmpdir/vm"; then
+        echo "$2: lli and --run print different things"
+        diff "$tmpdir/native" "$tmpdir/vm" | head -10
+        status=1
+    fi
+}
+
+# Short circuit, byte and int conversions and wrap around, fall through and repeated labels in a switch,
+# division by zero
+cat > "$tmpdir/p.in" <<'PROGRAM'
+bool loud(bool v) {
+    print("loud");
+    return v;
+}
+int widen(int a, int b2) {
+    return a / b2;
+}
+byte half(byte x) {
+    return x / 2 b;
+}
+void main() {
+    byte x = 250 b;
+    x = x + 10 b;
+    printi(x);
+    x = 300;
+    printi(x);
+    int big = 2147483647;
+    big = big + 1;
+    printi(big);
+    printi(big / (0 - 1));
+    printi(half(255 b) + 1000);
+    if (x < 200 b and 200 b > x) print("bytes compare unsigned");
+    int i = 0;
+    while (i < 10) {
+        i = i + 1;
+        if (i == 3) continue;
+        switch (i) {
+            case 1: print("one");
+            case 2: print("two"); break;
+            case 2: print("never");
+            case 5: break;
+            default: printi(i * 100);
+        }
+        if (i > 7) break;
+    }
+    if (false and loud(true)) print("no");
+    if (true or loud(false)) print("yes");
+    if (loud(true) and not loud(false)) print("both");
+    printi(widen(0 - 7, 2));
+    printi(widen(7, 0));
+    print("unreachable");
+}
+PROGRAM
+compare "$tmpdir/p.in" "semantics"
+
+# A constant left operand of and / or after a return, break or continue, the phi must name the dead block the
+# branch comes from
+cat > "$tmpdir/p.in" <<'PROGRAM'
+void f() {
+    bool q = false;
+    return;
+    q = true and q;
+}
+void main() {
+    f();
+    int i = 0;
+    while (i < 2) {
+        i = i + 1;
+        if (i == 1) continue;
+        bool r = false or i > 1;
+        break;
+        r = true or r;
+    }
+    printi(3);
+}
+PROGRAM
+compare "$tmpdir/p.in" "dead and / or"
+
+exit $status
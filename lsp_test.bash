@@ -0,0 +1,151 @@
+#!/bin/bash
+
+# Drives hw3 --lsp through a session, checks its answers, and that an edit costs a function and not a document
+# Usage: ./lsp_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+status=0
+
+fail() {
+    echo "$1"
+    status=1
+}
+
+# A message with its Content-Length header
+send() {
+    printf 'Content-Length: %d\r\n\r\n%s' "${#1}" "$1"
+}
+
+# A text as the body of a JSON string
+escape() {
+    sed ':a;N;$!ba;s/\\/\\\\/g;s/"/\\"/g;s/\n/\\n/g'
+}
+
+# The messages of the server, one per line without their headers
+messages() {
+    sed 's/}Content-Length/}\nContent-Length/g' | grep -o '{.*'
+}
+
+open() {
+    send '{"jsonrpc":"2.0","method":"textDocument/didOpen","params":{"textDocument":{"uri":"file:///'"$1"'","languageId":"hw3","version":1,"text":"'"$2"'"}}}'
+}
+
+# $1 document, $2 id, $3 method, $4 line, $5 character
+ask() {
+    send '{"jsonrpc":"2.0","id":'"$2"',"method":"textDocument/'"$3"'","params":{"textDocument":{"uri":"file:///'"$1"'"},"position":{"line":'"$4"',"character":'"$5"'}}}'
+}
+
+# $1 document, $2 $3 start line and character, $4 $5 end line and character, $6 new text
+change() {
+    send '{"jsonrpc":"2.0","method":"textDocument/didChange","params":{"textDocument":{"uri":"file:///'"$1"'","version":2},"contentChanges":[{"range":{"start":{"line":'"$2"',"character":'"$3"'},"end":{"line":'"$4"',"character":'"$5"'}},"text":"'"$6"'"}]}}'
+}
+
+finish() {
+    send '{"jsonrpc":"2.0","id":99,"method":"shutdown"}'
+    send '{"jsonrpc":"2.0","method":"exit"}'
+}
+
+cat > "$tmpdir/p.in" <<'PROGRAM'
+int add(int x, byte y) {
+    int z = x + y;
+    return z;
+}
+void main() {
+    int a = add(1, 2 b);
+    if (a > 0) {
+        bool flag = true;
+    }
+    printi(a);
+}
+PROGRAM
+{
+    send '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}'
+    send '{"jsonrpc":"2.0","method":"initialized","params":{}}'
+    open p.hw3 "$(escape < "$tmpdir/p.in")"
+    ask p.hw3 2 hover 5 13
+    ask p.hw3 3 definition 5 13
+    ask p.hw3 4 hover 9 11
+    ask p.hw3 5 definition 1 16
+    ask p.hw3 6 hover 7 14
+    ask p.hw3 7 hover 9 5
+    ask p.hw3 8 definition 9 5
+    # A type error in add, then fixed
+    change p.hw3 2 11 2 12 true
+    change p.hw3 2 11 2 15 z
+    # add is renamed, so main is checked again and calls a function that is not defined, then renamed back
+    change p.hw3 0 4 0 7 sum
+    change p.hw3 0 4 0 7 add
+    # The brace of the if closes main early, what is left does not parse
+    change p.hw3 6 15 6 16 '}\n{'
+    change p.hw3 6 15 7 1 '{'
+    finish
+} > "$tmpdir/session"
+cat > "$tmpdir/expected" <<'MESSAGES'
+{"jsonrpc":"2.0","id":1,"result":{"capabilities":{"textDocumentSync":2,"hoverProvider":true,"definitionProvider":true},"serverInfo":{"name":"hw3"}}}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[]}}
+{"jsonrpc":"2.0","id":2,"result":{"contents":{"kind":"plaintext","value":"add (INT,BYTE)->INT 0"},"range":{"start":{"line":5,"character":12},"end":{"line":5,"character":15}}}}
+{"jsonrpc":"2.0","id":3,"result":{"uri":"file:///p.hw3","range":{"start":{"line":0,"character":4},"end":{"line":0,"character":7}}}}
+{"jsonrpc":"2.0","id":4,"result":{"contents":{"kind":"plaintext","value":"a INT 0"},"range":{"start":{"line":9,"character":11},"end":{"line":9,"character":12}}}}
+{"jsonrpc":"2.0","id":5,"result":{"uri":"file:///p.hw3","range":{"start":{"line":0,"character":20},"end":{"line":0,"character":21}}}}
+{"jsonrpc":"2.0","id":6,"result":{"contents":{"kind":"plaintext","value":"flag BOOL 1"},"range":{"start":{"line":7,"character":13},"end":{"line":7,"character":17}}}}
+{"jsonrpc":"2.0","id":7,"result":{"contents":{"kind":"plaintext","value":"printi (INT)->VOID 0"},"range":{"start":{"line":9,"character":4},"end":{"line":9,"character":10}}}}
+{"jsonrpc":"2.0","id":8,"result":null}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[{"range":{"start":{"line":2,"character":0},"end":{"line":3,"character":0}},"severity":1,"source":"hw3","message":"type mismatch"}]}}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[]}}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[{"range":{"start":{"line":5,"character":0},"end":{"line":6,"character":0}},"severity":1,"source":"hw3","message":"function add is not defined"}]}}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[]}}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[{"range":{"start":{"line":6,"character":0},"end":{"line":7,"character":0}},"severity":1,"source":"hw3","message":"syntax error"}]}}
+{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics","params":{"uri":"file:///p.hw3","diagnostics":[]}}
+{"jsonrpc":"2.0","id":99,"result":null}
+MESSAGES
+if ! "$hw3" --lsp < "$tmpdir/session" 2> /dev/null | messages | diff - "$tmpdir/expected"; then
+    fail "the answers of the small session differ"
+fi
+
+# 5000 functions, 55000 lines, edited all over
+generate() {
+    awk -v edited="$1" 'BEGIN {
+        for (i = 0; i < 5000; i++) {
+            printf "int f%d(int p) {\n    int x = p;\n", i;
+            if (i) printf "    x = f%d(x);\n", i - 1;
+            else printf "    x = x + 1;\n";
+            printf "    while (x > 3) {\n        x = x - 1;\n    }\n    if (x == 2) {\n        return x;\n    }\n";
+            printf "    return %s;\n}\n", (i == edited ? "true" : "x + 1");
+        }
+        printf "void main() {\n    printi(f4999(1));\n}\n";
+    }'
+}
+generate -1 > "$tmpdir/large.in"
+# The type error of f2500, on the line a full check reports
+generate 2500 > "$tmpdir/error.in"
+expected_line=$(( $("$hw3" < "$tmpdir/error.in" | tail -n 1 | sed 's/^line \([0-9]*\):.*/\1/') - 1 ))
+{
+    send '{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}'
+    open large.hw3 "$(escape < "$tmpdir/large.in")"
+    for ((k = 0; k < 200; k++)); do
+        line=$(( (k * 37 % 5000) * 11 + 3 ))
+        change large.hw3 $line 15 $line 16 $(( k % 9 + 1 ))
+        ask large.hw3 $(( k + 10 )) hover $line 11
+    done
+    change large.hw3 $(( 2500 * 11 + 9 )) 11 $(( 2500 * 11 + 9 )) 16 true
+    finish
+} > "$tmpdir/large-session"
+"$hw3" --lsp < "$tmpdir/large-session" 2> "$tmpdir/latency" | messages > "$tmpdir/answers"
+cat "$tmpdir/latency"
+if [ "$(grep -c '"diagnostics":\[\]' "$tmpdir/answers")" != 201 ] ||
+    [ "$(grep -c '"value":"x INT 0"' "$tmpdir/answers")" != 200 ]; then
+    fail "large document: wrong diagnostics or hovers after the body edits"
+fi
+if ! tail -n 2 "$tmpdir/answers" | head -n 1 | grep -q "\"start\":{\"line\":$expected_line,.*\"message\":\"type mismatch\""; then
+    fail "large document: the type error is not reported on line $expected_line"
+fi
+# An edit checks one function, so it costs a small part of opening the document
+open_us=$(awk '$1 == "opens" { print int($4) }' "$tmpdir/latency")
+change_us=$(awk '$1 == "changes" { print int($4) }' "$tmpdir/latency")
+if [ -z "$change_us" ] || [ $(( change_us * 50 )) -ge "$open_us" ]; then
+    fail "large document: a change takes ${change_us}us, opening the document ${open_us}us"
+fi
+
+exit $status
@@ -0,0 +1,360 @@
+//
+// hw3 driver, checks the program read from stdin, or a batch of program files
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <pthread.h>
+#include "Checker.h"
+#include "Batch.h"
+#include "Modules.h"
+#include "Lsp.h"
+#include "Server.h"
+#include "Incremental.h"
+#include "Stats.h"
+#include "Vm.h"
+#include "LlvmEmitter.h"
+#include "Prelude.h"
+
+using namespace std;
+
+static int usage(const char *name) {
+    cerr << "usage: " << name << " [--quiet] [--max-depth N] [--prelude snapshot] [--stats | --cache directory] "
+                                 "[program file] < program" << endl;
+    cerr << "       " << name << " --symbols json|binary [--max-depth N] [--prelude snapshot] [--stats] "
+                                 "[program file] < program" << endl;
+    cerr << "       " << name << " --compile-prelude snapshot [prelude file] < prelude" << endl;
+    cerr << "       " << name << " --ast | --bytecode | --run | --emit-llvm [--max-depth N] [program file] < program"
+         << endl;
+    cerr << "       " << name << " --batch [--jobs N] [--stream] file|directory..." << endl;
+    cerr << "       " << name << " --modules interface-directory [--jobs N] file..." << endl;
+    cerr << "       " << name << " --serve socket [--jobs N] [--queue N]" << endl;
+    cerr << "       " << name << " --connect socket < program" << endl;
+    cerr << "       " << name << " --lsp" << endl;
+    return 1;
+}
+
+// The stack the backends get for each level of the syntax tree, the compiler and the LLVM emitter (the deepest of
+// them) recurse through two frames a level, each below 4 KB in a build without optimizations
+static const size_t BACKEND_STACK_PER_LEVEL = 8192;
+// And for the frames below the walk, the backend itself and the VM
+static const size_t BACKEND_STACK_BASE = 1 << 20;
+
+// Runs work on a thread with a stack of stackBytes and returns what it returns
+// Returns 1 with an error if the thread cannot be created, the stack of this thread is too small for the work
+static int runWithStack(size_t stackBytes, const function<int()> &work) {
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    int failed = pthread_attr_setstacksize(&attributes, max<size_t>(stackBytes, PTHREAD_STACK_MIN));
+    struct Call {
+        const function<int()> &work;
+        int result;
+    } call{work, 0};
+    pthread_t thread;
+    if (!failed) {
+        failed = pthread_create(&thread, &attributes, [](void *argument) -> void * {
+            Call *call = static_cast<Call *>(argument);
+            call->result = call->work();
+            return nullptr;
+        }, &call);
+    }
+    pthread_attr_destroy(&attributes);
+    if (failed) {
+        cerr << "cannot create a stack of " << (stackBytes >> 20) << " MB for the backend: " << strerror(failed)
+             << endl;
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+    return call.result;
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    // --quiet only checks the program, the scope dumps are dropped and the first error (if any) goes to stderr
+    bool quiet = false;
+    // --batch checks the given files (or the .in files of the given directories) instead of stdin
+    bool batch = false;
+    BatchOptions batchOptions;
+    // --modules checks the given files as the modules of one program, keeping their interfaces in a directory
+    bool modules = false;
+    ModuleOptions moduleOptions;
+    // A program file is mapped and scanned in place instead of being read from stdin
+    string inputPath;
+    // --serve stays resident and checks the programs sent to the socket, --connect sends one to it
+    ServeOptions serveOptions;
+    string connectPath;
+    // --cache replays the functions that did not change since the last check from the given directory
+    string cacheDirectory;
+    // --stats prints the time of each phase and the hot-path counters to stderr
+    bool stats = false;
+    // --ast prints the syntax tree of the program instead of the scope dumps
+    bool dumpAst = false;
+    // --bytecode prints the compiled program, --run runs it and prints what it prints instead of the scope dumps
+    bool dumpBytecode = false;
+    bool runCompiled = false;
+    // --emit-llvm prints the program as LLVM IR, for lli or clang
+    bool emitLlvmIr = false;
+    // --max-depth bounds the parser stacks, deeper programs fail with a "nested too deeply" diagnostic
+    // --symbols writes the closed scopes as JSON lines or binary records instead of the scope dumps
+    CheckOptions checkOptions;
+    // --prelude declares the functions of a snapshot before the program, --compile-prelude writes such a snapshot
+    string preludePath;
+    string compilePreludePath;
+    // --lsp serves an editor on stdin and stdout, it takes no other option
+    if (argc == 2 && string(argv[1]) == "--lsp") {
+        return runLanguageServer();
+    }
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--modules" && i + 1 < argc) {
+            modules = true;
+            moduleOptions.interfaceDirectory = argv[++i];
+        } else if (arg == "--stream") {
+            batchOptions.stream = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            batchOptions.jobs = serveOptions.jobs = moduleOptions.jobs = (unsigned) atoi(argv[++i]);
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serveOptions.socketPath = argv[++i];
+        } else if (arg == "--queue" && i + 1 < argc) {
+            serveOptions.queueCapacity = (size_t) atol(argv[++i]);
+        } else if (arg == "--connect" && i + 1 < argc) {
+            connectPath = argv[++i];
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--ast") {
+            dumpAst = true;
+        } else if (arg == "--bytecode") {
+            dumpBytecode = true;
+        } else if (arg == "--run") {
+            runCompiled = true;
+        } else if (arg == "--emit-llvm") {
+            emitLlvmIr = true;
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            // Past SIZE_MAX / BACKEND_STACK_PER_LEVEL, the stack of a program that deep cannot even be sized
+            long long depth = atoll(argv[++i]);
+            checkOptions.maxParserDepth = size_t(depth);
+            if (depth <= 0 || checkOptions.maxParserDepth > SIZE_MAX / BACKEND_STACK_PER_LEVEL) {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--symbols" && i + 1 < argc) {
+            string format = argv[++i];
+            if (format == "json") {
+                checkOptions.symbols = SYMBOLS_JSON;
+            } else if (format == "binary") {
+                checkOptions.symbols = SYMBOLS_BINARY;
+            } else {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--prelude" && i + 1 < argc) {
+            preludePath = argv[++i];
+        } else if (arg == "--compile-prelude" && i + 1 < argc) {
+            compilePreludePath = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        } else if (batch && arg[0] != '-') {
+            batchOptions.paths.push_back(arg);
+        } else if (modules && arg[0] != '-') {
+            moduleOptions.paths.push_back(arg);
+        } else if (arg[0] != '-' && inputPath.empty()) {
+            inputPath = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if ((stats || !cacheDirectory.empty()) && (batch || !serveOptions.socketPath.empty() || !connectPath.empty())) {
+        return usage(argv[0]);
+    }
+    if (stats && !cacheDirectory.empty()) {
+        return usage(argv[0]);
+    }
+    // The cache, the batch and the server check with the default options
+    bool defaultOptions = checkOptions.maxParserDepth == DEFAULT_MAX_PARSER_DEPTH &&
+                          checkOptions.symbols == SYMBOLS_TEXT && preludePath.empty();
+    if (!defaultOptions && (batch || !cacheDirectory.empty() || !serveOptions.socketPath.empty() ||
+                            !connectPath.empty())) {
+        return usage(argv[0]);
+    }
+    // The records replace the scope dumps, which --quiet and the tree modes do not print
+    if (checkOptions.symbols != SYMBOLS_TEXT && (quiet || dumpAst || dumpBytecode || runCompiled || emitLlvmIr)) {
+        return usage(argv[0]);
+    }
+    if (dumpAst + dumpBytecode + runCompiled + emitLlvmIr > 1) {
+        return usage(argv[0]);
+    }
+    bool useAst = dumpAst || dumpBytecode || runCompiled || emitLlvmIr;
+    // A prelude only has the signatures of its functions, there is nothing to compile a call to
+    if (useAst && (quiet || stats || batch || !cacheDirectory.empty() || !serveOptions.socketPath.empty() ||
+                    !connectPath.empty() || !preludePath.empty())) {
+        return usage(argv[0]);
+    }
+    if (!compilePreludePath.empty() && (quiet || stats || useAst || !defaultOptions || !cacheDirectory.empty() ||
+                                        batch || !serveOptions.socketPath.empty() || !connectPath.empty())) {
+        return usage(argv[0]);
+    }
+    if (modules) {
+        if (quiet || stats || batch || batchOptions.stream || useAst || !defaultOptions || !cacheDirectory.empty() ||
+            !compilePreludePath.empty() || !serveOptions.socketPath.empty() || !connectPath.empty() ||
+            !inputPath.empty() || moduleOptions.paths.empty()) {
+            return usage(argv[0]);
+        }
+        return runModules(moduleOptions);
+    }
+    if (!serveOptions.socketPath.empty()) {
+        if (quiet || batch || batchOptions.stream || !inputPath.empty() || !connectPath.empty()) {
+            return usage(argv[0]);
+        }
+        return runServer(serveOptions);
+    }
+    if (!connectPath.empty()) {
+        if (quiet || batch || batchOptions.stream || batchOptions.jobs || !inputPath.empty()) {
+            return usage(argv[0]);
+        }
+        return runClient(connectPath);
+    }
+    if (batch) {
+        if (quiet || !inputPath.empty() || batchOptions.paths.empty()) {
+            return usage(argv[0]);
+        }
+        return runBatch(batchOptions);
+    }
+    if (batchOptions.stream || batchOptions.jobs) {
+        return usage(argv[0]);
+    }
+
+    // --stats reports where the time of the check went on stderr, after the output
+    StatsReport report;
+    auto readStart = chrono::steady_clock::now();
+    MappedFile input;
+    string program;
+    {
+        PROFILE_PHASE(PHASE_READ);
+        if (!inputPath.empty()) {
+            if (!input.open(inputPath)) {
+                cerr << "cannot read " << inputPath << ": " << strerror(errno) << endl;
+                return 1;
+            }
+        } else {
+            program.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        }
+    }
+    report.readSeconds = secondsSince(readStart);
+    if (!compilePreludePath.empty()) {
+        string snapshot;
+        CheckResult result = inputPath.empty() ? compilePrelude(program.data(), program.size(), snapshot)
+                                               : compilePrelude(input.data(), input.size(), snapshot);
+        if (!result.ok) {
+            cerr << result.diagnostic << endl;
+            return 1;
+        }
+        ofstream out(compilePreludePath, ios::binary | ios::trunc);
+        out.write(snapshot.data(), snapshot.size());
+        if (!out) {
+            cerr << "cannot write " << compilePreludePath << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        return 0;
+    }
+    Prelude prelude;
+    if (!preludePath.empty()) {
+        string error;
+        if (!prelude.open(preludePath, error)) {
+            cerr << "cannot read prelude " << preludePath << ": " << error << endl;
+            return 1;
+        }
+        checkOptions.prelude = &prelude;
+    }
+    if (useAst) {
+        // The error line, if any, goes to stderr like with --quiet, nothing else is done for an invalid program
+        output::NullSink sink;
+        Ast ast;
+        bool ok = inputPath.empty() ? check(program.data(), program.size(), sink, ast, checkOptions).ok
+                                    : check(input.data(), input.size(), sink, ast, checkOptions).ok;
+        if (!ok) {
+            return 1;
+        }
+        // The dump walks the tree with its own stack
+        if (dumpAst) {
+            PROFILE_PHASE(PHASE_BACKEND);
+            ast.dump(cout);
+            return 0;
+        }
+        // The other backends walk the tree recursively, a few calls per level, so they get a stack sized from how
+        // deep this tree is, and not from the deepest tree --max-depth lets through
+        return runWithStack(BACKEND_STACK_BASE + ast.depth() * BACKEND_STACK_PER_LEVEL, [&] {
+            PROFILE_PHASE(PHASE_BACKEND);
+            if (emitLlvmIr) {
+                emitLlvm(ast, cout);
+                return 0;
+            }
+            Module module = compileProgram(ast);
+            if (dumpBytecode) {
+                module.dump(cout);
+                return 0;
+            }
+            output::StdoutSink programOutput;
+            RunStatus status = runProgram(module, programOutput).status;
+            programOutput.flush();
+            if (status == RUN_STACK_OVERFLOW) {
+                cerr << "stack overflow" << endl;
+                return 1;
+            }
+            return 0;
+        });
+    }
+    auto run = [&](output::Sink &sink) {
+        if (!cacheDirectory.empty()) {
+            FunctionCache cache(cacheDirectory);
+            return inputPath.empty() ? checkIncremental(program.data(), program.size(), sink, cache)
+                                     : checkIncremental(input.data(), input.size(), sink, cache);
+        }
+        return inputPath.empty() ? check(program.data(), program.size(), sink, checkOptions)
+                                 : check(input, sink, checkOptions);
+    };
+    auto runMeasured = [&](output::Sink &sink) {
+        if (!stats) {
+            return run(sink);
+        }
+        if (inputPath.empty()) {
+            measureFrontEnd(program.data(), program.size(), report);
+        } else {
+            measureFrontEnd(input.data(), input.size(), report);
+        }
+        auto start = chrono::steady_clock::now();
+        CheckResult result = run(sink);
+        report.checkSeconds = secondsSince(start);
+        report.counters = result.stats;
+        report.parserDepth = result.parserDepth;
+        report.peakRssKb = peakRssKb();
+        start = chrono::steady_clock::now();
+        sink.flush();
+        report.outputSeconds = secondsSince(start);
+        report.print(stderr);
+        return result;
+    };
+
+    if (quiet) {
+        output::NullSink sink;
+        // Only quiet runs report the result in the exit status, the graded runs always exit with 0
+        return runMeasured(sink).ok ? 0 : 1;
+    }
+    output::StdoutSink sink;
+    runMeasured(sink);
+    return 0;
+}
@@ -0,0 +1,172 @@
+#!/bin/bash
+
+# Checks programs split into modules, against the same program in one file, and which modules a change checks again
+# Usage: ./modules_test.bash [path to hw3]
+
+hw3=$(realpath "${1:-./hw3}")
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+status=0
+
+fail() {
+    echo "$1"
+    status=1
+}
+
+# The scopes of the functions, without the global scopes, which a program prints once and each module prints for itself
+function_scopes() {
+    awk '
+    pending != "" { if ($0 !~ /^print \(STRING\)/) print pending; pending = "" }
+    /^---end scope---$/ { pending = $0; next }
+    !/\)->/ { print }
+    END { if (pending != "") print pending }'
+}
+
+# $1 modules m0..m$1-1 in $2, each with $3 functions calling into the module before it, m$4 returns $5 from f$4a0
+generate() {
+    awk -v n="$1" -v dir="$2" -v count="$3" -v edited="$4" -v value="$5" 'BEGIN {
+        for (m = 0; m < n; m++) {
+            file = dir "/m" m ".in";
+            if (m > 0) printf "// module %d\n// import m%d\n", m, m - 1 > file;
+            for (f = 0; f < count; f++) {
+                printf "int f%da%d(int p) {\n    int x = p;\n", m, f > file;
+                if (m > 0) printf "    x = f%da%d(x);\n", m - 1, f > file;
+                printf "    if (x > 3) {\n        x = x - 1;\n    }\n" > file;
+                printf "    return %s;\n}\n", (m == edited && f == 0 ? value : "x") > file;
+            }
+            if (m == n - 1) printf "void main() {\n    printi(f%da0(1));\n}\n", m > file;
+            close(file);
+        }
+    }'
+}
+
+modules() {
+    for ((m = 0; m < $1; m++)); do
+        echo "$tmpdir/src/m$m.in"
+    done
+}
+
+# What a run checked, from its summary line
+checked() {
+    sed -n 's/.* \([0-9]*\) checked, \([0-9]*\) up to date.*/\1 \2/p' "$tmpdir/summary"
+}
+
+mkdir "$tmpdir/src"
+generate 50 "$tmpdir/src" 20 -1 x
+cat $(modules 50) | "$hw3" | function_scopes > "$tmpdir/expected"
+for pass in cold warm; do
+    "$hw3" --modules "$tmpdir/interfaces" $(modules 50) > "$tmpdir/actual" 2> "$tmpdir/summary"
+    if ! function_scopes < "$tmpdir/actual" | cmp -s - "$tmpdir/expected"; then
+        fail "$pass: the function scopes differ from the program in one file"
+    fi
+done
+if [ "$(checked)" != "0 50" ]; then
+    fail "warm: expected every module up to date, got $(checked)"
+fi
+
+# The same output whatever the number of jobs
+cp "$tmpdir/actual" "$tmpdir/warm"
+rm -rf "$tmpdir/interfaces"
+"$hw3" --modules "$tmpdir/interfaces" --jobs 8 $(modules 50) > "$tmpdir/actual" 2> "$tmpdir/summary"
+if ! cmp -s "$tmpdir/actual" "$tmpdir/warm" || [ "$(checked)" != "50 0" ]; then
+    fail "8 jobs: the cold output differs from the warm one, or $(checked) is not 50 checked"
+fi
+
+# A body edit checks its module again, a signature edit also checks the modules importing it
+generate 50 "$tmpdir/src" 20 10 "x + 1"
+"$hw3" --modules "$tmpdir/interfaces" $(modules 50) > /dev/null 2> "$tmpdir/summary"
+if [ "$(checked)" != "1 49" ]; then
+    fail "body edit: expected 1 module checked, got $(checked)"
+fi
+sed -i 's/^int f10a0(int p)/int f10a0(byte p)/' "$tmpdir/src/m10.in"
+"$hw3" --modules "$tmpdir/interfaces" $(modules 50) > "$tmpdir/actual" 2> "$tmpdir/summary"
+if [ "$(checked)" != "2 10" ] || [ "$(tail -n 1 "$tmpdir/actual")" != \
+    "$tmpdir/src/m11.in: line 5: prototype mismatch, function f10a0 expects arguments (BYTE)" ]; then
+    fail "signature edit: expected m10 and m11 checked and m11 failing, got $(checked) and $(tail -n 1 "$tmpdir/actual")"
+fi
+
+# A small program, module by module
+mkdir "$tmpdir/small"
+cd "$tmpdir/small" || exit 1
+cat > lists.in <<'MODULE'
+int sum(int n) {
+    int total = 0;
+    while (n > 0) {
+        total = total + n;
+        n = n - 1;
+    }
+    return total;
+}
+MODULE
+cat > banners.in <<'MODULE'
+void banner(int n) {
+    print("banner");
+    printi(n);
+}
+MODULE
+cat > app.in <<'MODULE'
+// the entry point
+// import lists
+// import banners
+void main() {
+    banner(sum(10));
+}
+MODULE
+cat > expected <<'OUTPUT'
+---end scope---
+---end scope---
+---end scope---
+n INT -1
+total INT 0
+---end scope---
+print (STRING)->VOID 0
+printi (INT)->VOID 0
+sum (INT)->INT 0
+---end scope---
+n INT -1
+---end scope---
+print (STRING)->VOID 0
+printi (INT)->VOID 0
+banner (INT)->VOID 0
+---end scope---
+---end scope---
+print (STRING)->VOID 0
+printi (INT)->VOID 0
+sum (INT)->INT 0
+banner (INT)->VOID 0
+main ()->VOID 0
+OUTPUT
+if ! "$hw3" --modules interfaces lists.in banners.in app.in 2> /dev/null | diff - expected; then
+    fail "the output of the small program differs"
+fi
+
+# The errors of a module are prefixed with its path, the link errors come after every module
+check_error() {
+    "$hw3" --modules interfaces "$@" > output 2> summary
+    # The files that cannot be checked at all leave an error instead of the summary
+    if grep -q " modules: " summary; then
+        actual=$(tail -n 1 output)
+    else
+        actual=$(head -n 1 summary)
+    fi
+    if [ "$actual" != "$expected" ]; then
+        fail "$*: expected '$expected', got '$actual'"
+    fi
+}
+printf 'void sum() {\n    return;\n}\n' > other.in
+printf '// import lists\n// import other\nvoid main() {\n    return;\n}\n' > both.in
+printf '// import banners\nvoid main() {\n    banner(true);\n}\n' > wrong.in
+expected="other.in: line 1: identifier sum is already defined"
+check_error lists.in other.in banners.in app.in
+expected="both.in: line 2: identifier sum is already defined"
+check_error lists.in other.in both.in
+expected="wrong.in: line 3: prototype mismatch, function banner expects arguments (INT)"
+check_error banners.in wrong.in
+expected="Program has no 'void main()' function"
+check_error lists.in banners.in
+expected="app.in: line 2: module lists is not on the command line before this one"
+check_error app.in lists.in banners.in
+expected="lists.in: module lists is already on the command line"
+check_error lists.in lists.in
+
+exit $status
@@ -0,0 +1,128 @@
+#!/bin/bash
+
+# Checks programs against a precompiled prelude, they must print what they print after the prelude text, without the
+# scopes of the prelude functions
+# Usage: ./prelude_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+status=0
+
+fail() {
+    echo "$1"
+    status=1
+}
+
+# $1 helper functions of every signature shape
+prelude() {
+    awk -v n="$1" 'BEGIN {
+        for (i = 0; i < n; i++) {
+            if (i % 3 == 0) printf "int helper%d(int x, byte y) {\n    return x + y;\n}\n", i;
+            else if (i % 3 == 1) printf "bool helper%d(int x) {\n    return x > %d;\n}\n", i, i;
+            else printf "void helper%d() {\n    printi(%d);\n}\n", i, i;
+        }
+    }'
+}
+
+cat > "$tmpdir/program.in" <<'PROGRAM'
+void main() {
+    int a = helper0(1, 2 b);
+    if (helper1(a)) {
+        helper2();
+    }
+    while (helper4(a)) a = a + 1;
+}
+PROGRAM
+
+# What the program prints after the prelude, minus what the prelude prints on its own (it stops at the missing main)
+expected_output() {
+    lines=$("$hw3" < "$1" | wc -l)
+    cat "$1" "$2" | "$hw3" | tail -n +"$lines"
+}
+
+for n in 10 2000; do
+    prelude $n > "$tmpdir/prelude$n.in"
+    if ! "$hw3" --compile-prelude "$tmpdir/prelude$n.snap" "$tmpdir/prelude$n.in"; then
+        fail "n=$n: the prelude does not compile"
+        continue
+    fi
+    expected_output "$tmpdir/prelude$n.in" "$tmpdir/program.in" > "$tmpdir/expected"
+    if ! "$hw3" --prelude "$tmpdir/prelude$n.snap" "$tmpdir/program.in" | diff - "$tmpdir/expected" > /dev/null; then
+        fail "n=$n: the output differs from the program after the prelude text"
+    fi
+done
+
+# The prelude names are taken, and their signatures are checked, on the lines of the program
+snapshot="$tmpdir/prelude10.snap"
+check_error() {
+    actual=$(printf "$1" | "$hw3" --prelude "$snapshot" | tail -n 1)
+    if [ "$actual" != "$2" ]; then
+        fail "'$1': expected '$2', got '$actual'"
+    fi
+}
+check_error 'void main() {\n    int helper3 = 1;\n}\n' "line 2: identifier helper3 is already defined"
+check_error 'void helper5() {\n    return;\n}\nvoid main() {\n    return;\n}\n' "line 1: identifier helper5 is already defined"
+check_error 'void main() {\n    helper0(1);\n}\n' "line 2: prototype mismatch, function helper0 expects arguments (INT,BYTE)"
+check_error 'void main() {\n    helper10();\n}\n' "line 2: function helper10 is not defined"
+check_error 'void f(int helper1) {\n    return;\n}\nvoid main() {\n    return;\n}\n' "line 1: identifier helper1 is already defined"
+
+# A prelude with main checks a program without functions, and a prelude with an error has no snapshot
+printf 'void main() {\n    return;\n}\n' > "$tmpdir/main.in"
+"$hw3" --compile-prelude "$tmpdir/main.snap" "$tmpdir/main.in"
+if [ "$(printf '' | "$hw3" --prelude "$tmpdir/main.snap" | tail -n 1)" != "main ()->VOID 0" ]; then
+    fail "the main of the prelude is not the main of the program"
+fi
+printf 'void f() {\n    g();\n}\n' > "$tmpdir/invalid.in"
+if "$hw3" --compile-prelude "$tmpdir/invalid.snap" "$tmpdir/invalid.in" 2> "$tmpdir/invalid.err" ||
+    [ "$(cat "$tmpdir/invalid.err")" != "line 2: function g is not defined" ] || [ -e "$tmpdir/invalid.snap" ]; then
+    fail "an invalid prelude is not reported"
+fi
+
+# Damaged snapshots are refused before the check
+echo "not a snapshot" > "$tmpdir/bad.snap"
+head -c 100 "$tmpdir/prelude2000.snap" > "$tmpdir/truncated.snap"
+for bad in bad truncated; do
+    if "$hw3" --prelude "$tmpdir/$bad.snap" "$tmpdir/program.in" > /dev/null 2> "$tmpdir/bad.err"; then
+        fail "$bad snapshot: accepted"
+    elif ! grep -q "^cannot read prelude .*: \(not a\|damaged\) prelude snapshot$" "$tmpdir/bad.err"; then
+        fail "$bad snapshot: $(cat "$tmpdir/bad.err")"
+    fi
+done
+
+# Buckets that are all taken, each by a function that is not the name looked up, end the lookup instead of probing
+# forever, the function count is a valid bucket entry in the byte order of the snapshot
+cp "$tmpdir/prelude10.snap" "$tmpdir/full.snap"
+u32() {
+    od -An -t u4 -j "$1" -N 4 "$tmpdir/full.snap" | tr -d ' '
+}
+bucket_count=$(u32 12)
+buckets_offset=$(u32 20)
+for ((bucket = 0; bucket < bucket_count; bucket++)); do
+    dd if="$tmpdir/prelude10.snap" of="$tmpdir/full.snap" bs=1 skip=8 count=4 seek=$(( buckets_offset + bucket * 4 )) \
+        conv=notrunc status=none
+done
+printf 'void main() {\n    nothere();\n}\n' > "$tmpdir/missing.in"
+timeout 10 "$hw3" --prelude "$tmpdir/full.snap" "$tmpdir/missing.in" > "$tmpdir/full.out"
+if [ $? = 124 ]; then
+    fail "full buckets: the lookup of a missing name does not end"
+elif [ "$(tail -n 1 "$tmpdir/full.out")" != "line 2: function nothere is not defined" ]; then
+    fail "full buckets: expected the missing name to be reported, got $(tail -n 1 "$tmpdir/full.out")"
+fi
+
+# The snapshot is not checked again, so a large prelude costs less than its text
+prelude 50000 > "$tmpdir/large.in"
+"$hw3" --compile-prelude "$tmpdir/large.snap" "$tmpdir/large.in"
+cat "$tmpdir/large.in" "$tmpdir/program.in" > "$tmpdir/large-program.in"
+start=$(date +%s%N)
+"$hw3" --quiet "$tmpdir/large-program.in"
+text=$(( ($(date +%s%N) - start) / 1000 ))
+start=$(date +%s%N)
+"$hw3" --quiet --prelude "$tmpdir/large.snap" "$tmpdir/program.in"
+snapshot=$(( ($(date +%s%N) - start) / 1000 ))
+echo "50000 prelude functions: ${text}us as text, ${snapshot}us as a snapshot"
+if [ "$snapshot" -ge "$text" ]; then
+    fail "the snapshot is not faster than the prelude text"
+fi
+
+exit $status
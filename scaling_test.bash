@@ -0,0 +1,64 @@
+#!/bin/bash
+
+# Checks that wide parameter lists, long argument lists and long case lists are handled in linear time
+# Usage: ./scaling_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+# A function with $1 parameters, a call to it with $1 arguments, and a switch with $1 cases
+generate() {
+    n=$1
+    awk -v n="$n" 'BEGIN {
+        printf "void wide(";
+        for (i = 0; i < n; i++) printf "%sint p%d", (i ? "," : ""), i;
+        printf ") { return; }\n";
+        printf "void main() {\n    wide(";
+        for (i = 0; i < n; i++) printf "%s%d", (i ? "," : ""), i;
+        printf ");\n    switch (1) {\n";
+        for (i = 0; i < n; i++) printf "        case %d: break;\n", i;
+        printf "    }\n}\n";
+    }'
+}
+
+# Prints the best of 3 runs in microseconds
+measure() {
+    best=""
+    for run in 1 2 3; do
+        start=$(date +%s%N)
+        "$hw3" < "$1" > "$tmpdir/out"
+        end=$(date +%s%N)
+        t=$(( (end - start) / 1000 ))
+        if [ -z "$best" ] || [ "$t" -lt "$best" ]; then
+            best=$t
+        fi
+    done
+    echo "$best"
+}
+
+prev=""
+status=0
+for n in 1250 2500 5000 10000; do
+    generate $n > "$tmpdir/t$n.in"
+    t=$(measure "$tmpdir/t$n.in")
+    if ! tail -n 1 "$tmpdir/out" | grep -q "^main ()->VOID 0$"; then
+        echo "n=$n: unexpected output"
+        tail -n 1 "$tmpdir/out"
+        status=1
+    fi
+    if [ -n "$prev" ]; then
+        ratio=$(awk -v a="$t" -v b="$prev" 'BEGIN { printf "%.2f", a / b }')
+        echo "n=$n: ${t}us (x$ratio for twice the size)"
+        # Twice the input should cost about twice the time, quadratic growth would show up as x4
+        if awk -v r="$ratio" 'BEGIN { exit !(r > 3.0) }'; then
+            echo "n=$n: time grows faster than linearly"
+            status=1
+        fi
+    else
+        echo "n=$n: ${t}us"
+    fi
+    prev=$t
+done
+
+exit $status
@@ -0,0 +1,124 @@
+#!/bin/bash
+
+# Checks that the resident checker answers with exactly the output of a single "hw3 < file" run
+# Usage: ./serve_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+socket="$tmpdir/hw3.sock"
+trap 'kill $server 2>/dev/null; rm -rf "$tmpdir"' EXIT
+
+"$hw3" --serve "$socket" --jobs 4 2> "$tmpdir/server.log" &
+server=$!
+# The socket file exists once bound, the server only accepts once it says it is serving
+for i in $(seq 50); do
+    grep -q "^serving on" "$tmpdir/server.log" && break
+    sleep 0.1
+done
+
+status=0
+check() {
+    "$hw3" --connect "$socket" < "$1" > "$2"
+    if ! cmp -s "${1%.in}.out" "$2"; then
+        echo "$1: served output differs from the expected output"
+        status=1
+    fi
+}
+
+for f in hw3-tests/*.in tests/*.in; do
+    check "$f" "$tmpdir/out"
+done
+
+# The same files again, all at once, so the workers and the queue are busy
+pids=""
+for f in hw3-tests/*.in tests/*.in; do
+    check "$f" "$tmpdir/$(echo "$f" | tr / _).res" &
+    pids="$pids $!"
+done
+for pid in $pids; do
+    wait "$pid" || status=1
+done
+for f in hw3-tests/*.in tests/*.in; do
+    res="$tmpdir/$(echo "$f" | tr / _).res"
+    if ! cmp -s "${f%.in}.out" "$res"; then
+        echo "$f: served output differs under load"
+        status=1
+    fi
+done
+
+kill -TERM $server
+wait $server
+if [ -e "$socket" ]; then
+    echo "the socket was not removed"
+    status=1
+fi
+cat "$tmpdir/server.log"
+
+# Clients keeping their connection open without a request hold no worker, one more client is still answered
+"$hw3" --serve "$socket" --jobs 2 --queue 2 2> "$tmpdir/server.log" &
+server=$!
+for i in $(seq 50); do
+    grep -q "^serving on" "$tmpdir/server.log" && break
+    sleep 0.1
+done
+# A client connects, then waits for the end of its stdin before sending, so it stays connected until the fifo closes
+mkfifo "$tmpdir/held"
+exec 3<> "$tmpdir/held"
+idle=""
+for i in 1 2 3 4; do
+    "$hw3" --connect "$socket" < "$tmpdir/held" > /dev/null &
+    idle="$idle $!"
+done
+sleep 0.5
+if ! timeout 10 "$hw3" --connect "$socket" < tests/t1.in > "$tmpdir/out" || ! cmp -s tests/t1.out "$tmpdir/out"; then
+    echo "a client is not answered while 4 idle connections are open on 2 workers"
+    status=1
+fi
+exec 3>&-
+kill $idle 2>/dev/null
+wait $idle 2>/dev/null
+kill -TERM $server
+wait $server
+
+# A client sending its request a byte at a time and one never reading its answer each lose their worker once the
+# request timeout passes, then one more client is answered
+if command -v perl > /dev/null; then
+    "$hw3" --serve "$socket" --jobs 2 2> "$tmpdir/server.log" &
+    server=$!
+    for i in $(seq 50); do
+        grep -q "^serving on" "$tmpdir/server.log" && break
+        sleep 0.1
+    done
+    # Announces 1000 bytes and sends one every 3 seconds
+    perl -MIO::Socket::UNIX -e '
+        $s = IO::Socket::UNIX->new(Peer => $ARGV[0]) or die;
+        $s->autoflush(1);
+        print $s pack("N", 1000);
+        for (1 .. 20) { print $s " "; sleep 3; }' "$socket" &
+    slow=$!
+    # Sends a program with a scope dump larger than the socket buffers and reads nothing
+    for i in $(seq 20000); do
+        echo "void f$i() { int x; }"
+    done > "$tmpdir/big.in"
+    echo "void main() {}" >> "$tmpdir/big.in"
+    perl -MIO::Socket::UNIX -e '
+        $s = IO::Socket::UNIX->new(Peer => $ARGV[0]) or die;
+        $s->autoflush(1);
+        local $/;
+        open(F, "<", $ARGV[1]) or die;
+        $p = <F>;
+        print $s pack("N", length($p)), $p;
+        sleep 60;' "$socket" "$tmpdir/big.in" &
+    deaf=$!
+    sleep 1
+    if ! timeout 25 "$hw3" --connect "$socket" < tests/t1.in > "$tmpdir/out" || ! cmp -s tests/t1.out "$tmpdir/out"; then
+        echo "a client is not answered while a slow client and a client not reading hold the 2 workers"
+        status=1
+    fi
+    kill $slow $deaf 2>/dev/null
+    wait $slow $deaf 2>/dev/null
+    kill -TERM $server
+    wait $server
+fi
+
+exit $status
@@ -0,0 +1,151 @@
+#!/bin/bash
+
+# Checks the symbol records of --symbols json and --symbols binary, which must say exactly what the scope dumps say
+# Usage: ./symbols_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+# Prints the scope dumps described by JSON records
+json_to_text() {
+    awk '
+    function field(key,    found) {
+        if (!match($0, "\"" key "\":(\"[^\"]*\"|\\[[^]]*\\]|[-0-9]+)")) return "";
+        found = substr($0, RSTART + length(key) + 3, RLENGTH - length(key) - 3);
+        gsub(/^["[]|["\]]$/, "", found);
+        return found;
+    }
+    {
+        kind = field("kind");
+        if (kind == "types") {
+            count = split(field("names"), names, ",");
+            for (i = 1; i <= count; i++) {
+                gsub(/"/, "", names[i]);
+                type[i - 1] = names[i];
+            }
+        } else if (kind == "signature") {
+            count = split(field("params"), params, ",");
+            text = "(";
+            for (i = 1; i <= count; i++) text = text (i > 1 ? "," : "") type[params[i]];
+            signature[field("id")] = text ")->" type[field("returns")];
+        } else if (kind == "scope") {
+            print "---end scope---";
+        } else if (kind == "function") {
+            print field("name") " " signature[field("signature")] " " field("offset");
+        } else if (kind == "variable" || kind == "parameter") {
+            print field("name") " " type[field("type")] " " field("offset");
+        } else if (kind == "error") {
+            print field("message");
+        }
+    }'
+}
+
+# Prints the scope dumps described by binary records, read as one byte per line
+binary_to_text() {
+    od -An -v -tu1 | tr -s ' ' '\n' | grep -v '^$' | awk '
+    { byte[n++] = $1 }
+    function u32(at) {
+        return byte[at] + byte[at + 1] * 256 + byte[at + 2] * 65536 + byte[at + 3] * 16777216;
+    }
+    function i32(at,    value) {
+        value = u32(at);
+        return value >= 2147483648 ? value - 4294967296 : value;
+    }
+    function chars(from, to,    text) {
+        text = "";
+        for (; from < to; from++) text = text sprintf("%c", byte[from]);
+        return text;
+    }
+    END {
+        if (chars(0, 4) != "HW3S" || u32(4) != 1) {
+            print "bad header";
+            exit 1;
+        }
+        for (at = 8; at < n; at = end) {
+            end = at + 4 + u32(at);
+            kind = byte[at + 4];
+            p = at + 5;
+            if (kind == 1) {
+                type[u32(p)] = chars(p + 4, end);
+            } else if (kind == 2) {
+                text = "(";
+                for (i = 0; i < u32(p + 8); i++) text = text (i ? "," : "") type[u32(p + 12 + 4 * i)];
+                signature[u32(p)] = text ")->" type[u32(p + 4)];
+            } else if (kind == 3) {
+                print "---end scope---";
+            } else if (kind == 4 || kind == 5) {
+                print chars(p + 16, end) " " type[u32(p)] " " i32(p + 4);
+            } else if (kind == 6) {
+                print chars(p + 16, end) " " signature[u32(p)] " " i32(p + 4);
+            } else if (kind == 7) {
+                print chars(p, end);
+            } else {
+                print "bad record kind " kind;
+                exit 1;
+            }
+        }
+        if (at != n) {
+            print "truncated record";
+            exit 1;
+        }
+    }'
+}
+
+status=0
+# Every program of the corpus, valid or not, gives the same scopes and the same error in all three formats
+for f in hw3-tests/*.in tests/*.in; do
+    "$hw3" < "$f" > "$tmpdir/text"
+    "$hw3" --symbols json < "$f" > "$tmpdir/json"
+    "$hw3" --symbols binary < "$f" > "$tmpdir/binary"
+    if ! json_to_text < "$tmpdir/json" | cmp -s - "$tmpdir/text"; then
+        echo "$f: the JSON records differ from the scope dumps"
+        json_to_text < "$tmpdir/json" | diff - "$tmpdir/text" | head -5
+        status=1
+    fi
+    if ! binary_to_text < "$tmpdir/binary" | cmp -s - "$tmpdir/text"; then
+        echo "$f: the binary records differ from the scope dumps"
+        binary_to_text < "$tmpdir/binary" | diff - "$tmpdir/text" | head -5
+        status=1
+    fi
+done
+
+# The fields the dumps do not have: the kind of a variable, the scope depth and the declaring line
+cat > "$tmpdir/p.in" <<'PROGRAM'
+int add(int x, byte y) {
+    return x + y;
+}
+void main() {
+    int a = 1;
+    if (a > 0) {
+        bool flag = true;
+    }
+    printi(add(a, 2 b));
+}
+PROGRAM
+cat > "$tmpdir/expected" <<'RECORDS'
+{"kind":"types","names":["VOID","INT","BYTE","BOOL","STRING"]}
+{"kind":"scope","depth":1,"symbols":2}
+{"kind":"parameter","name":"x","type":1,"offset":-1,"depth":1,"line":1}
+{"kind":"parameter","name":"y","type":2,"offset":-2,"depth":1,"line":1}
+{"kind":"scope","depth":3,"symbols":1}
+{"kind":"variable","name":"flag","type":3,"offset":1,"depth":3,"line":7}
+{"kind":"scope","depth":2,"symbols":0}
+{"kind":"scope","depth":1,"symbols":1}
+{"kind":"variable","name":"a","type":1,"offset":0,"depth":1,"line":5}
+{"kind":"signature","id":0,"params":[4],"returns":0}
+{"kind":"signature","id":1,"params":[1],"returns":0}
+{"kind":"signature","id":2,"params":[1,2],"returns":1}
+{"kind":"signature","id":3,"params":[],"returns":0}
+{"kind":"scope","depth":0,"symbols":4}
+{"kind":"function","name":"print","signature":0,"offset":0,"depth":0,"line":0}
+{"kind":"function","name":"printi","signature":1,"offset":0,"depth":0,"line":0}
+{"kind":"function","name":"add","signature":2,"offset":0,"depth":0,"line":1}
+{"kind":"function","name":"main","signature":3,"offset":0,"depth":0,"line":4}
+RECORDS
+if ! "$hw3" --symbols json "$tmpdir/p.in" | diff - "$tmpdir/expected"; then
+    echo "the JSON records of the sample program differ"
+    status=1
+fi
+
+exit $status
@@ -0,0 +1,114 @@
+#!/bin/bash
+
+# Checks what programs compiled with --run print
+# Usage: ./vm_test.bash [path to hw3]
+
+hw3=${1:-./hw3}
+tmpdir=$(mktemp -d)
+trap 'rm -rf "$tmpdir"' EXIT
+
+status=0
+# Runs the program $1 and compares what it prints with $2
+expect() {
+    "$hw3" --run < "$1" > "$tmpdir/output" 2>&1
+    if ! cmp -s "$tmpdir/output" "$2"; then
+        echo "$1: unexpected output"
+        diff "$2" "$tmpdir/output" | head -10
+        status=1
+    fi
+}
+
+# Byte and int wrap around, fall through in a switch, break and continue, short circuit, division by zero
+cat > "$tmpdir/p.in" <<'PROGRAM'
+bool loud(bool v) {
+    print("loud");
+    return v;
+}
+int div(int a, int b2) {
+    return a / b2;
+}
+void main() {
+    byte x = 250 b;
+    x = x + 10 b;
+    printi(x);
+    int big = 2147483647;
+    big = big + 1;
+    printi(big);
+    int i = 0;
+    while (i < 10) {
+        i = i + 1;
+        if (i == 3) continue;
+        switch (i) {
+            case 1: print("one");
+            case 2: print("two"); break;
+            case 5: break;
+            default: printi(i * 100);
+        }
+        if (i > 7) break;
+    }
+    if (false and loud(true)) print("no");
+    if (true or loud(false)) print("yes");
+    if (loud(true) and not loud(false)) print("both");
+    byte y = 3 b;
+    y = y - 5 b;
+    printi(y);
+    int z;
+    printi(z);
+    printi(div(0 - 7, 2));
+    printi(div(7, 0));
+    print("unreachable");
+}
+PROGRAM
+cat > "$tmpdir/p.out" <<'OUTPUT'
+4
+-2147483648
+one
+two
+two
+400
+600
+700
+800
+yes
+loud
+loud
+both
+254
+0
+-3
+Error division by zero
+OUTPUT
+expect "$tmpdir/p.in" "$tmpdir/p.out"
+
+# Recursion, and a function that falls off its end returns 0
+cat > "$tmpdir/p.in" <<'PROGRAM'
+int fib(int n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+int nothing(bool flag) {
+    if (flag) return 1;
+}
+void main() {
+    printi(fib(20));
+    printi(nothing(false));
+}
+PROGRAM
+printf '6765\n0\n' > "$tmpdir/p.out"
+expect "$tmpdir/p.in" "$tmpdir/p.out"
+
+# Unbounded recursion stops with an error instead of overflowing the frame stack
+cat > "$tmpdir/p.in" <<'PROGRAM'
+int down(int n) {
+    return down(n + 1);
+}
+void main() {
+    printi(down(0));
+}
+PROGRAM
+if "$hw3" --run < "$tmpdir/p.in" > /dev/null 2>&1; then
+    echo "unbounded recursion did not fail"
+    status=1
+fi
+
+exit $status